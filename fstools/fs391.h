@@ -0,0 +1,104 @@
+/*
+ * fs391.h - on-disk format shared by mkfs391 and fsck391.
+ *
+ * This mirrors boot_block_t, dentry_t and inode_t in student-distrib/file.h
+ * and the journal structures in student-distrib/journal.h. The kernel headers
+ * bring their own integer types, so the layout is repeated here for the host;
+ * keep the two in step.
+ */
+#ifndef _FS391_H
+#define _FS391_H
+
+#include <stdint.h>
+
+#define BLOCK_SIZE			4096
+#define MAX_NAME_LEN		32
+#define MAX_DENTRIES		63
+#define MAX_FILE_BLOCKS		1023
+#define MAX_FS_BLOCKS		16384		/* What the kernel's allocator can track. */
+#define MAX_FS_INODES		1024
+#define MAX_EXTENTS			510
+#define INODE_EXTENT_MAGIC	0x54584524		/* In data_block_num[0] of an extent inode. */
+#define INODE_LZ_MAGIC		0x345A4C24		/* In data_block_num[0] of a compressed inode. */
+#define MAX_LZ_CHUNKS		1019
+
+#define TYPE_RTC			0
+#define TYPE_DIR			1
+#define TYPE_FILE			2
+
+#define JOURNAL_MAGIC			0x4C4E524A
+#define JOURNAL_DESC_MAGIC		0x4353444A
+#define JOURNAL_COMMIT_MAGIC	0x544D434A
+#define JOURNAL_BLOCKS			32
+#define JOURNAL_MAX_TXN			(JOURNAL_BLOCKS - 2)
+
+typedef struct dentry{
+	char fname[MAX_NAME_LEN];			/* Not NUL terminated at 32 characters. */
+	int32_t file_type;
+	int32_t inode_num;
+	uint8_t reserved[24];
+} dentry_t;
+
+typedef struct boot_block{
+	int32_t dir_count;
+	int32_t inode_count;
+	int32_t data_count;
+	int32_t journal_magic;
+	int32_t journal_start;				/* First data block of the journal. */
+	int32_t journal_blocks;
+	uint8_t reserved[40];
+	dentry_t d_entries[MAX_DENTRIES];
+} boot_block_t;
+
+typedef struct inode{
+	int32_t length;
+	int32_t data_block_num[MAX_FILE_BLOCKS];
+} inode_t;
+
+typedef struct extent{
+	int32_t start;
+	int32_t count;
+} extent_t;
+
+typedef struct inode_ext{
+	int32_t length;
+	int32_t magic;
+	int32_t extent_count;
+	extent_t extents[MAX_EXTENTS];
+} inode_ext_t;
+
+/* Each 4 kB chunk is an LZ4 block, or raw if it did not shrink. */
+typedef struct inode_lz{
+	int32_t length;						/* Uncompressed length. */
+	int32_t magic;
+	int32_t start;						/* First data block of the compressed stream. */
+	int32_t stored_blocks;
+	uint32_t offsets[MAX_LZ_CHUNKS + 1];	/* Chunk starts in the stream, then the end of the last. */
+} inode_lz_t;
+
+typedef struct journal_desc{
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t count;
+	uint32_t target[JOURNAL_MAX_TXN];	/* Image block numbers, 0 is the boot block. */
+} journal_desc_t;
+
+typedef struct journal_commit{
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t checksum;
+} journal_commit_t;
+
+/* Same rotate-and-xor the kernel uses over the block copies of a transaction. */
+static inline uint32_t journal_checksum(const uint8_t* data, uint32_t count){
+	const uint32_t* word = (const uint32_t*)data;
+	uint32_t sum = 0;
+	uint32_t i;
+
+	for(i = 0; i < count * BLOCK_SIZE / 4; i++){
+		sum = ((sum << 1) | (sum >> 31)) ^ word[i];
+	}
+	return sum;
+}
+
+#endif /* _FS391_H */
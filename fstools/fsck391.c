@@ -0,0 +1,327 @@
+/*
+ * fsck391 - checks a filesystem image without changing it.
+ *
+ * Checks the boot block counts, every directory entry, every file's inode
+ * and block list, extent list or compressed chunk table (range, double
+ * use, overlap with the journal) and the
+ * state of the metadata journal. Reports how many files are fragmented,
+ * since read-ahead only pays off on contiguous files.
+ * Exit status: 0 if clean, 1 if any error was found, 2 on usage or I/O error.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fs391.h"
+
+static int errors = 0;
+static int warnings = 0;
+
+static void error(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void warn(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void error(const char* fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	printf("error: ");
+	vprintf(fmt, args);
+	printf("\n");
+	va_end(args);
+	errors++;
+}
+
+static void warn(const char* fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	printf("warning: ");
+	vprintf(fmt, args);
+	printf("\n");
+	va_end(args);
+	warnings++;
+}
+
+/* Copies a dentry name into a NUL terminated buffer. */
+static const char* entry_name(const dentry_t* entry, char* buf){
+	memcpy(buf, entry->fname, MAX_NAME_LEN);
+	buf[MAX_NAME_LEN] = '\0';
+	return buf;
+}
+
+/*
+ * Returns the data block holding block idx of the file, or -1 (after
+ * reporting it) if the inode does not have one. Extent lists are checked
+ * as a whole on the first call for each file.
+ */
+static int32_t file_block(const char* name, const inode_t* inode, int32_t idx, int32_t data_count){
+	int32_t i;
+
+	if(inode->data_block_num[0] == INODE_LZ_MAGIC){
+		return ((const inode_lz_t*)inode)->start + idx;
+	}
+	if(inode->data_block_num[0] != INODE_EXTENT_MAGIC){
+		return inode->data_block_num[idx];
+	}
+	const inode_ext_t* ext = (const inode_ext_t*)inode;
+	if(ext->extent_count < 0 || ext->extent_count > MAX_EXTENTS){
+		if(idx == 0){
+			error("%s: %d extents", name, ext->extent_count);
+		}
+		return -1;
+	}
+	for(i = 0; i < ext->extent_count; i++){
+		if(idx == 0 && (ext->extents[i].count <= 0 || ext->extents[i].start < 0 ||
+		   ext->extents[i].start + ext->extents[i].count > data_count)){
+			error("%s: extent %d (%d blocks at %d) out of range", name, i, ext->extents[i].count, ext->extents[i].start);
+		}
+		if(ext->extents[i].count > 0 && idx < ext->extents[i].count){
+			return ext->extents[i].start + idx;
+		}
+		if(ext->extents[i].count > 0){
+			idx -= ext->extents[i].count;
+		}
+	}
+	error("%s: extents end before the file does", name);
+	return -1;
+}
+
+/*
+ * Checks a compressed inode's chunk table: chunks start where the previous
+ * one ended, none is larger than a block and the stream fits in the data
+ * blocks the inode claims.
+ * RETURN: 0 if the table is usable, -1 otherwise.
+ */
+static int check_lz(const char* name, const inode_lz_t* lz, int32_t data_count){
+	int32_t chunks = (lz->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	int32_t i;
+
+	if(lz->length < 0 || chunks > MAX_LZ_CHUNKS){
+		error("%s: compressed length %d out of range", name, lz->length);
+		return -1;
+	}
+	if(lz->stored_blocks < 0 || lz->start < 0 || lz->start + lz->stored_blocks > data_count){
+		error("%s: compressed stream (%d blocks at %d) out of range", name, lz->stored_blocks, lz->start);
+		return -1;
+	}
+	if(chunks > 0 && lz->offsets[0] != 0){
+		error("%s: first chunk starts at %u", name, lz->offsets[0]);
+	}
+	for(i = 0; i < chunks; i++){
+		if(lz->offsets[i + 1] < lz->offsets[i] || lz->offsets[i + 1] - lz->offsets[i] > BLOCK_SIZE){
+			error("%s: chunk %d has bounds %u-%u", name, i, lz->offsets[i], lz->offsets[i + 1]);
+			return -1;
+		}
+	}
+	if(lz->offsets[chunks] > (uint32_t)lz->stored_blocks * BLOCK_SIZE){
+		error("%s: compressed stream is %u bytes, longer than its %d blocks", name, lz->offsets[chunks], lz->stored_blocks);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Reports the journal's state. A committed transaction is not an error,
+ * the kernel replays it at mount; anything else in the descriptor block is
+ * a transaction that never committed and is ignored.
+ */
+static void check_journal(const uint8_t* image, const boot_block_t* boot){
+	if(boot->journal_magic == 0){
+		printf("journal: none (the kernel adds one on the first disk mount)\n");
+		return;
+	}
+	if(boot->journal_magic != JOURNAL_MAGIC){
+		error("journal magic is %#x", (uint32_t)boot->journal_magic);
+		return;
+	}
+	if(boot->journal_blocks != JOURNAL_BLOCKS || boot->journal_start < 0 ||
+	   boot->journal_start + JOURNAL_BLOCKS > boot->data_count){
+		error("journal at data block %d, length %d does not fit", boot->journal_start, boot->journal_blocks);
+		return;
+	}
+
+	uint32_t start = 1 + boot->inode_count + boot->journal_start;
+	const journal_desc_t* d = (const journal_desc_t*)(image + (size_t)start * BLOCK_SIZE);
+	printf("journal: data blocks %d-%d, ", boot->journal_start, boot->journal_start + JOURNAL_BLOCKS - 1);
+	if(d->magic != JOURNAL_DESC_MAGIC){
+		printf("clean, next sequence %u\n", d->seq + 1);
+		return;
+	}
+	if(d->count == 0 || d->count > JOURNAL_MAX_TXN){
+		printf("descriptor with bad count %u, ignored at mount\n", d->count);
+		return;
+	}
+	const uint8_t* copies = (const uint8_t*)d + BLOCK_SIZE;
+	const journal_commit_t* c = (const journal_commit_t*)(copies + (size_t)d->count * BLOCK_SIZE);
+	if(c->magic == JOURNAL_COMMIT_MAGIC && c->seq == d->seq && c->checksum == journal_checksum(copies, d->count)){
+		printf("transaction %u (%u blocks) committed, will be replayed at mount\n", d->seq, d->count);
+		warnings++;
+	}
+	else{
+		printf("transaction %u never committed, ignored at mount\n", d->seq);
+	}
+}
+
+int main(int argc, char** argv){
+	int verbose = 0;
+	int opt, i;
+	int32_t j;
+
+	while((opt = getopt(argc, argv, "v")) != -1){
+		if(opt != 'v'){
+			fprintf(stderr, "usage: %s [-v] image\n", argv[0]);
+			return 2;
+		}
+		verbose = 1;
+	}
+	if(optind != argc - 1){
+		fprintf(stderr, "usage: %s [-v] image\n", argv[0]);
+		return 2;
+	}
+
+	FILE* in = fopen(argv[optind], "rb");
+	if(in == NULL){
+		perror(argv[optind]);
+		return 2;
+	}
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	uint8_t* image = malloc(size > BLOCK_SIZE ? size : BLOCK_SIZE);
+	memset(image, 0, BLOCK_SIZE);
+	if(fread(image, 1, size, in) != (size_t)size){
+		perror(argv[optind]);
+		return 2;
+	}
+	fclose(in);
+
+	/* The boot block: everything else depends on these counts. */
+	boot_block_t* boot = (boot_block_t*)image;
+	if(size < BLOCK_SIZE || boot->dir_count < 0 || boot->dir_count > MAX_DENTRIES ||
+	   boot->inode_count <= 0 || boot->data_count < 0){
+		printf("error: bad boot block (%d entries, %d inodes, %d data blocks)\n",
+			boot->dir_count, boot->inode_count, boot->data_count);
+		return 1;
+	}
+	long need = (long)(1 + boot->inode_count + boot->data_count) * BLOCK_SIZE;
+	if(size < need){
+		printf("error: image is %ld bytes, counts need %ld\n", size, need);
+		return 1;
+	}
+	if(boot->inode_count > MAX_FS_INODES){
+		warn("only the first %d of %d inodes can be allocated", MAX_FS_INODES, boot->inode_count);
+	}
+	if(boot->data_count > MAX_FS_BLOCKS){
+		warn("only the first %d of %d data blocks can be allocated", MAX_FS_BLOCKS, boot->data_count);
+	}
+
+	/* owner[b] is the dentry index + 1 of the file using data block b, -1 for the journal. */
+	int* owner = calloc(boot->data_count + 1, sizeof(int));
+	int* inode_owner = calloc(boot->inode_count, sizeof(int));
+	if(boot->journal_magic == JOURNAL_MAGIC && boot->journal_blocks == JOURNAL_BLOCKS &&
+	   boot->journal_start >= 0 && boot->journal_start + JOURNAL_BLOCKS <= boot->data_count){
+		for(j = 0; j < JOURNAL_BLOCKS; j++){
+			owner[boot->journal_start + j] = -1;
+		}
+	}
+
+	int files = 0, fragmented = 0, dirs = 0;
+	long used = 0;
+	char name[MAX_NAME_LEN + 1], other[MAX_NAME_LEN + 1];
+	for(i = 0; i < boot->dir_count; i++){
+		const dentry_t* entry = &boot->d_entries[i];
+		entry_name(entry, name);
+		if(name[0] == '\0'){
+			error("entry %d has an empty name", i);
+		}
+		for(j = 0; j < i; j++){
+			if(strncmp(entry->fname, boot->d_entries[j].fname, MAX_NAME_LEN) == 0){
+				error("%s: entries %d and %d have the same name", name, j, i);
+			}
+		}
+		if(entry->file_type == TYPE_DIR){
+			dirs++;
+			continue;
+		}
+		if(entry->file_type == TYPE_RTC){
+			continue;
+		}
+		if(entry->file_type != TYPE_FILE){
+			error("%s: unknown file type %d", name, entry->file_type);
+			continue;
+		}
+
+		files++;
+		if(entry->inode_num < 0 || entry->inode_num >= boot->inode_count){
+			error("%s: inode %d out of range", name, entry->inode_num);
+			continue;
+		}
+		if(inode_owner[entry->inode_num]){
+			error("%s: inode %d is also used by entry %d", name, entry->inode_num, inode_owner[entry->inode_num] - 1);
+			continue;
+		}
+		inode_owner[entry->inode_num] = i + 1;
+
+		const inode_t* inode = (const inode_t*)(image + (size_t)(1 + entry->inode_num) * BLOCK_SIZE);
+		int extent_inode = (inode->data_block_num[0] == INODE_EXTENT_MAGIC);
+		int lz_inode = (inode->data_block_num[0] == INODE_LZ_MAGIC);
+		int32_t max_blocks = extent_inode ? MAX_FS_BLOCKS : MAX_FILE_BLOCKS;
+		int32_t blocks;
+		if(lz_inode){
+			if(check_lz(name, (const inode_lz_t*)inode, boot->data_count) != 0){
+				continue;
+			}
+			blocks = ((const inode_lz_t*)inode)->stored_blocks;
+		}
+		else if(inode->length < 0 || inode->length > max_blocks * BLOCK_SIZE){
+			error("%s: length %d out of range", name, inode->length);
+			continue;
+		}
+		else{
+			blocks = (inode->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		}
+		int contiguous = 1;
+		int32_t prev = -1;
+		for(j = 0; j < blocks; j++){
+			int32_t b = file_block(name, inode, j, boot->data_count);
+			if(b == -1 && extent_inode){
+				break;
+			}
+			if(b < 0 || b >= boot->data_count){
+				error("%s: block %d points at data block %d, out of range", name, j, b);
+				continue;
+			}
+			if(owner[b] == -1){
+				error("%s: block %d points into the journal (data block %d)", name, j, b);
+			}
+			else if(owner[b] != 0){
+				error("%s: data block %d is also used by %s", name, b,
+					entry_name(&boot->d_entries[owner[b] - 1], other));
+			}
+			else{
+				owner[b] = i + 1;
+				used++;
+			}
+			if(j > 0 && b != prev + 1){
+				contiguous = 0;
+			}
+			prev = b;
+		}
+		if(!contiguous){
+			fragmented++;
+		}
+		if(verbose){
+			printf("%-32s inode %4d %8d bytes %4d blocks%s%s\n", name, entry->inode_num, inode->length, blocks,
+				extent_inode ? " (extents)" : (lz_inode ? " (lz4)" : ""), contiguous ? "" : " (fragmented)");
+		}
+	}
+	if(dirs != 1){
+		warn("%d directory entries for \".\"", dirs);
+	}
+
+	check_journal(image, boot);
+	printf("%d files, %d/%d inodes, %ld/%d data blocks used, %d fragmented\n", files, files + dirs,
+		boot->inode_count, used, boot->data_count, fragmented);
+	printf("%d errors, %d warnings\n", errors, warnings);
+	return errors ? 1 : 0;
+}
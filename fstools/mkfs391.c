@@ -0,0 +1,380 @@
+/*
+ * mkfs391 - builds a filesystem image from a flat directory.
+ *
+ * Unlike createfs, the output depends only on the directory contents:
+ * files are added in name order, inodes are numbered from 1 and every
+ * file's data blocks are contiguous and in file order, which is what
+ * read-ahead in the kernel's buffer cache works best with. Free blocks
+ * can be left for the writable filesystem and a metadata journal area can
+ * be reserved up front (the kernel otherwise adds one on first mount).
+ * With -e every file is described by a single extent instead of a list of
+ * blocks, which also lifts the 1023 block limit on file size. With -z each
+ * 4 kB of a file is compressed on its own in the LZ4 block format, and a
+ * file that ends up taking fewer blocks is stored compressed (read-only).
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fs391.h"
+
+#define DEFAULT_INODES		64
+#define HASH_BITS			12
+#define MIN_MATCH			4
+#define LAST_LITERALS		5			/* LZ4 ends every block with at least this many literals */
+#define MATCH_LIMIT			12			/* and starts no match in its last 12 bytes. */
+
+typedef struct src_file{
+	char name[MAX_NAME_LEN + 1];
+	char* path;
+	uint32_t length;
+	uint32_t blocks;					/* Data blocks it takes in the image. */
+	uint8_t* stream;					/* Compressed chunks back to back, NULL if stored raw. */
+	inode_lz_t* lz;
+} src_file_t;
+
+static void usage(const char* prog){
+	fprintf(stderr,
+		"usage: %s [-e] [-j] [-n inodes] [-f free_blocks] -d srcdir -o image\n"
+		"  -d srcdir   flat directory to copy in (for example fsdir)\n"
+		"  -o image    image to write (for example student-distrib/filesys_img)\n"
+		"  -n inodes   number of inodes (default %d, at most %d)\n"
+		"  -f blocks   free data blocks to leave after the files (default 0)\n"
+		"  -j          reserve a %d block metadata journal\n"
+		"  -e          write extent inodes (files up to %d blocks)\n"
+		"  -z          store files compressed when that saves blocks\n",
+		prog, DEFAULT_INODES, MAX_FS_INODES, JOURNAL_BLOCKS, MAX_FS_BLOCKS);
+	exit(2);
+}
+
+static int cmp_name(const void* a, const void* b){
+	return strcmp(((const src_file_t*)a)->name, ((const src_file_t*)b)->name);
+}
+
+/*
+ * Collects the regular files in dir, sorted by name. Names longer than 32
+ * characters are cut to 32, as the kernel only compares that many.
+ * RETURN: number of files, -1 on error.
+ */
+static int scan_dir(const char* dir, src_file_t* files, int max, uint32_t max_blocks){
+	DIR* d = opendir(dir);
+	struct dirent* ent;
+	struct stat st;
+	int count = 0;
+	int i;
+
+	if(d == NULL){
+		fprintf(stderr, "mkfs391: %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	while((ent = readdir(d)) != NULL){
+		if(ent->d_name[0] == '.'){
+			continue;
+		}
+		char* path = malloc(strlen(dir) + strlen(ent->d_name) + 2);
+		sprintf(path, "%s/%s", dir, ent->d_name);
+		if(stat(path, &st) != 0 || !S_ISREG(st.st_mode)){
+			fprintf(stderr, "mkfs391: skipping %s (not a regular file)\n", path);
+			free(path);
+			continue;
+		}
+		if(count == max){
+			fprintf(stderr, "mkfs391: more than %d files, the boot block has no room\n", max);
+			closedir(d);
+			return -1;
+		}
+		if(strlen(ent->d_name) > MAX_NAME_LEN){
+			fprintf(stderr, "mkfs391: %s: name cut to %d characters\n", ent->d_name, MAX_NAME_LEN);
+		}
+		if(strcmp(ent->d_name, "rtc") == 0){
+			fprintf(stderr, "mkfs391: %s: name clashes with the RTC device\n", path);
+			closedir(d);
+			return -1;
+		}
+		if((uint64_t)st.st_size > (uint64_t)max_blocks * BLOCK_SIZE){
+			fprintf(stderr, "mkfs391: %s: larger than %u blocks\n", path, max_blocks);
+			closedir(d);
+			return -1;
+		}
+		strncpy(files[count].name, ent->d_name, MAX_NAME_LEN);
+		files[count].name[MAX_NAME_LEN] = '\0';
+		files[count].path = path;
+		files[count].length = st.st_size;
+		files[count].blocks = (st.st_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		count++;
+	}
+	closedir(d);
+
+	qsort(files, count, sizeof(src_file_t), cmp_name);
+	for(i = 1; i < count; i++){
+		if(strcmp(files[i - 1].name, files[i].name) == 0){
+			fprintf(stderr, "mkfs391: two files are named %s after cutting to %d characters\n",
+				files[i].name, MAX_NAME_LEN);
+			return -1;
+		}
+	}
+	return count;
+}
+
+/* Copies a file into consecutive data blocks. RETURN: 0 on success, -1 on error. */
+static int load_file(const src_file_t* f, uint8_t* data){
+	FILE* in = fopen(f->path, "rb");
+	if(in == NULL || fread(data, 1, f->length, in) != f->length){
+		fprintf(stderr, "mkfs391: %s: read failed\n", f->path);
+		if(in != NULL){
+			fclose(in);
+		}
+		return -1;
+	}
+	fclose(in);
+	return 0;
+}
+
+static uint32_t hash4(const uint8_t* p){
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Writes the 255 continuation bytes of a length that did not fit in its nibble. */
+static uint8_t* put_length(uint8_t* op, uint32_t len){
+	for(; len >= 255; len -= 255){
+		*op++ = 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+/* Writes one sequence. An offset of 0 makes it the last one, literals only. */
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* lit, uint32_t lit_len, uint32_t offset, uint32_t match_len){
+	uint8_t* token = op++;
+	*token = (lit_len >= 15 ? 15 : lit_len) << 4;
+	if(lit_len >= 15){
+		op = put_length(op, lit_len - 15);
+	}
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+	if(offset == 0){
+		return op;
+	}
+	*op++ = offset & 0xFF;
+	*op++ = offset >> 8;
+	match_len -= MIN_MATCH;
+	*token |= (match_len >= 15 ? 15 : match_len);
+	if(match_len >= 15){
+		op = put_length(op, match_len - 15);
+	}
+	return op;
+}
+
+/*
+ * Greedy LZ4 block compressor: the last position whose first four bytes
+ * hashed the same is the only match candidate. dst needs room for
+ * len + len / 255 + 16 bytes.
+ * RETURN: compressed size.
+ */
+static uint32_t lz4_compress(const uint8_t* src, uint32_t len, uint8_t* dst){
+	int32_t table[1 << HASH_BITS];
+	const uint8_t* ip = src;
+	const uint8_t* anchor = src;
+	const uint8_t* iend = src + len;
+	uint8_t* op = dst;
+	int i;
+
+	for(i = 0; i < (1 << HASH_BITS); i++){
+		table[i] = -1;
+	}
+	while(len > MATCH_LIMIT && ip < iend - MATCH_LIMIT){
+		uint32_t h = hash4(ip);
+		int32_t cand = table[h];
+		table[h] = ip - src;
+		if(cand < 0 || memcmp(src + cand, ip, MIN_MATCH) != 0){
+			ip++;
+			continue;
+		}
+		const uint8_t* match = src + cand;
+		const uint8_t* end = ip + MIN_MATCH;
+		while(end < iend - LAST_LITERALS && *end == match[end - ip]){
+			end++;
+		}
+		op = put_sequence(op, anchor, ip - anchor, ip - match, end - ip);
+		ip = anchor = end;
+	}
+	op = put_sequence(op, anchor, iend - anchor, 0, 0);
+	return op - dst;
+}
+
+/*
+ * Compresses a file chunk by chunk into f->stream and fills in f->lz. Both
+ * stay NULL if that would not save a block.
+ * RETURN: 0 on success, -1 on error.
+ */
+static int compress_file(src_file_t* f){
+	uint8_t tmp[2 * BLOCK_SIZE];
+	uint32_t pos = 0;
+	uint32_t c;
+
+	if(f->blocks == 0 || f->blocks > MAX_LZ_CHUNKS){
+		return 0;
+	}
+	uint8_t* raw = malloc((size_t)f->blocks * BLOCK_SIZE);
+	uint8_t* stream = malloc((size_t)f->blocks * BLOCK_SIZE);
+	inode_lz_t* lz = calloc(1, sizeof(inode_lz_t));
+	if(load_file(f, raw) != 0){
+		return -1;
+	}
+	for(c = 0; c < f->blocks; c++){
+		uint32_t len = f->length - c * BLOCK_SIZE;
+		len = (len > BLOCK_SIZE) ? BLOCK_SIZE : len;
+		uint32_t n = lz4_compress(raw + c * BLOCK_SIZE, len, tmp);
+		if(n >= len){
+			n = len;		/* Kept raw: the kernel copies a chunk whose stored size is its full size. */
+			memcpy(tmp, raw + c * BLOCK_SIZE, len);
+		}
+		lz->offsets[c] = pos;
+		memcpy(stream + pos, tmp, n);
+		pos += n;
+	}
+	lz->offsets[c] = pos;
+	free(raw);
+
+	uint32_t stored = (pos + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	if(stored >= f->blocks){
+		free(stream);
+		free(lz);
+		return 0;
+	}
+	lz->length = f->length;
+	lz->magic = INODE_LZ_MAGIC;
+	lz->stored_blocks = stored;
+	f->blocks = stored;
+	f->stream = stream;
+	f->lz = lz;
+	return 0;
+}
+
+int main(int argc, char** argv){
+	src_file_t files[MAX_DENTRIES];
+	const char* src = NULL;
+	const char* out = NULL;
+	int inodes = DEFAULT_INODES;
+	int free_blocks = 0;
+	int journal = 0;
+	int extents = 0;
+	int compress = 0;
+	int opt, count, i;
+	uint32_t j;
+
+	while((opt = getopt(argc, argv, "d:o:n:f:jez")) != -1){
+		switch(opt){
+			case 'd': src = optarg; break;
+			case 'o': out = optarg; break;
+			case 'n': inodes = atoi(optarg); break;
+			case 'f': free_blocks = atoi(optarg); break;
+			case 'j': journal = 1; break;
+			case 'e': extents = 1; break;
+			case 'z': compress = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+	if(src == NULL || out == NULL || optind != argc || free_blocks < 0){
+		usage(argv[0]);
+	}
+
+	/* "." and "rtc" take two of the entries. */
+	count = scan_dir(src, files, MAX_DENTRIES - 2, extents ? MAX_FS_BLOCKS : MAX_FILE_BLOCKS);
+	if(count < 0){
+		return 1;
+	}
+	if(inodes <= count || inodes > MAX_FS_INODES){
+		fprintf(stderr, "mkfs391: need between %d and %d inodes for %d files\n", count + 1, MAX_FS_INODES, count);
+		return 1;
+	}
+	uint32_t raw_blocks = 0;
+	for(i = 0; i < count; i++){
+		raw_blocks += files[i].blocks;
+		if(compress && compress_file(&files[i]) != 0){
+			return 1;
+		}
+	}
+
+	uint32_t data_count = free_blocks + (journal ? JOURNAL_BLOCKS : 0);
+	for(i = 0; i < count; i++){
+		data_count += files[i].blocks;
+	}
+	if(data_count > MAX_FS_BLOCKS){
+		fprintf(stderr, "mkfs391: %u data blocks, the kernel tracks at most %d\n", data_count, MAX_FS_BLOCKS);
+		return 1;
+	}
+
+	size_t size = (size_t)(1 + inodes + data_count) * BLOCK_SIZE;
+	uint8_t* image = calloc(1, size);
+	boot_block_t* boot = (boot_block_t*)image;
+	uint8_t* data = image + (size_t)(1 + inodes) * BLOCK_SIZE;
+
+	boot->inode_count = inodes;
+	boot->data_count = data_count;
+	strcpy(boot->d_entries[0].fname, ".");
+	boot->d_entries[0].file_type = TYPE_DIR;
+	strcpy(boot->d_entries[1].fname, "rtc");
+	boot->d_entries[1].file_type = TYPE_RTC;
+	boot->dir_count = 2;
+
+	/* Files get inodes 1, 2, ... and their blocks back to back in the same order. */
+	uint32_t next_block = 0;
+	for(i = 0; i < count; i++){
+		dentry_t* entry = &boot->d_entries[boot->dir_count++];
+		inode_t* inode = (inode_t*)(image + (size_t)(1 + i + 1) * BLOCK_SIZE);
+
+		memcpy(entry->fname, files[i].name, strlen(files[i].name));
+		entry->file_type = TYPE_FILE;
+		entry->inode_num = i + 1;
+		inode->length = files[i].length;
+		if(files[i].lz != NULL){
+			files[i].lz->start = next_block;
+			memcpy(inode, files[i].lz, sizeof(inode_lz_t));
+			memcpy(data + (size_t)next_block * BLOCK_SIZE, files[i].stream, files[i].lz->offsets[(files[i].length + BLOCK_SIZE - 1) / BLOCK_SIZE]);
+		}
+		else if(extents){
+			inode_ext_t* ext = (inode_ext_t*)inode;
+			ext->magic = INODE_EXTENT_MAGIC;
+			if(files[i].blocks > 0){
+				ext->extent_count = 1;
+				ext->extents[0].start = next_block;
+				ext->extents[0].count = files[i].blocks;
+			}
+		}
+		else{
+			for(j = 0; j < files[i].blocks; j++){
+				inode->data_block_num[j] = next_block + j;
+			}
+		}
+		if(files[i].lz == NULL && load_file(&files[i], data + (size_t)next_block * BLOCK_SIZE) != 0){
+			return 1;
+		}
+		next_block += files[i].blocks;
+	}
+
+	/* The journal goes last so the free blocks sit right after the files. */
+	if(journal){
+		boot->journal_magic = JOURNAL_MAGIC;
+		boot->journal_start = data_count - JOURNAL_BLOCKS;
+		boot->journal_blocks = JOURNAL_BLOCKS;
+	}
+
+	FILE* img = fopen(out, "wb");
+	if(img == NULL || fwrite(image, 1, size, img) != size || fclose(img) != 0){
+		fprintf(stderr, "mkfs391: %s: write failed\n", out);
+		return 1;
+	}
+	printf("%s: %d files, %d inodes, %u data blocks (%u used, %d free, %d journal)\n", out, count, inodes,
+		data_count, next_block, free_blocks, journal ? JOURNAL_BLOCKS : 0);
+	if(compress){
+		printf("%s: files take %u blocks compressed, %u raw\n", out, next_block, raw_blocks);
+	}
+	return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * This file will contain the per-process accounting.
+ *
+ * Rather than sampling, every change of who or what runs charges the
+ * cycles since the previous change: a system call's entry charges user
+ * time, its exit charges system time, and a context switch, execute,
+ * halt or sleep charges whichever state the process was in. The counters
+ * live in the PCB, so they disappear with the process.
+ */
+#include "acct.h"
+#include "lib.h"
+#include "syscalls.h"
+
+static uint64_t acct_last = 0;		// TSC at the last charge.
+static uint32_t acct_serial = 0;
+
+/* uint64_t tsc()
+ * Inputs:      NONE
+ * Return Value: the time stamp counter */
+static inline uint64_t tsc(){
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* proc_stat_t* acct_current()
+ * Inputs:      NONE
+ * Return Value: statistics of the process whose kernel stack we are on,
+ *               NULL on the boot stack or in a free slot */
+proc_stat_t* acct_current(){
+	int32_t pid = get_process_number();
+
+	if(pid < 0 || pid >= MAX_PROCESSES || get_proc_arr()[pid] == FREE){
+		return NULL;
+	}
+	return &get_pcb_loc(pid)->stat;
+}
+
+/* void charge(proc_stat_t* stat)
+ * Inputs:      proc_stat_t* stat = process that has been running, may be NULL
+ * Return Value: NONE
+ * Function: adds the cycles since the last charge to its user or system time */
+static void charge(proc_stat_t* stat){
+	uint64_t now = tsc();
+	uint64_t cycles = now - acct_last;
+
+	acct_last = now;
+	if(stat == NULL){
+		return;
+	}
+	if(stat->asleep){
+		stat->sleep_cycles += cycles;
+	}
+	else if(stat->in_kernel){
+		stat->sys_cycles += cycles;
+	}
+	else{
+		stat->user_cycles += cycles;
+	}
+}
+
+/* void acct_syscall_enter()
+ * Inputs:      NONE
+ * Return Value: NONE */
+void acct_syscall_enter(){
+	proc_stat_t* stat = acct_current();
+
+	charge(stat);
+	if(stat != NULL){
+		stat->in_kernel++;
+		stat->syscalls++;
+	}
+}
+
+/* void acct_syscall_exit()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: a parent leaving execute gets here too once its child halts */
+void acct_syscall_exit(){
+	proc_stat_t* stat = acct_current();
+
+	charge(stat);
+	if(stat != NULL && stat->in_kernel){
+		stat->in_kernel--;
+	}
+}
+
+/* void acct_charge()
+ * Inputs:      NONE
+ * Return Value: NONE */
+void acct_charge(){
+	charge(acct_current());
+}
+
+/* void acct_switch()
+ * Inputs:      NONE
+ * Return Value: NONE */
+void acct_switch(){
+	proc_stat_t* stat = acct_current();
+
+	charge(stat);
+	if(stat != NULL){
+		stat->switches++;
+	}
+}
+
+/* void acct_sleep(uint32_t asleep)
+ * Inputs:      uint32_t asleep = 1 when the running process starts to halt, 0 when it stops
+ * Return Value: NONE */
+void acct_sleep(uint32_t asleep){
+	proc_stat_t* stat = acct_current();
+
+	charge(stat);
+	if(stat != NULL){
+		stat->asleep = asleep;
+	}
+}
+
+/* void acct_exec(proc_stat_t* child, const uint8_t* name)
+ * Inputs:      proc_stat_t* child = statistics of the new process
+ *              const uint8_t* name = its program
+ * Return Value: NONE
+ * Function: the child starts in user mode, never having entered a system call */
+void acct_exec(proc_stat_t* child, const uint8_t* name){
+	charge(acct_current());
+	memset(child, 0, sizeof(proc_stat_t));
+	strncpy((int8_t*)child->name, (const int8_t*)name, ACCT_NAME_LEN - 1);
+	child->serial = ++acct_serial;
+}
@@ -0,0 +1,61 @@
+#ifndef _ACCT_H
+#define _ACCT_H
+
+/* Per-process CPU and I/O accounting, kept in each PCB. */
+#include "types.h"
+
+#define ACCT_NAME_LEN		32
+
+#ifndef ASM
+/*
+ * Time is in TSC cycles (see clock_tsc_khz). Every cycle since the first
+ * execute is charged to exactly one process: as sleep time while it halts
+ * in timer_sleep, otherwise as user or system time depending on whether
+ * it was inside a system call. Interrupt handlers are charged to whatever
+ * they interrupted.
+ */
+typedef struct proc_stat{
+	uint64_t user_cycles;
+	uint64_t sys_cycles;
+	uint64_t sleep_cycles;			// The CPU was idle, waiting on this process's timer.
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint32_t switches;				// Times the scheduler took the CPU away.
+	uint32_t syscalls;
+	uint32_t page_faults;
+	uint32_t serial;				// Which execute started this process, counting from 1.
+	uint32_t in_kernel;				// System calls entered and not yet returned from.
+	uint32_t asleep;
+	uint8_t name[ACCT_NAME_LEN];
+} proc_stat_t;
+
+/* One process, as sys_procstat reports it. */
+typedef struct proc_info{
+	uint8_t pid;
+	uint8_t parent_pid;
+	uint8_t term;
+	uint8_t reserved;
+	proc_stat_t stat;
+} proc_info_t;
+
+/* Called by the syscall linkers in x86_desc.S on the way in and out. */
+void acct_syscall_enter();
+void acct_syscall_exit();
+
+/* Charges the running process up to now; called before the CPU leaves it. */
+void acct_charge();
+
+/* pit_handler's hook: charges the running process and counts a switch away from it. */
+void acct_switch();
+
+/* Charges the parent up to now and starts child's statistics. */
+void acct_exec(proc_stat_t* child, const uint8_t* name);
+
+/* Brackets the halt loop of timer_sleep: 1 before, 0 after. */
+void acct_sleep(uint32_t asleep);
+
+/* Returns the running process's statistics, NULL before the first execute. */
+proc_stat_t* acct_current();
+#endif		// ASM
+
+#endif
@@ -0,0 +1,354 @@
+/*
+ * This file will contain all functions relating to the ATA disk driver.
+ *
+ * Only the master drive on the primary channel is supported. Requests are
+ * issued one at a time; preemption is held off for the duration of a request
+ * so that no other process can touch the channel in between. When interrupts
+ * are enabled the caller sleeps until IRQ14 signals completion, otherwise
+ * (boot time, or inside a cli section) the status register is polled.
+ */
+#include "ata.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "i8259.h"
+#include "task_switch.h"
+#include "pci.h"
+#include "bootprof.h"
+
+#define ATA_POLL_LIMIT	1000000		// Status reads before we give up on the drive.
+#define ATA_HLT_LIMIT	10000		// Wakeups to wait for IRQ14 before falling back to polling.
+
+/* One physical region descriptor; the table must not cross a 64 kB boundary. */
+typedef struct prd{
+	uint32_t addr;
+	uint16_t bytes;			// 0 means 64 kB.
+	uint16_t flags;			// 0x8000 marks the last entry.
+} prd_t;
+
+static uint32_t ata_sectors = 0;		// 0 until a drive has been identified.
+static uint32_t bm_base = 0;			// Bus master I/O base, 0 if there is no controller.
+static int32_t ata_mode = ATA_MODE_PIO;
+static volatile uint32_t ata_irq_fired = 0;
+static volatile uint8_t ata_irq_status = 0;
+static volatile uint8_t bm_irq_status = 0;
+
+/*
+ * DMA can only target physical memory. The kernel's 4 MB page is identity
+ * mapped, so these statics can be handed straight to the controller; data
+ * is bounced through dma_buf on its way to or from the caller.
+ */
+static prd_t prd_table[1] __attribute__((aligned(8)));
+static uint8_t dma_buf[ATA_MAX_SECTORS * ATA_SECTOR_SIZE] __attribute__((aligned(65536)));
+
+/* Where ata_submit gathers a run of requests that are next to each other on disk. */
+static uint8_t merge_buf[ATA_MAX_SECTORS * ATA_SECTOR_SIZE];
+
+static int32_t ata_submit(blk_req_t* reqs, uint32_t count);
+
+blkdev_t ata_dev = {
+	.name = "ata",
+	.read = ata_read,
+	.write = ata_write,
+	.submit = ata_submit,
+	.max_sectors = ATA_MAX_SECTORS
+};
+
+/*
+ * Finds the IDE controller among the PCI devices and turns on bus mastering.
+ * RETURN: the bus master I/O base, 0 if there is none.
+ */
+static uint32_t find_bus_master(){
+	pci_dev_t* pdev = pci_find_class(PCI_CLASS_IDE);
+	if(pdev == NULL || !(pdev->bar[4] & PCI_BAR_IO)){
+		return 0;						// No controller, or not an I/O BAR; we only speak port I/O.
+	}
+	pci_enable(pdev);
+	return pdev->bar[4] & 0xFFFC;
+}
+
+/* Waits for BSY to clear. RETURN: the final status, or -1 on timeout. */
+static int32_t ata_wait_ready(){
+	uint32_t i;
+	for(i = 0; i < ATA_POLL_LIMIT; i++){
+		uint8_t status = inb(ATA_ALT_STATUS);
+		if(!(status & ATA_SR_BSY)){
+			return status;
+		}
+	}
+	return -1;
+}
+
+/* Waits for the drive to ask for (or offer) a sector of data. RETURN: 0 or -1. */
+static int32_t ata_wait_drq(){
+	int32_t status = ata_wait_ready();
+	if(status == -1 || (status & (ATA_SR_ERR | ATA_SR_DF)) || !(status & ATA_SR_DRQ)){
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Waits for the drive to finish the current step. If the caller had
+ * interrupts on, sleep until ata_handler runs; "sti; hlt" is atomic, so the
+ * interrupt cannot slip in between the check and the hlt. Otherwise poll.
+ * RETURN: 0 on success, -1 on a drive error or timeout.
+ */
+static int32_t ata_wait_irq(uint32_t flags){
+	uint32_t i;
+	if(flags & EFLAGS_IF){
+		for(i = 0; i < ATA_HLT_LIMIT && !ata_irq_fired; i++){
+			wait_for_interrupt();
+		}
+		if(ata_irq_fired){
+			ata_irq_fired = 0;
+			return (ata_irq_status & (ATA_SR_ERR | ATA_SR_DF)) ? -1 : 0;
+		}
+	}
+
+	int32_t status = ata_wait_ready();
+	if(status == -1 || (status & (ATA_SR_ERR | ATA_SR_DF))){
+		return -1;
+	}
+	(void)inb(ATA_STATUS);		// Acknowledge, in case the interrupt is still pending.
+	ata_irq_fired = 0;
+	return 0;
+}
+
+/* Selects the master drive and loads the LBA and sector count registers. */
+static void ata_setup(uint32_t lba, uint32_t count){
+	outb(0xE0 | ((lba >> 24) & 0x0F), ATA_DRIVE_HEAD);		// LBA mode, master drive.
+	outb(count & 0xFF, ATA_SECT_COUNT);						// 0 means 256, we never ask for that many.
+	outb(lba & 0xFF, ATA_LBA_LOW);
+	outb((lba >> 8) & 0xFF, ATA_LBA_MID);
+	outb((lba >> 16) & 0xFF, ATA_LBA_HIGH);
+}
+
+/*
+ * Sends IDENTIFY to the master drive, finds the bus master controller and
+ * installs the IRQ14 handler. DMA is used by default when available.
+ * RETURN: 0 if a drive was found, -1 otherwise.
+ */
+int32_t ata_init(){
+	uint16_t identify[ATA_SECTOR_SIZE / 2];
+	int32_t i;
+
+	/* Floating bus: nothing is attached to the primary channel. */
+	if(inb(ATA_STATUS) == 0xFF){
+		return -1;
+	}
+	outb(0xA0, ATA_DRIVE_HEAD);
+	outb(0, ATA_SECT_COUNT);
+	outb(0, ATA_LBA_LOW);
+	outb(0, ATA_LBA_MID);
+	outb(0, ATA_LBA_HIGH);
+	outb(ATA_CMD_IDENTIFY, ATA_COMMAND);
+	if(inb(ATA_STATUS) == 0 || ata_wait_drq() == -1){
+		return -1;
+	}
+	for(i = 0; i < ATA_SECTOR_SIZE / 2; i++){
+		identify[i] = inw(ATA_DATA);
+	}
+	(void)inb(ATA_STATUS);
+	ata_sectors = identify[60] | (identify[61] << 16);		// Words 60-61: LBA28 capacity.
+	ata_dev.sectors = ata_sectors;
+
+	bm_base = find_bus_master();
+	if(bm_base){
+		prd_table[0].addr = (uint32_t)dma_buf;
+		outl((uint32_t)prd_table, bm_base + BM_PRDT);
+		ata_mode = ATA_MODE_DMA;
+	}
+
+	/* Create the disk's entry in the IDT. */
+	idt[ATA_IDT_VEC].size = 0x1;			// This is a 32-bit gate.
+	idt[ATA_IDT_VEC].seg_selector = KERNEL_CS;
+	idt[ATA_IDT_VEC].reserved1 = 0x1;		// Set these reserved bits to signal to the IDT that this is an interrupt.
+	idt[ATA_IDT_VEC].reserved2 = 0x1;
+	SET_IDT_ENTRY(idt[ATA_IDT_VEC], ata_linker);
+	idt[ATA_IDT_VEC].present = 0x1;			// Mark the interrupt as present.
+
+	if(!boot_fast){
+		printf("ATA disk: %d sectors, %s\n", ata_sectors, bm_base ? "DMA" : "PIO only");
+	}
+	return 0;
+}
+
+/*
+ * IRQ14. Reading the status register deasserts the interrupt; the bus
+ * master status is saved and its interrupt bit cleared as well.
+ */
+void ata_handler(){
+	if(bm_base){
+		bm_irq_status = inb(bm_base + BM_STATUS);
+		outb(bm_irq_status | BM_SR_IRQ, bm_base + BM_STATUS);		// Write 1 to clear.
+	}
+	ata_irq_status = inb(ATA_STATUS);
+	ata_irq_fired = 1;
+	send_eoi(ATA_IRQ);
+}
+
+/* RETURN: 0 on success, -1 if DMA was asked for but there is no controller. */
+int32_t ata_set_mode(int32_t mode){
+	if(mode == ATA_MODE_DMA && !bm_base){
+		return -1;
+	}
+	if(mode != ATA_MODE_DMA && mode != ATA_MODE_PIO){
+		return -1;
+	}
+	ata_mode = mode;
+	return 0;
+}
+
+int32_t ata_get_mode(){
+	return ata_mode;
+}
+
+uint32_t ata_sector_count(){
+	return ata_sectors;
+}
+
+/* Runs one PIO read or write. Called with interrupts off. */
+static int32_t ata_pio(uint32_t lba, uint32_t count, uint16_t* buf, uint32_t write, uint32_t flags){
+	uint32_t sect, i;
+
+	ata_setup(lba, count);
+	outb(write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO, ATA_COMMAND);
+	for(sect = 0; sect < count; sect++){
+		if(write){
+			/* The drive asks for each sector, then interrupts once it is on disk. */
+			if(ata_wait_drq() == -1){
+				return -1;
+			}
+			for(i = 0; i < ATA_SECTOR_SIZE / 2; i++){
+				outw(*buf++, ATA_DATA);
+			}
+			if(ata_wait_irq(flags) == -1){
+				return -1;
+			}
+		}
+		else{
+			/* One interrupt per sector, raised once the data is ready. */
+			if(ata_wait_irq(flags) == -1 || ata_wait_drq() == -1){
+				return -1;
+			}
+			for(i = 0; i < ATA_SECTOR_SIZE / 2; i++){
+				*buf++ = inw(ATA_DATA);
+			}
+		}
+	}
+	if(write){
+		outb(ATA_CMD_FLUSH, ATA_COMMAND);
+		return ata_wait_irq(flags);
+	}
+	return 0;
+}
+
+/* Runs one bus master DMA transfer through dma_buf. Called with interrupts off. */
+static int32_t ata_dma(uint32_t lba, uint32_t count, uint32_t write, uint32_t flags){
+	prd_table[0].bytes = count * ATA_SECTOR_SIZE;
+	prd_table[0].flags = 0x8000;
+
+	outb(0, bm_base + BM_COMMAND);
+	outb(write ? 0 : BM_CMD_READ, bm_base + BM_COMMAND);
+	outb(BM_SR_ERR | BM_SR_IRQ, bm_base + BM_STATUS);			// Clear stale status.
+	ata_setup(lba, count);
+	outb(write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA, ATA_COMMAND);
+	outb((write ? 0 : BM_CMD_READ) | BM_CMD_START, bm_base + BM_COMMAND);
+
+	int32_t ret = ata_wait_irq(flags);
+	uint8_t bm_status = inb(bm_base + BM_STATUS);
+	outb(0, bm_base + BM_COMMAND);								// Stop the engine.
+	outb(BM_SR_ERR | BM_SR_IRQ, bm_base + BM_STATUS);
+	if(ret == -1 || (bm_status & BM_SR_ERR)){
+		return -1;
+	}
+	if(write){
+		outb(ATA_CMD_FLUSH, ATA_COMMAND);
+		return ata_wait_irq(flags);
+	}
+	return 0;
+}
+
+/* Shared entry point of ata_read and ata_write. */
+static int32_t ata_request(uint32_t lba, uint32_t count, void* buf, uint32_t write){
+	uint32_t flags;
+	int32_t ret;
+
+	if(buf == NULL || count == 0 || count > ATA_MAX_SECTORS || lba + count > ata_sectors){
+		return -1;
+	}
+
+	preempt_disable();
+	cli_and_save(flags);
+	ata_irq_fired = 0;
+	if(ata_mode == ATA_MODE_DMA){
+		if(write){
+			memcpy(dma_buf, buf, count * ATA_SECTOR_SIZE);
+		}
+		ret = ata_dma(lba, count, write, flags);
+		if(!write && ret == 0){
+			memcpy(buf, dma_buf, count * ATA_SECTOR_SIZE);
+		}
+	}
+	else{
+		ret = ata_pio(lba, count, (uint16_t*)buf, write, flags);
+	}
+	restore_flags(flags);
+	preempt_enable();
+	return ret;
+}
+
+/* int32_t ata_read(uint32_t lba, uint32_t count, void* buf)
+ * Inputs:      uint32_t lba = first sector
+ *              uint32_t count = number of sectors, 1 to ATA_MAX_SECTORS
+ *              void* buf = destination, count * 512 bytes
+ * Return Value: 0 if success else -1 */
+int32_t ata_read(uint32_t lba, uint32_t count, void* buf){
+	return ata_request(lba, count, buf, 0);
+}
+
+/* int32_t ata_write(uint32_t lba, uint32_t count, const void* buf)
+ * Inputs:      uint32_t lba = first sector
+ *              uint32_t count = number of sectors, 1 to ATA_MAX_SECTORS
+ *              const void* buf = source, count * 512 bytes
+ * Return Value: 0 if success else -1
+ * Function: returns once the drive has flushed its write cache */
+int32_t ata_write(uint32_t lba, uint32_t count, const void* buf){
+	return ata_request(lba, count, (void*)buf, 1);
+}
+
+/* int32_t ata_submit(blk_req_t* reqs, uint32_t count)
+ * Inputs:      blk_req_t* reqs = reads to perform
+ *              uint32_t count = number of entries in reqs
+ * Return Value: 0 if every read succeeded else -1
+ * Function: the drive only takes one command at a time, so what we can do
+ * is cut the number of commands: requests for adjacent sectors are merged
+ * into one transfer of up to ATA_MAX_SECTORS and copied apart afterwards. */
+static int32_t ata_submit(blk_req_t* reqs, uint32_t count){
+	uint32_t i, j, run, sectors;
+
+	for(i = 0; i < count; i += run){
+		sectors = reqs[i].count;
+		for(run = 1; i + run < count; run++){
+			blk_req_t* next = &reqs[i + run];
+			if(next->lba != reqs[i].lba + sectors || sectors + next->count > ATA_MAX_SECTORS){
+				break;
+			}
+			sectors += next->count;
+		}
+		if(run == 1){
+			if(ata_read(reqs[i].lba, reqs[i].count, reqs[i].buf) == -1){
+				return -1;
+			}
+			continue;
+		}
+		if(ata_read(reqs[i].lba, sectors, merge_buf) == -1){
+			return -1;
+		}
+		for(j = 0; j < run; j++){
+			memcpy(reqs[i + j].buf, merge_buf + (reqs[i + j].lba - reqs[i].lba) * ATA_SECTOR_SIZE,
+				   reqs[i + j].count * ATA_SECTOR_SIZE);
+		}
+	}
+	return 0;
+}
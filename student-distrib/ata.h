@@ -0,0 +1,81 @@
+#ifndef _ATA_H
+#define _ATA_H
+
+/* Driver for the master drive on the primary IDE channel (QEMU's -hda). */
+#include "types.h"
+#include "blkdev.h"
+
+/* Primary channel command block, control block and IRQ. */
+#define ATA_IO_BASE			0x1F0
+#define ATA_DATA			(ATA_IO_BASE + 0)
+#define ATA_ERROR			(ATA_IO_BASE + 1)
+#define ATA_SECT_COUNT		(ATA_IO_BASE + 2)
+#define ATA_LBA_LOW			(ATA_IO_BASE + 3)
+#define ATA_LBA_MID			(ATA_IO_BASE + 4)
+#define ATA_LBA_HIGH		(ATA_IO_BASE + 5)
+#define ATA_DRIVE_HEAD		(ATA_IO_BASE + 6)
+#define ATA_STATUS			(ATA_IO_BASE + 7)		// Reading it acknowledges the interrupt.
+#define ATA_COMMAND			(ATA_IO_BASE + 7)
+#define ATA_ALT_STATUS		0x3F6					// Same as ATA_STATUS without the acknowledge.
+#define ATA_IRQ				14
+#define ATA_IDT_VEC			0x2E					// ICW2_SLAVE + (ATA_IRQ - 8).
+
+/* Status register bits. */
+#define ATA_SR_ERR			0x01
+#define ATA_SR_DRQ			0x08
+#define ATA_SR_DF			0x20
+#define ATA_SR_BSY			0x80
+
+/* Commands (28-bit LBA). */
+#define ATA_CMD_READ_PIO	0x20
+#define ATA_CMD_WRITE_PIO	0x30
+#define ATA_CMD_READ_DMA	0xC8
+#define ATA_CMD_WRITE_DMA	0xCA
+#define ATA_CMD_FLUSH		0xE7
+#define ATA_CMD_IDENTIFY	0xEC
+
+/* Bus master IDE registers, offsets from PCI BAR4. */
+#define BM_COMMAND			0x0
+#define BM_STATUS			0x2
+#define BM_PRDT				0x4
+#define BM_CMD_START		0x01
+#define BM_CMD_READ			0x08		// Device to memory.
+#define BM_SR_ERR			0x02
+#define BM_SR_IRQ			0x04
+
+#define PCI_CLASS_IDE		0x0101		// Mass storage controller, IDE.
+
+#define ATA_SECTOR_SIZE		512
+#define ATA_MAX_SECTORS		128			// Largest single request: one 64 kB DMA buffer.
+
+#define ATA_MODE_PIO		0
+#define ATA_MODE_DMA		1
+
+#ifndef ASM
+/* Assembly linkage for IRQ14. */
+extern void ata_linker();
+
+/* The drive as seen by the filesystem, valid once ata_init succeeds. */
+extern blkdev_t ata_dev;
+
+/* Probes the drive and the bus master controller and hooks IRQ14. */
+int32_t ata_init();
+
+/* Interrupt handler for IRQ14. */
+void ata_handler();
+
+/* Selects PIO or DMA transfers. Fails if DMA is not available. */
+int32_t ata_set_mode(int32_t mode);
+
+/* Returns the current transfer mode. */
+int32_t ata_get_mode();
+
+/* Number of 512 byte sectors on the drive, 0 if there is no drive. */
+uint32_t ata_sector_count();
+
+/* Reads/writes count sectors (at most ATA_MAX_SECTORS) starting at lba. */
+int32_t ata_read(uint32_t lba, uint32_t count, void* buf);
+int32_t ata_write(uint32_t lba, uint32_t count, const void* buf);
+#endif		// ASM
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ * This file will contain all functions relating to the block buffer cache.
+ *
+ * Blocks are found through a small hash table and kept on one LRU list; a
+ * miss recycles the least recently used buffer nobody is holding. Writes go
+ * straight through to the disk, so a cached block is never newer than the
+ * disk and can be dropped at any time. Every function runs with preemption
+ * held off, which keeps a half-read buffer from being seen by another
+ * process; nothing here is touched from interrupt context.
+ */
+#include "bcache.h"
+#include "lib.h"
+#include "task_switch.h"
+
+static bcache_buf_t bufs[BCACHE_NUM_BUFS];
+static bcache_buf_t* hash_table[BCACHE_HASH_SIZE];
+static bcache_buf_t* lru_head;		// Most recently used.
+static bcache_buf_t* lru_tail;		// Least recently used.
+static bcache_stat_t stats;
+static blkdev_t* dev = NULL;			// The disk the cached blocks come from.
+
+#define HASH(block)		((block) & (BCACHE_HASH_SIZE - 1))
+
+/* Unlinks buf from the LRU list. */
+static void lru_remove(bcache_buf_t* buf){
+	if(buf->lru_prev){
+		buf->lru_prev->lru_next = buf->lru_next;
+	}
+	else{
+		lru_head = buf->lru_next;
+	}
+	if(buf->lru_next){
+		buf->lru_next->lru_prev = buf->lru_prev;
+	}
+	else{
+		lru_tail = buf->lru_prev;
+	}
+}
+
+/* Makes buf the most recently used buffer. */
+static void lru_push_head(bcache_buf_t* buf){
+	buf->lru_prev = NULL;
+	buf->lru_next = lru_head;
+	if(lru_head){
+		lru_head->lru_prev = buf;
+	}
+	lru_head = buf;
+	if(lru_tail == NULL){
+		lru_tail = buf;
+	}
+}
+
+/* Makes buf the first candidate for eviction. */
+static void lru_push_tail(bcache_buf_t* buf){
+	buf->lru_next = NULL;
+	buf->lru_prev = lru_tail;
+	if(lru_tail){
+		lru_tail->lru_next = buf;
+	}
+	lru_tail = buf;
+	if(lru_head == NULL){
+		lru_head = buf;
+	}
+}
+
+/* RETURN: the valid buffer holding block, NULL if it is not cached. */
+static bcache_buf_t* hash_lookup(uint32_t block){
+	bcache_buf_t* buf;
+	for(buf = hash_table[HASH(block)]; buf != NULL; buf = buf->hash_next){
+		if(buf->block == block && buf->valid){
+			return buf;
+		}
+	}
+	return NULL;
+}
+
+/* Takes buf out of its hash chain, if it is in one. */
+static void hash_remove(bcache_buf_t* buf){
+	bcache_buf_t** link;
+	if(!buf->valid){
+		return;
+	}
+	for(link = &hash_table[HASH(buf->block)]; *link != NULL; link = &(*link)->hash_next){
+		if(*link == buf){
+			*link = buf->hash_next;
+			break;
+		}
+	}
+	buf->valid = 0;
+}
+
+/* Adds a freshly read buf to its hash chain. */
+static void hash_insert(bcache_buf_t* buf){
+	buf->hash_next = hash_table[HASH(buf->block)];
+	hash_table[HASH(buf->block)] = buf;
+	buf->valid = 1;
+}
+
+/*
+ * Finds the least recently used buffer nobody holds and empties it.
+ * RETURN: the buffer (still on the LRU list), NULL if all are held.
+ */
+static bcache_buf_t* evict(){
+	bcache_buf_t* buf;
+	for(buf = lru_tail; buf != NULL; buf = buf->lru_prev){
+		if(buf->refs == 0){
+			if(buf->valid){
+				stats.evictions++;
+			}
+			hash_remove(buf);
+			buf->prefetched = 0;
+			return buf;
+		}
+	}
+	return NULL;
+}
+
+/* Puts every buffer on the LRU list, empty, and zeroes the counters. */
+void bcache_init(blkdev_t* disk){
+	uint32_t i;
+
+	dev = disk;
+	memset(bufs, 0, sizeof(bufs));
+	memset(hash_table, 0, sizeof(hash_table));
+	memset(&stats, 0, sizeof(stats));
+	lru_head = NULL;
+	lru_tail = NULL;
+	for(i = 0; i < BCACHE_NUM_BUFS; i++){
+		lru_push_tail(&bufs[i]);
+	}
+}
+
+/* uint8_t* bcache_get(uint32_t block)
+ * Inputs:      uint32_t block = block number within the image
+ * Return Value: the block's data, NULL if every buffer is held or the read failed
+ * Function: every bcache_get must be paired with a bcache_put */
+uint8_t* bcache_get(uint32_t block){
+	bcache_buf_t* buf;
+
+	preempt_disable();
+	buf = hash_lookup(block);
+	if(buf != NULL){
+		stats.hits++;
+		if(buf->prefetched){
+			stats.readahead_hits++;
+			buf->prefetched = 0;
+		}
+	}
+	else{
+		stats.misses++;
+		buf = evict();
+		if(buf == NULL){
+			preempt_enable();
+			return NULL;
+		}
+		buf->block = block;
+		if(dev->read(block * SECTORS_PER_BLOCK, SECTORS_PER_BLOCK, buf->data) == -1){
+			lru_remove(buf);
+			lru_push_tail(buf);
+			preempt_enable();
+			return NULL;
+		}
+		hash_insert(buf);
+	}
+	buf->refs++;
+	lru_remove(buf);
+	lru_push_head(buf);
+	preempt_enable();
+	return buf->data;
+}
+
+/* void bcache_put(uint8_t* data, uint32_t dirty)
+ * Inputs:      uint8_t* data = pointer returned by bcache_get (NULL is ignored)
+ *              uint32_t dirty = nonzero if the block was modified
+ * Return Value: NONE
+ * Function: writes the block through to disk if dirty, then drops our hold.
+ * If the write fails the block is dropped so the stale disk copy is what
+ * the next reader sees. */
+void bcache_put(uint8_t* data, uint32_t dirty){
+	bcache_buf_t* buf = (bcache_buf_t*)data;
+
+	if(buf == NULL){
+		return;
+	}
+	preempt_disable();
+	if(dirty){
+		stats.writes++;
+		if(dev->write(buf->block * SECTORS_PER_BLOCK, SECTORS_PER_BLOCK, buf->data) == -1){
+			hash_remove(buf);
+		}
+	}
+	buf->refs--;
+	preempt_enable();
+}
+
+/* void bcache_prefetch(const uint32_t* blocks, uint32_t count)
+ * Inputs:      const uint32_t* blocks = block numbers, in the order they will be read
+ *              uint32_t count = number of entries in blocks, at most BCACHE_RA_MAX
+ * Return Value: NONE
+ * Function: reads the blocks that are not cached yet straight into cache
+ * buffers, handing them to the disk driver as one submission so it can
+ * overlap or merge them. The blocks are not held afterwards; they are
+ * marked as prefetched so the first real use can be counted as a
+ * read-ahead hit. */
+void bcache_prefetch(const uint32_t* blocks, uint32_t count){
+	blk_req_t reqs[BCACHE_RA_MAX];
+	bcache_buf_t* claimed[BCACHE_RA_MAX];
+	uint32_t i, n = 0;
+
+	if(count > BCACHE_RA_MAX){
+		count = BCACHE_RA_MAX;
+	}
+	preempt_disable();
+	for(i = 0; i < count; i++){
+		if(hash_lookup(blocks[i]) != NULL){
+			continue;
+		}
+		bcache_buf_t* buf = evict();
+		if(buf == NULL){
+			break;
+		}
+		buf->refs = 1;					// Keep evict from handing it out twice.
+		buf->block = blocks[i];
+		claimed[n] = buf;
+		reqs[n].lba = blocks[i] * SECTORS_PER_BLOCK;
+		reqs[n].count = SECTORS_PER_BLOCK;
+		reqs[n].buf = buf->data;
+		n++;
+	}
+
+	if(n > 0){
+		int32_t ok = (dev->submit(reqs, n) == 0);
+		for(i = 0; i < n; i++){
+			claimed[i]->refs = 0;
+			if(ok){
+				claimed[i]->prefetched = 1;
+				hash_insert(claimed[i]);
+				lru_remove(claimed[i]);
+				lru_push_head(claimed[i]);
+				stats.readahead++;
+			}
+		}
+	}
+	preempt_enable();
+}
+
+/* void bcache_stats(bcache_stat_t* st, uint32_t flags)
+ * Inputs:      bcache_stat_t* st = destination, may be NULL
+ *              uint32_t flags = CACHE_RESET and/or CACHE_DROP
+ * Return Value: NONE */
+void bcache_stats(bcache_stat_t* st, uint32_t flags){
+	uint32_t i;
+
+	preempt_disable();
+	if(st != NULL){
+		*st = stats;
+	}
+	if(flags & CACHE_RESET){
+		memset(&stats, 0, sizeof(stats));
+	}
+	if(flags & CACHE_DROP){
+		for(i = 0; i < BCACHE_NUM_BUFS; i++){
+			if(bufs[i].refs == 0){
+				hash_remove(&bufs[i]);
+				bufs[i].prefetched = 0;
+			}
+		}
+	}
+	preempt_enable();
+}
@@ -0,0 +1,60 @@
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+/* Buffer cache for filesystem blocks that live on a disk (see blkdev.h). */
+#include "types.h"
+#include "file.h"
+#include "blkdev.h"
+
+#define BCACHE_NUM_BUFS		128		// 512 kB of cached blocks.
+#define BCACHE_HASH_SIZE	64		// Hash buckets (power of 2).
+#define BCACHE_RA_MIN		2		// First read-ahead window, in blocks.
+#define BCACHE_RA_MAX		16		// Largest read-ahead window, in blocks.
+
+/* Flags for sys_cachestat. */
+#define CACHE_RESET			0x1		// Zero the counters after copying them out.
+#define CACHE_DROP			0x2		// Forget every block nobody is holding.
+
+#ifndef ASM
+/*
+ * One cached block. data comes first so the pointer handed out by
+ * bcache_get is also the buffer's address.
+ */
+typedef struct bcache_buf{
+	uint8_t data[FOUR_KB];
+	uint32_t block;
+	uint32_t refs;					// Holders between bcache_get and bcache_put.
+	uint32_t valid;					// 0 until the block has been read.
+	uint32_t prefetched;			// Brought in by read-ahead and not used yet.
+	struct bcache_buf* hash_next;
+	struct bcache_buf* lru_prev;	// Towards the most recently used end.
+	struct bcache_buf* lru_next;
+} bcache_buf_t;
+
+/* Counters returned by sys_cachestat. */
+typedef struct bcache_stat{
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t readahead;				// Blocks read ahead of time.
+	uint32_t readahead_hits;		// Read-ahead blocks that were later used.
+	uint32_t evictions;
+	uint32_t writes;
+} bcache_stat_t;
+
+/* Empties the cache, zeroes the counters and caches blocks of disk from now on. */
+void bcache_init(blkdev_t* disk);
+
+/* Returns the block's data, reading it on a miss. NULL on failure. */
+uint8_t* bcache_get(uint32_t block);
+
+/* Releases a block from bcache_get, writing it through if dirty. */
+void bcache_put(uint8_t* data, uint32_t dirty);
+
+/* Reads any of the given blocks that are not cached yet, without holding them. */
+void bcache_prefetch(const uint32_t* blocks, uint32_t count);
+
+/* Copies out the counters, then applies CACHE_RESET and CACHE_DROP. */
+void bcache_stats(bcache_stat_t* st, uint32_t flags);
+#endif		// ASM
+
+#endif
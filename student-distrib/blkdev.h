@@ -0,0 +1,39 @@
+#ifndef _BLKDEV_H
+#define _BLKDEV_H
+
+/*
+ * A disk the filesystem can live on. Like fot_t for open files, each driver
+ * fills in one of these and the filesystem and buffer cache only ever call
+ * through it.
+ */
+#include "types.h"
+
+#define BLK_SECTOR_SIZE		512
+
+#ifndef ASM
+/* One read for blkdev_t.submit. buf must be in the kernel's 4 MB page. */
+typedef struct blk_req{
+	uint32_t lba;
+	uint32_t count;			// Sectors.
+	void* buf;
+} blk_req_t;
+
+typedef struct blkdev{
+	const int8_t* name;
+	uint32_t sectors;		// Capacity in 512 byte sectors.
+
+	/* Single transfers of up to max_sectors sectors. 0 on success, -1 on failure. */
+	int32_t (*read)(uint32_t lba, uint32_t count, void* buf);
+	int32_t (*write)(uint32_t lba, uint32_t count, const void* buf);
+
+	/*
+	 * Reads every request in reqs and returns once all have completed.
+	 * Drivers start as many at once as the hardware allows.
+	 * RETURN: 0 if all succeeded, -1 otherwise.
+	 */
+	int32_t (*submit)(blk_req_t* reqs, uint32_t count);
+	uint32_t max_sectors;
+} blkdev_t;
+#endif		// ASM
+
+#endif
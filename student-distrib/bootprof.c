@@ -0,0 +1,131 @@
+/*
+ * This file will contain the boot profile.
+ *
+ * entry() and the first execute mark the end of each phase with the TSC.
+ * Once the shell first waits for input the whole profile goes out on
+ * COM1 as "key value" lines, like the benchmark programs print:
+ *
+ *     boot_fast 1
+ *     boot_idt_us 12
+ *     ...
+ *     boot_time_to_prompt_us 53419
+ *
+ * Each boot_<phase>_us is the time since the previous mark. The TSC is
+ * only calibrated in the clock phase, so cycles are turned into time when
+ * the profile is written.
+ */
+#include "bootprof.h"
+#include "lib.h"
+#include "clock.h"
+#include "serial.h"
+
+#ifdef FAST_BOOT
+uint32_t boot_fast = 1;
+#else
+uint32_t boot_fast = 0;
+#endif
+
+static uint64_t boot_tsc[BOOT_PHASES];
+
+static const int8_t* phase_names[BOOT_PHASES] = {
+	"entry", "multiboot", "gdt", "idt", "pic", "keyboard", "serial", "rtc",
+	"disk", "pit", "paging", "clock", "terminal", "user", "prompt"
+};
+
+/* void boot_parse_cmdline(const int8_t* cmdline)
+ * Inputs:      const int8_t* cmdline = kernel command line, may be NULL
+ * Return Value: NONE
+ * Function: looks for BOOT_FASTBOOT_ARG as a whole word */
+void boot_parse_cmdline(const int8_t* cmdline){
+	uint32_t len = strlen(BOOT_FASTBOOT_ARG);
+
+	if(cmdline == NULL){
+		return;
+	}
+	while(*cmdline != '\0'){
+		while(*cmdline == ' '){
+			cmdline++;
+		}
+		if(strncmp(cmdline, BOOT_FASTBOOT_ARG, len) == 0 &&
+		   (cmdline[len] == ' ' || cmdline[len] == '\0')){
+			boot_fast = 1;
+			return;
+		}
+		while(*cmdline != ' ' && *cmdline != '\0'){
+			cmdline++;
+		}
+	}
+}
+
+/* uint32_t cycles_to_us(uint64_t cycles)
+ * Inputs:      uint64_t cycles = an interval, under 2^32 microseconds
+ * Return Value: the interval in microseconds
+ * Function: divides by the TSC rate in MHz */
+static uint32_t cycles_to_us(uint64_t cycles){
+	uint32_t mhz = clock_tsc_khz() / 1000;
+	uint32_t rem;
+
+	if(mhz == 0){
+		return 0;
+	}
+	return div64(cycles, mhz, &rem);
+}
+
+/* void put_value(const int8_t* key, const int8_t* suffix, uint32_t value)
+ * Inputs:      const int8_t* key, suffix = name of the value, written back to back
+ *              uint32_t value = the value
+ * Return Value: NONE */
+static void put_value(const int8_t* key, const int8_t* suffix, uint32_t value){
+	serial_puts(key);
+	serial_puts(suffix);
+	serial_putc(' ');
+	serial_putu(value, 10);
+	serial_putc('\n');
+}
+
+/* void boot_report()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: writes the profile to COM1 */
+static void boot_report(){
+	uint32_t i;
+	uint64_t prev = boot_tsc[BOOT_ENTRY];
+
+	put_value("boot_fast", "", boot_fast);
+	put_value("boot_tsc_khz", "", clock_tsc_khz());
+	for(i = BOOT_ENTRY + 1; i < BOOT_PHASES; i++){
+		serial_puts("boot_");
+		put_value(phase_names[i], "_us", cycles_to_us(boot_tsc[i] - prev));
+		prev = boot_tsc[i];
+	}
+	put_value("boot_time_to_prompt_us", "", cycles_to_us(boot_cycles(BOOT_PROMPT)));
+}
+
+/* void boot_mark(uint32_t phase)
+ * Inputs:      uint32_t phase = the boot_phase that just ended
+ * Return Value: NONE
+ * Function: phases skipped on the way (none today) count as ending with the next one */
+void boot_mark(uint32_t phase){
+	uint32_t i;
+
+	if(phase >= BOOT_PHASES || boot_tsc[phase] != 0){
+		return;
+	}
+	boot_tsc[phase] = clock_tsc();
+	for(i = phase; i > BOOT_ENTRY && boot_tsc[i - 1] == 0; i--){
+		boot_tsc[i - 1] = boot_tsc[phase];
+	}
+	if(phase == BOOT_PROMPT){
+		boot_report();
+	}
+}
+
+/* uint64_t boot_cycles(uint32_t phase)
+ * Inputs:      uint32_t phase = a boot_phase
+ * Return Value: TSC cycles from entry() to its end, 0 if not reached yet */
+uint64_t boot_cycles(uint32_t phase){
+	if(phase >= BOOT_PHASES || boot_tsc[phase] == 0){
+		return 0;
+	}
+	return boot_tsc[phase] - boot_tsc[BOOT_ENTRY];
+}
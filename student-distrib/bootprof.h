@@ -0,0 +1,50 @@
+#ifndef _BOOTPROF_H
+#define _BOOTPROF_H
+
+/* TSC timestamps of the boot phases, from the multiboot handoff to the first prompt. */
+#include "types.h"
+
+#define BOOT_FASTBOOT_ARG	"fastboot"	// Multiboot command line word that turns on fast boot.
+
+#ifndef ASM
+/* Each phase is marked when it ends; BOOT_ENTRY is the start of entry(). */
+enum boot_phase{
+	BOOT_ENTRY,
+	BOOT_MULTIBOOT,			// Multiboot information read (and printed, unless fast).
+	BOOT_GDT,				// LDT and TSS descriptors.
+	BOOT_IDT,
+	BOOT_PIC,
+	BOOT_KEYBOARD,
+	BOOT_SERIAL,
+	BOOT_RTC,
+	BOOT_DISK,				// PCI scan, virtio-blk, ATA and the filesystem mount.
+	BOOT_PIT,
+	BOOT_PAGING,
+	BOOT_CLOCK,				// TSC calibration.
+	BOOT_TERMINAL,
+	BOOT_USER,				// The iret to the first user instruction.
+	BOOT_PROMPT,			// The first terminal read: the shell is waiting at its prompt.
+	BOOT_PHASES
+};
+
+/*
+ * Nonzero when booting with BOOT_FASTBOOT_ARG on the command line (or
+ * built with -DFAST_BOOT): the diagnostic printing of entry() and the
+ * device drivers is skipped.
+ */
+extern uint32_t boot_fast;
+
+/* Sets boot_fast from the multiboot command line, which may be NULL. */
+void boot_parse_cmdline(const int8_t* cmdline);
+
+/*
+ * Records the TSC for phase the first time it is reached; later calls
+ * do nothing. Reaching BOOT_PROMPT writes the profile to the serial port.
+ */
+void boot_mark(uint32_t phase);
+
+/* Cycles from entry() to the end of phase, 0 if it has not been reached. */
+uint64_t boot_cycles(uint32_t phase);
+#endif		// ASM
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * This file will contain the kernel clock.
+ *
+ * At boot the TSC is timed against PIT channel 2, which is gated by port
+ * 0x61 and raises its output when the count runs out, so no interrupt is
+ * needed. One 10 ms run is enough: interrupts are off and the polling
+ * loop only reads a port, so a run is off by about one port read (near
+ * a microsecond) out of 10 ms. From then on the clock
+ * is the TSC scaled to nanoseconds by a multiply and a shift.
+ */
+#include "clock.h"
+#include "lib.h"
+#include "page.h"
+#include "bootprof.h"
+
+#define PIT_CH2_DATA		0x42
+#define PIT_CMD				0x43
+#define PIT_GATE_PORT		0x61
+#define PIT_GATE			0x01		// Starts channel 2 counting.
+#define PIT_SPEAKER			0x02		// Kept off.
+#define PIT_OUT2			0x20		// Channel 2 output, high at terminal count.
+#define PIT_CH2_MODE0		0xB0		// Channel 2, low then high byte, interrupt on terminal count.
+#define CALIBRATE_MS		10
+#define MIN_TSC_KHZ			4000		// Keeps mult within 32 bits.
+
+/* The page user programs read. It fills a page of its own so no other kernel data is exposed. */
+static union{
+	clock_page_t page;
+	uint8_t bytes[FOUR_KB];
+} clock_mem __attribute__((aligned(FOUR_KB)));
+static uint64_t tsc_base;
+
+/* uint64_t clock_tsc()
+ * Inputs:      NONE
+ * Return Value: the time stamp counter */
+uint64_t clock_tsc(){
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* uint32_t div64(uint64_t n, uint32_t d, uint32_t* rem)
+ * Inputs:      uint64_t n = dividend, n / d must fit in 32 bits
+ *              uint32_t d = divisor
+ *              uint32_t* rem = set to the remainder
+ * Return Value: n / d
+ * Function: one divl; the kernel has no 64-bit division routine */
+uint32_t div64(uint64_t n, uint32_t d, uint32_t* rem){
+	uint32_t q, r;
+	asm("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+	*rem = r;
+	return q;
+}
+
+/* uint32_t calibrate_once()
+ * Inputs:      NONE
+ * Return Value: TSC cycles in CALIBRATE_MS milliseconds
+ * Function: counts PIT_HZ / 1000 * CALIBRATE_MS PIT ticks on channel 2 */
+static uint32_t calibrate_once(){
+	uint32_t count = PIT_HZ / 1000 * CALIBRATE_MS;
+
+	outb((inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE, PIT_GATE_PORT);
+	outb(PIT_CH2_MODE0, PIT_CMD);
+	outb(count & 0xFF, PIT_CH2_DATA);
+	outb(count >> 8, PIT_CH2_DATA);
+	uint64_t start = clock_tsc();
+	while(!(inb(PIT_GATE_PORT) & PIT_OUT2));
+	return (uint32_t)(clock_tsc() - start);
+}
+
+/* void clock_init()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: calibrates the TSC, starts the clock at 0 and maps the clock
+ * page read-only for user programs */
+void clock_init(){
+	uint32_t rem;
+	uint32_t cycles = calibrate_once();
+
+	outb(inb(PIT_GATE_PORT) & ~(PIT_GATE | PIT_SPEAKER), PIT_GATE_PORT);
+
+	clock_mem.page.tsc_khz = cycles / CALIBRATE_MS;
+	if(clock_mem.page.tsc_khz < MIN_TSC_KHZ){
+		clock_mem.page.tsc_khz = MIN_TSC_KHZ;
+	}
+	clock_mem.page.shift = CLOCK_SHIFT;
+	clock_mem.page.mult = div64((uint64_t)1000000 << CLOCK_SHIFT, clock_mem.page.tsc_khz, &rem);
+	tsc_base = clock_tsc();
+	clock_mem.page.tsc_base_lo = (uint32_t)tsc_base;
+	clock_mem.page.tsc_base_hi = (uint32_t)(tsc_base >> 32);
+
+	page_table_vid[CLOCK_PAGE_IDX] = (uint32_t)&clock_mem | PRESENT | USER;
+	if(!boot_fast){
+		printf("TSC calibrated at %u kHz.\n", clock_mem.page.tsc_khz);
+	}
+}
+
+/* uint32_t clock_tsc_khz()
+ * Inputs:      NONE
+ * Return Value: TSC frequency in kHz */
+uint32_t clock_tsc_khz(){
+	return clock_mem.page.tsc_khz;
+}
+
+/* uint64_t clock_cycles_to_ns(uint64_t cycles)
+ * Inputs:      uint64_t cycles = a TSC interval
+ * Return Value: the interval in nanoseconds
+ * Function: multiplies the two halves separately so nothing overflows */
+uint64_t clock_cycles_to_ns(uint64_t cycles){
+	uint32_t hi = (uint32_t)(cycles >> 32);
+	uint32_t lo = (uint32_t)cycles;
+	return (((uint64_t)hi * clock_mem.page.mult) << (32 - CLOCK_SHIFT)) +
+	       (((uint64_t)lo * clock_mem.page.mult) >> CLOCK_SHIFT);
+}
+
+/* uint64_t clock_tsc_to_ns(uint64_t tsc)
+ * Inputs:      uint64_t tsc = a TSC reading taken after clock_init
+ * Return Value: what clock_ns would have returned at that reading */
+uint64_t clock_tsc_to_ns(uint64_t tsc){
+	return clock_cycles_to_ns(tsc - tsc_base);
+}
+
+/* uint64_t clock_ns()
+ * Inputs:      NONE
+ * Return Value: nanoseconds since clock_init */
+uint64_t clock_ns(){
+	return clock_tsc_to_ns(clock_tsc());
+}
+
+/* void clock_ns_to_timespec(uint64_t ns, timespec_t* ts)
+ * Inputs:      uint64_t ns = nanoseconds, less than 2^32 seconds
+ *              timespec_t* ts = destination
+ * Return Value: NONE */
+void clock_ns_to_timespec(uint64_t ns, timespec_t* ts){
+	uint32_t rem;
+	ts->tv_sec = div64(ns, NS_PER_SEC, &rem);
+	ts->tv_nsec = rem;
+}
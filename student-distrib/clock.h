@@ -0,0 +1,58 @@
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+/* Monotonic nanosecond clock driven by the TSC, calibrated against the PIT at boot. */
+#include "types.h"
+
+#define PIT_HZ				1193182		// PIT input clock.
+#define CLOCK_MONOTONIC		0			// The only clock: nanoseconds since clock_init.
+#define CLOCK_SHIFT			24			// ns = (cycles * mult) >> CLOCK_SHIFT
+#define CLOCK_PAGE_IDX		4			// Entry of page_table_vid holding the clock page.
+#define CLOCK_PAGE_ADDR		(0x40000000 + CLOCK_PAGE_IDX * 0x1000)	// Where user programs see it.
+#define NS_PER_SEC			1000000000
+
+#ifndef ASM
+typedef struct timespec{
+	int32_t tv_sec;
+	int32_t tv_nsec;
+} timespec_t;
+
+/*
+ * Mapped read-only into every process at CLOCK_PAGE_ADDR. It never changes
+ * after boot, so a program can turn its own rdtsc into nanoseconds with
+ * ((tsc - tsc_base) * mult) >> shift and skip the system call.
+ */
+typedef struct clock_page{
+	uint32_t tsc_khz;
+	uint32_t mult;
+	uint32_t shift;
+	uint32_t tsc_base_lo;			// TSC when the clock read 0.
+	uint32_t tsc_base_hi;
+} clock_page_t;
+
+/* Calibrates the TSC and maps the clock page. Call after paging is set up, with interrupts off. */
+void clock_init();
+
+/* Reads the time stamp counter. */
+uint64_t clock_tsc();
+
+/* TSC frequency found at boot. */
+uint32_t clock_tsc_khz();
+
+/* Nanoseconds since clock_init. */
+uint64_t clock_ns();
+
+/* Converts a TSC reading taken after clock_init to clock_ns time. */
+uint64_t clock_tsc_to_ns(uint64_t tsc);
+
+/* Converts a number of TSC cycles to nanoseconds. */
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/* n / d with the remainder in *rem, for 64-bit n whose quotient fits in 32 bits. */
+uint32_t div64(uint64_t n, uint32_t d, uint32_t* rem);
+
+/* Splits nanoseconds into seconds and nanoseconds. */
+void clock_ns_to_timespec(uint64_t ns, timespec_t* ts);
+#endif		// ASM
+
+#endif
@@ -6,16 +6,640 @@
 #include "types.h"
 #include "lib.h"
 #include "syscalls.h"
+#include "bcache.h"
+#include "journal.h"
+#include "lz4.h"
+#include "task_switch.h"
 
 static boot_block_t* boot_block;
 
+/*
+ * The image is either a GRUB module (fs_ram points at it and blocks are used
+ * in place) or sits on the ATA disk. On disk the boot block is kept in
+ * memory and every other block goes through the buffer cache.
+ */
+static uint8_t* fs_ram = NULL;
+static blkdev_t* fs_dev = NULL;
+static boot_block_t disk_boot_block;
+
+/* 
+ * In-memory allocation state, rebuilt from the image at mount time. A set
+ * bit in block_bitmap means the data block is in use. block_hint is the
+ * first bitmap word that may have a clear bit, which keeps back to back
+ * allocations (sequential appends) O(1) amortized.
+ */
+static uint32_t block_bitmap[MAX_FS_BLOCKS / 32];
+static uint32_t block_hint = 0;
+static uint32_t free_inodes[MAX_FS_INODES];		//stack of unused inode numbers
+static uint32_t free_inode_count = 0;
+
+/*
+ * With the journal on, blocks freed by an update wait here until the
+ * transaction holding that update commits. Handing one out earlier would
+ * let new data land in a block that the inode on disk, which is what a
+ * crash leaves behind, still points at.
+ */
+static uint32_t pending_free[MAX_FS_BLOCKS / 32];
+static uint32_t fs_journaled = 0;
+
+static inode_t* get_inode(uint32_t inode);
+static uint8_t* get_data_block(uint32_t block);
+static void put_block(void* data, uint32_t dirty);
+static int32_t inode_run(inode_t* inode, uint32_t idx, uint32_t* run);
+static uint32_t inode_blocks(inode_t* inode);
+
+/*
+ * Recently decompressed chunks of compressed files, replaced round robin.
+ * Sequential reads decompress each chunk once however small the reads are.
+ * Compressed files never change, so entries only go stale at mount.
+ */
+#define LZ_CACHE_SIZE 8
+typedef struct lz_slot{
+	uint32_t inode;
+	uint32_t chunk;
+	uint32_t valid;
+	uint8_t data[FOUR_KB];
+} lz_slot_t;
+static lz_slot_t lz_cache[LZ_CACHE_SIZE];
+static uint32_t lz_victim = 0;
+static uint8_t lz_stream[FOUR_KB];		//a stored chunk put back together from two disk blocks
+
+/* The GRUB module as a blkdev_t, so journal_replay can work on it like on a disk. */
+static int32_t ram_read(uint32_t lba, uint32_t count, void* buf){
+	memcpy(buf, fs_ram + lba * BLK_SECTOR_SIZE, count * BLK_SECTOR_SIZE);
+	return 0;
+}
+
+static int32_t ram_write(uint32_t lba, uint32_t count, const void* buf){
+	memcpy(fs_ram + lba * BLK_SECTOR_SIZE, buf, count * BLK_SECTOR_SIZE);
+	return 0;
+}
+
+static blkdev_t ram_dev = {
+	.name = "ram",
+	.read = ram_read,
+	.write = ram_write,
+	.max_sectors = JOURNAL_BLOCKS * SECTORS_PER_BLOCK
+};
+
+/* int32_t journal_valid()
+ * Inputs:      NONE
+ * Return Value: 1 if the mounted image has a journal area we can use */
+static int32_t journal_valid(){
+	return boot_block->journal_magic == JOURNAL_MAGIC && boot_block->journal_blocks == JOURNAL_BLOCKS &&
+	       boot_block->journal_start >= 0 && boot_block->journal_start + JOURNAL_BLOCKS <= boot_block->data_count;
+}
+
+/* uint32_t journal_area()
+ * Inputs:      NONE
+ * Return Value: image block number of the first journal block */
+static uint32_t journal_area(){
+	return boot_block->journal_start + boot_block->inode_count + 1;
+}
+
+
+/* 
+ * build the free block bitmap and free inode list from what the directory
+ * entries reference
+ */
+static void build_free_lists(){
+	uint8_t inode_used[MAX_FS_INODES];
+	int32_t i, j;
+
+	/* Blocks past data_count (or past what we can track) are never handed out. */
+	memset(block_bitmap, 0xFF, sizeof(block_bitmap));
+	for(i = 0; i < boot_block->data_count && i < MAX_FS_BLOCKS; i++){
+		block_bitmap[i / 32] &= ~(1 << (i % 32));
+	}
+	if(journal_valid()){
+		for(i = boot_block->journal_start; i < boot_block->journal_start + JOURNAL_BLOCKS && i < MAX_FS_BLOCKS; i++){
+			block_bitmap[i / 32] |= 1 << (i % 32);
+		}
+	}
+	memset(pending_free, 0, sizeof(pending_free));
+	memset(lz_cache, 0, sizeof(lz_cache));
+	memset(inode_used, 0, sizeof(inode_used));
+
+	for(i = 0; i < boot_block->dir_count; i++){
+		dentry_t* entry = &boot_block->d_entries[i];
+		if(entry->inode_num < 0 || entry->inode_num >= MAX_FS_INODES){
+			continue;
+		}
+		inode_used[entry->inode_num] = 1;
+		if(entry->file_type != TYPE_FILE){
+			continue;
+		}
+		inode_t* inode = get_inode(entry->inode_num);
+		if(inode == NULL){
+			continue;
+		}
+		uint32_t num_blocks = inode_blocks(inode);
+		uint32_t idx, run;
+		for(idx = 0; idx < num_blocks; idx += run){
+			int32_t block = inode_run(inode, idx, &run);
+			if(block < 0){
+				break;
+			}
+			for(j = 0; j < run && idx + j < num_blocks; j++){
+				if(block + j < MAX_FS_BLOCKS){
+					block_bitmap[(block + j) / 32] |= 1 << ((block + j) % 32);
+				}
+			}
+		}
+		put_block(inode, 0);
+	}
 
+	/* Push in reverse so the lowest free inode is handed out first. */
+	free_inode_count = 0;
+	for(i = boot_block->inode_count - 1; i >= 0; i--){
+		if(i < MAX_FS_INODES && !inode_used[i]){
+			free_inodes[free_inode_count++] = i;
+		}
+	}
+	block_hint = 0;
+}
 
 /* 
- * get the block address 
+ * get the block address of the filesystem module and mount it in place
  */
 void get_block_address(unsigned int address){
+	fs_ram = (uint8_t*) address;
 	boot_block = (boot_block_t*) address;
+	fs_journaled = 0;
+
+	/* Finish a metadata update that was cut short after it committed. */
+	if(journal_valid()){
+		ram_dev.sectors = (1 + boot_block->inode_count + boot_block->data_count) * SECTORS_PER_BLOCK;
+		(void)journal_replay(&ram_dev, journal_area(), JOURNAL_BLOCKS);
+	}
+	build_free_lists();
+}
+
+/* int32_t add_journal()
+ * Inputs:      NONE
+ * Return Value: 0 if success else -1
+ * Function: gives an image built without a journal one on its first disk
+ * mount: JOURNAL_BLOCKS free data blocks in a row, searched for from the
+ * end of the image, or new blocks past the end if the disk has room. */
+static int32_t add_journal(){
+	int32_t start, run = 0;
+	int32_t old_count = boot_block->data_count;
+
+	for(start = old_count - 1; start >= 0 && run < JOURNAL_BLOCKS; start--){
+		if(start < MAX_FS_BLOCKS && !(block_bitmap[start / 32] & (1 << (start % 32)))){
+			run++;
+		}
+		else{
+			run = 0;
+		}
+	}
+	if(run == JOURNAL_BLOCKS){
+		start++;		// The loop stepped one past the first block of the run.
+	}
+	else{
+		start = old_count;
+		if(start + JOURNAL_BLOCKS > MAX_FS_BLOCKS ||
+		   (uint32_t)(1 + boot_block->inode_count + start + JOURNAL_BLOCKS) * SECTORS_PER_BLOCK > fs_dev->sectors){
+			return -1;
+		}
+		boot_block->data_count += JOURNAL_BLOCKS;
+	}
+
+	/* An empty descriptor, so nothing left over in the area looks like a transaction. */
+	uint8_t* desc = get_data_block(start);
+	if(desc == NULL){
+		boot_block->data_count = old_count;
+		return -1;
+	}
+	memset(desc, 0, FOUR_KB);
+	put_block(desc, 1);
+
+	boot_block->journal_magic = JOURNAL_MAGIC;
+	boot_block->journal_start = start;
+	boot_block->journal_blocks = JOURNAL_BLOCKS;
+	if(fs_dev->write(0, SECTORS_PER_BLOCK, boot_block) == -1){
+		boot_block->journal_magic = 0;
+		boot_block->data_count = old_count;
+		return -1;
+	}
+	for(; start < boot_block->journal_start + JOURNAL_BLOCKS; start++){
+		block_bitmap[start / 32] |= 1 << (start % 32);
+	}
+	return 0;
+}
+
+/* int32_t fs_mount_disk(blkdev_t* dev)
+ * Inputs:      blkdev_t* dev = disk holding the image
+ * Return Value: 0 if success else -1
+ * Function: mounts an image written to the start of the disk. Only the
+ * boot block is read here, everything else is read on demand. */
+int32_t fs_mount_disk(blkdev_t* dev){
+	if(dev->sectors < SECTORS_PER_BLOCK || dev->read(0, SECTORS_PER_BLOCK, &disk_boot_block) == -1){
+		return -1;
+	}
+
+	/* Refuse anything that does not look like one of our images. */
+	if(disk_boot_block.dir_count < 0 || disk_boot_block.dir_count > MAX_DENTRIES ||
+	   disk_boot_block.inode_count <= 0 || disk_boot_block.inode_count > MAX_FS_INODES ||
+	   disk_boot_block.data_count < 0 ||
+	   (uint32_t)(1 + disk_boot_block.inode_count + disk_boot_block.data_count) * SECTORS_PER_BLOCK > dev->sectors){
+		return -1;
+	}
+
+	fs_ram = NULL;
+	fs_dev = dev;
+	boot_block = &disk_boot_block;
+	fs_journaled = 0;
+
+	/* Replay can rewrite the boot block, so read it again if anything was replayed. */
+	if(journal_valid() && journal_replay(dev, journal_area(), JOURNAL_BLOCKS) > 0 &&
+	   dev->read(0, SECTORS_PER_BLOCK, &disk_boot_block) == -1){
+		return -1;
+	}
+	bcache_init(dev);
+	build_free_lists();
+	if(journal_valid() || (add_journal() == 0 && journal_replay(dev, journal_area(), JOURNAL_BLOCKS) == 0)){
+		journal_init(dev, journal_area());
+		fs_journaled = 1;
+	}
+	return 0;
+}
+
+/* uint8_t* get_block(uint32_t block)
+ * Inputs:      uint32_t block = block number within the image, 0 is the boot block
+ * Return Value: pointer to the block's data, NULL if it could not be read
+ * Function: every get_block must be paired with a put_block. On disk the
+ * block stays held in the buffer cache until then. */
+static uint8_t* get_block(uint32_t block){
+	if(fs_ram != NULL){
+		return fs_ram + FOUR_KB * block;
+	}
+	return bcache_get(block);
+}
+
+/* void put_block(void* data, uint32_t dirty)
+ * Inputs:      void* data = pointer returned by get_block (NULL is ignored)
+ *              uint32_t dirty = nonzero if the block was modified
+ * Return Value: NONE
+ * Function: releases a block, writing it back to disk first if dirty */
+static void put_block(void* data, uint32_t dirty){
+	if(fs_ram == NULL){
+		bcache_put((uint8_t*)data, dirty);
+	}
+}
+
+/* void read_ahead(uint32_t inode, uint32_t first, uint32_t count)
+ * Inputs:      uint32_t inode = inode number
+ *              uint32_t first = index of the first block within the file
+ *              uint32_t count = number of blocks, at most BCACHE_RA_MAX
+ * Return Value: NONE
+ * Function: asks the buffer cache to fetch the file's next blocks. Blocks
+ * past the end of the file are skipped. For a compressed file, first and
+ * count are in 4 kB chunks and the stored blocks holding them are fetched. */
+static void read_ahead(uint32_t inode, uint32_t first, uint32_t count){
+	uint32_t blocks[BCACHE_RA_MAX];
+	uint32_t i;
+
+	if(fs_ram != NULL){
+		return;
+	}
+	inode_t* inode_ptr = get_inode(inode);
+	if(inode_ptr == NULL){
+		return;
+	}
+	if(IS_LZ_INODE(inode_ptr)){
+		inode_lz_t* lz = (inode_lz_t*)inode_ptr;
+		uint32_t chunks = (lz->length + FOUR_KB - 1) / FOUR_KB;
+		if(first >= chunks || chunks > MAX_LZ_CHUNKS){
+			put_block(inode_ptr, 0);
+			return;
+		}
+		uint32_t last = (first + count < chunks) ? first + count : chunks;
+		count = (lz->offsets[last] + FOUR_KB - 1) / FOUR_KB - lz->offsets[first] / FOUR_KB;
+		first = lz->offsets[first] / FOUR_KB;
+	}
+	uint32_t num_blocks = inode_blocks(inode_ptr);
+	for(i = 0; i < count && i < BCACHE_RA_MAX && first + i < num_blocks; i++){
+		int32_t block = inode_run(inode_ptr, first + i, NULL);
+		if(block < 0){
+			break;
+		}
+		blocks[i] = block + boot_block->inode_count + 1;
+	}
+	put_block(inode_ptr, 0);
+	bcache_prefetch(blocks, i);
+}
+
+/* void sync_boot_block()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: logs the in-memory boot block when the image is on disk, or
+ * writes it straight back if there is no journal */
+static void sync_boot_block(){
+	if(fs_ram == NULL && journal_dirty(0, boot_block) == -1){
+		(void)fs_dev->write(0, SECTORS_PER_BLOCK, boot_block);
+	}
+}
+
+/* void put_inode(uint32_t inode, inode_t* inode_ptr, uint32_t dirty)
+ * Inputs:      uint32_t inode = inode number
+ *              inode_t* inode_ptr = pointer returned by get_inode
+ *              uint32_t dirty = nonzero if the inode was modified
+ * Return Value: NONE
+ * Function: put_block for inodes. A modified inode goes to the journal,
+ * which keeps its own hold on the block until the commit writes it. */
+static void put_inode(uint32_t inode, inode_t* inode_ptr, uint32_t dirty){
+	if(dirty && fs_ram == NULL && journal_dirty(inode + 1, inode_ptr) == 0){
+		dirty = 0;
+	}
+	put_block(inode_ptr, dirty);
+}
+
+/* void release_frees()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: called after a commit, makes the blocks its transaction freed
+ * available again */
+static void release_frees(){
+	uint32_t word;
+	uint32_t flags;
+	cli_and_save(flags);
+	for(word = 0; word < MAX_FS_BLOCKS / 32; word++){
+		if(pending_free[word] != 0){
+			block_bitmap[word] &= ~pending_free[word];
+			pending_free[word] = 0;
+			if(word < block_hint){
+				block_hint = word;
+			}
+		}
+	}
+	restore_flags(flags);
+}
+
+/* void op_begin(uint32_t nblocks) / void op_end()
+ * Inputs:      uint32_t nblocks = most metadata blocks the update dirties
+ * Return Value: NONE
+ * Function: bracket one metadata update for the journal. Callers must
+ * have preemption disabled. */
+static void op_begin(uint32_t nblocks){
+	if(journal_begin_op(nblocks)){
+		release_frees();
+	}
+}
+
+static void op_end(){
+	if(journal_end_op()){
+		release_frees();
+	}
+}
+
+/* void fs_sync()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: commits whatever metadata updates the journal is holding */
+void fs_sync(){
+	preempt_disable();
+	if(journal_commit() == 0){
+		release_frees();
+	}
+	preempt_enable();
+}
+
+/* inode_t* get_inode(uint32_t inode)
+ * Inputs:      uint32_t inode = inode number
+ * Return Value: pointer to the inode, NULL if it could not be read
+ * Function: inodes follow the boot block, one per 4 kB block. Release it
+ * with put_block. */
+static inode_t* get_inode(uint32_t inode){
+	if(inode >= boot_block->inode_count){
+		return NULL;
+	}
+	return (inode_t*)get_block(inode + 1);
+}
+
+/* uint8_t* get_data_block(uint32_t block)
+ * Inputs:      uint32_t block = data block number
+ * Return Value: pointer to the start of the data block, NULL if it could
+ *               not be read
+ * Function: data blocks follow the last inode. Release it with put_block. */
+static uint8_t* get_data_block(uint32_t block){
+	return get_block(block + boot_block->inode_count + 1);
+}
+
+/* int32_t inode_length(uint32_t inode)
+ * Inputs:      uint32_t inode = inode number
+ * Return Value: file length in bytes, -1 if the inode could not be read */
+static int32_t inode_length(uint32_t inode){
+	inode_t* inode_ptr = get_inode(inode);
+	if(inode_ptr == NULL){
+		return -1;
+	}
+	int32_t length = inode_ptr->length;
+	put_block(inode_ptr, 0);
+	return length;
+}
+
+/* int32_t inode_run(inode_t* inode, uint32_t idx, uint32_t* run)
+ * Inputs:      inode_t* inode = either inode format
+ *              uint32_t idx = block index within the file
+ *              uint32_t* run = if not NULL, set to the number of contiguous
+ *                              data blocks starting at idx
+ * Return Value: data block number, -1 if the inode has no block idx
+ * Function: the one place that knows every inode format. A run in an
+ * old-style inode never extends past the end of the file. The blocks of
+ * a compressed file are those of its compressed stream. */
+static int32_t inode_run(inode_t* inode, uint32_t idx, uint32_t* run){
+	uint32_t i;
+
+	if(IS_LZ_INODE(inode)){
+		if(idx >= inode_blocks(inode)){
+			return -1;
+		}
+		if(run != NULL){
+			*run = inode_blocks(inode) - idx;
+		}
+		return ((inode_lz_t*)inode)->start + idx;
+	}
+
+	if(IS_EXTENT_INODE(inode)){
+		inode_ext_t* ext = (inode_ext_t*)inode;
+		for(i = 0; i < ext->extent_count && i < MAX_EXTENTS; i++){
+			if(idx < ext->extents[i].count){
+				if(run != NULL){
+					*run = ext->extents[i].count - idx;
+				}
+				return ext->extents[i].start + idx;
+			}
+			idx -= ext->extents[i].count;
+		}
+		return -1;
+	}
+	if(idx >= MAX_FILE_BLOCKS){
+		return -1;
+	}
+	if(run != NULL){
+		uint32_t num_blocks = (inode->length + FOUR_KB - 1) / FOUR_KB;
+		for(i = idx + 1; i < num_blocks && inode->data_block_num[i] == inode->data_block_num[i - 1] + 1; i++);
+		*run = i - idx;
+	}
+	return inode->data_block_num[idx];
+}
+
+/* uint32_t inode_blocks(inode_t* inode)
+ * Inputs:      inode_t* inode = any inode format
+ * Return Value: number of data blocks the file takes up */
+static uint32_t inode_blocks(inode_t* inode){
+	if(IS_LZ_INODE(inode)){
+		int32_t stored = ((inode_lz_t*)inode)->stored_blocks;
+		return (stored < 0) ? 0 : stored;
+	}
+	return (inode->length + FOUR_KB - 1) / FOUR_KB;
+}
+
+/* uint32_t inode_max_blocks(inode_t* inode)
+ * Inputs:      inode_t* inode = either inode format
+ * Return Value: the most data blocks the file can have */
+static uint32_t inode_max_blocks(inode_t* inode){
+	return IS_EXTENT_INODE(inode) ? MAX_FS_BLOCKS : MAX_FILE_BLOCKS;
+}
+
+/* void inode_trim(inode_t* inode, uint32_t nblocks)
+ * Inputs:      inode_t* inode = either inode format
+ *              uint32_t nblocks = number of blocks to keep
+ * Return Value: NONE
+ * Function: drops an extent inode's runs past nblocks blocks. Old-style
+ * inodes need nothing, entries past the length are never looked at. */
+static void inode_trim(inode_t* inode, uint32_t nblocks){
+	uint32_t i, total = 0;
+
+	if(!IS_EXTENT_INODE(inode)){
+		return;
+	}
+	inode_ext_t* ext = (inode_ext_t*)inode;
+	for(i = 0; i < ext->extent_count; i++){
+		if(total + ext->extents[i].count >= nblocks){
+			ext->extents[i].count = nblocks - total;
+			ext->extent_count = (ext->extents[i].count == 0) ? i : i + 1;
+			return;
+		}
+		total += ext->extents[i].count;
+	}
+}
+
+/* int32_t inode_set_block(inode_t* inode, uint32_t idx, uint32_t block)
+ * Inputs:      inode_t* inode = either inode format
+ *              uint32_t idx = block index within the file
+ *              uint32_t block = data block to put there
+ * Return Value: 0 if success, -1 if the inode has no room for it
+ * Function: makes block the file's last block. An extent inode grows its
+ * last run when block directly follows it. */
+static int32_t inode_set_block(inode_t* inode, uint32_t idx, uint32_t block){
+	if(idx >= inode_max_blocks(inode)){
+		return -1;
+	}
+	if(!IS_EXTENT_INODE(inode)){
+		inode->data_block_num[idx] = block;
+		return 0;
+	}
+	inode_ext_t* ext = (inode_ext_t*)inode;
+	inode_trim(inode, idx);
+	if(ext->extent_count > 0){
+		extent_t* last = &ext->extents[ext->extent_count - 1];
+		if(last->start + last->count == block){
+			last->count++;
+			return 0;
+		}
+	}
+	if(ext->extent_count == MAX_EXTENTS){
+		return -1;
+	}
+	ext->extents[ext->extent_count].start = block;
+	ext->extents[ext->extent_count].count = 1;
+	ext->extent_count++;
+	return 0;
+}
+
+/* int32_t alloc_block()
+ * Inputs:      NONE
+ * Return Value: a zeroed data block number, -1 if the image is full
+ * Function: takes the first free block at or after block_hint. Callers
+ * must have preemption disabled; the bitmap itself is only touched with
+ * interrupts off. */
+static int32_t alloc_block(){
+	uint32_t word, bit;
+	uint32_t flags;
+	cli_and_save(flags);
+	for(word = block_hint; word < MAX_FS_BLOCKS / 32; word++){
+		if(block_bitmap[word] != 0xFFFFFFFF){
+			break;
+		}
+	}
+	block_hint = word;
+	if(word == MAX_FS_BLOCKS / 32){
+		restore_flags(flags);
+		return -1;
+	}
+	for(bit = 0; block_bitmap[word] & (1 << bit); bit++);
+	block_bitmap[word] |= 1 << bit;
+	restore_flags(flags);
+
+	uint32_t block = word * 32 + bit;
+	uint8_t* data = get_data_block(block);
+	if(data == NULL){
+		cli_and_save(flags);
+		block_bitmap[word] &= ~(1 << bit);
+		restore_flags(flags);
+		return -1;
+	}
+	memset(data, 0, FOUR_KB);
+	put_block(data, 1);
+	return block;
+}
+
+/* void free_block(uint32_t block)
+ * Inputs:      uint32_t block = data block number to release
+ * Return Value: NONE
+ * Function: marks the block free and moves the hint back if needed. With
+ * the journal on, that waits until the next commit. */
+static void free_block(uint32_t block){
+	uint32_t flags;
+	cli_and_save(flags);
+	if(fs_journaled){
+		pending_free[block / 32] |= 1 << (block % 32);
+	}
+	else{
+		block_bitmap[block / 32] &= ~(1 << (block % 32));
+		if(block / 32 < block_hint){
+			block_hint = block / 32;
+		}
+	}
+	restore_flags(flags);
+}
+
+/* int32_t grow_blocks(inode_t* inode, uint32_t length)
+ * Inputs:      inode_t* inode = inode to grow
+ *              uint32_t length = byte length that must be backed by blocks
+ * Return Value: bytes now backed by blocks (may be less than length if the
+ *               image fills up)
+ * Function: allocates zeroed blocks past the end of the file. Callers must
+ * have preemption disabled. */
+static uint32_t grow_blocks(inode_t* inode, uint32_t length){
+	uint32_t have = (inode->length + FOUR_KB - 1) / FOUR_KB;
+	uint32_t need = (length + FOUR_KB - 1) / FOUR_KB;
+	if(need > inode_max_blocks(inode)){
+		need = inode_max_blocks(inode);
+	}
+	for(; have < need; have++){
+		int32_t block = alloc_block();
+		if(block == -1){
+			break;
+		}
+		if(inode_set_block(inode, have, block) == -1){
+			free_block(block);
+			break;
+		}
+	}
+	return (have * FOUR_KB < length) ? have * FOUR_KB : length;
 }
 
 
@@ -78,6 +702,187 @@ int32_t read_dentry_by_name (const uint8_t* fname, dentry_t* dentry){
 
 
 
+/* uint8_t* lz_fetch(inode_lz_t* lz, uint32_t src_off, uint32_t src_len)
+ * Inputs:      inode_lz_t* lz = compressed inode
+ *              uint32_t src_off = byte offset in the compressed stream
+ *              uint32_t src_len = bytes wanted, at most 4 kB
+ * Return Value: pointer to the bytes, NULL if they could not be read
+ * Function: in RAM the stream is one stretch of memory and is used in
+ * place. On disk the bytes are copied out of the cache into lz_stream, as
+ * they may straddle two blocks. Callers must have preemption disabled. */
+static uint8_t* lz_fetch(inode_lz_t* lz, uint32_t src_off, uint32_t src_len){
+	uint32_t done = 0;
+
+	if(fs_ram != NULL){
+		return get_data_block(lz->start) + src_off;
+	}
+	while(done < src_len){
+		uint32_t pos = src_off + done;
+		uint32_t n = FOUR_KB - pos % FOUR_KB;
+		if(n > src_len - done){
+			n = src_len - done;
+		}
+		uint8_t* data = get_data_block(lz->start + pos / FOUR_KB);
+		if(data == NULL){
+			return NULL;
+		}
+		memcpy(lz_stream + done, data + pos % FOUR_KB, n);
+		put_block(data, 0);
+		done += n;
+	}
+	return lz_stream;
+}
+
+/* int32_t lz_decode(inode_lz_t* lz, uint32_t chunk, uint8_t* dst)
+ * Inputs:      inode_lz_t* lz = compressed inode
+ *              uint32_t chunk = index of the 4 kB chunk
+ *              uint8_t* dst = where the chunk goes, room for 4 kB
+ * Return Value: bytes in the chunk, -1 if it is corrupt or could not be read
+ * Function: callers must have preemption disabled. */
+static int32_t lz_decode(inode_lz_t* lz, uint32_t chunk, uint8_t* dst){
+	if(chunk >= MAX_LZ_CHUNKS){
+		return -1;
+	}
+	uint32_t out_len = lz->length - chunk * FOUR_KB;
+	if(out_len > FOUR_KB){
+		out_len = FOUR_KB;
+	}
+	uint32_t src_off = lz->offsets[chunk];
+	uint32_t src_len = lz->offsets[chunk + 1] - src_off;
+	if(lz->offsets[chunk + 1] < src_off || src_len > FOUR_KB || lz->offsets[chunk + 1] > inode_blocks((inode_t*)lz) * FOUR_KB){
+		return -1;
+	}
+	uint8_t* src = lz_fetch(lz, src_off, src_len);
+	if(src == NULL){
+		return -1;
+	}
+	if(src_len == out_len){
+		memcpy(dst, src, out_len);		//stored raw, compression did not help
+	}
+	else if(lz4_decompress(src, src_len, dst, out_len) != out_len){
+		return -1;
+	}
+	return out_len;
+}
+
+/* lz_slot_t* lz_chunk(inode_lz_t* lz, uint32_t inode, uint32_t chunk)
+ * Inputs:      inode_lz_t* lz = compressed inode
+ *              uint32_t inode = its number, the cache key
+ *              uint32_t chunk = index of the 4 kB chunk
+ * Return Value: cache slot holding the chunk, NULL if it is corrupt or
+ *               could not be read
+ * Function: callers must have preemption disabled until they are done
+ * with the slot. */
+static lz_slot_t* lz_chunk(inode_lz_t* lz, uint32_t inode, uint32_t chunk){
+	uint32_t i;
+
+	for(i = 0; i < LZ_CACHE_SIZE; i++){
+		if(lz_cache[i].valid && lz_cache[i].inode == inode && lz_cache[i].chunk == chunk){
+			return &lz_cache[i];
+		}
+	}
+	lz_slot_t* slot = &lz_cache[lz_victim];
+	lz_victim = (lz_victim + 1) % LZ_CACHE_SIZE;
+	slot->valid = 0;
+	if(lz_decode(lz, chunk, slot->data) == -1){
+		return NULL;
+	}
+	slot->inode = inode;
+	slot->chunk = chunk;
+	slot->valid = 1;
+	return slot;
+}
+
+/* int32_t read_lz(inode_lz_t* lz, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
+ * Inputs:      inode_lz_t* lz = compressed inode
+ *              uint32_t inode = its number
+ *              uint32_t offset, uint8_t* buf, uint32_t length = as for
+ *              read_data, length already clipped to the file
+ * Return Value: bytes copied, -1 if nothing could be
+ * Function: read_data for compressed files, one chunk at a time */
+static int32_t read_lz(inode_lz_t* lz, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
+	uint32_t copied = 0;
+
+	/* The chunk cache and lz_stream are shared, so no other process may run in between. */
+	preempt_disable();
+	while(copied < length){
+		uint32_t pos = offset + copied;
+		uint32_t n = FOUR_KB - pos % FOUR_KB;
+		if(n > length - copied){
+			n = length - copied;
+		}
+		if(n == FOUR_KB){
+			/* A whole chunk is decoded straight into buf; only partial reads go through the cache. */
+			if(lz_decode(lz, pos / FOUR_KB, buf + copied) == -1){
+				break;
+			}
+		}
+		else{
+			lz_slot_t* slot = lz_chunk(lz, inode, pos / FOUR_KB);
+			if(slot == NULL){
+				break;
+			}
+			memcpy(buf + copied, slot->data + pos % FOUR_KB, n);
+		}
+		copied += n;
+	}
+	preempt_enable();
+	return (copied == 0 && length != 0) ? -1 : copied;
+}
+
+
+/* int32_t read_inode(uint32_t inode, inode_t* inode_ptr, uint32_t offset, uint8_t* buf, uint32_t length)
+ * Inputs:      uint32_t inode = inode number
+ *              inode_t* inode_ptr = the inode, held by the caller
+ *              uint32_t offset, uint8_t* buf, uint32_t length = as for read_data
+ * Return Value: -1 if failed, bytes copied if success
+ * Function: read_data once the inode is in hand */
+static int32_t read_inode(uint32_t inode, inode_t* inode_ptr, uint32_t offset, uint8_t* buf, uint32_t length){
+	uint8_t* data;
+
+	if(offset >= inode_ptr->length){			//if out of range, return 0
+		return 0;
+	}
+	if(length > inode_ptr->length - offset){	//never copy past the end of the file
+		length = inode_ptr->length - offset;
+	}
+	if(IS_LZ_INODE(inode_ptr)){
+		return read_lz((inode_lz_t*)inode_ptr, inode, offset, buf, length);
+	}
+
+	int blk_idx = offset / FOUR_KB;		 	//block index
+	uint32_t b_offset = offset % FOUR_KB;											//block offset
+	uint32_t copied = 0;		 												//bytes copied so far
+	uint32_t first_blk = blk_idx;
+	uint32_t last_blk = (length > 0) ? (offset + length - 1) / FOUR_KB : first_blk;
+	while(copied < length){
+		int32_t block = inode_run(inode_ptr, blk_idx, NULL);
+		if(block < 0){
+			break;
+		}
+		uint32_t chunk = FOUR_KB - b_offset;		//rest of this block, or less on the last one
+		if(chunk > length - copied){
+			chunk = length - copied;
+		}
+		/* On disk, fetch a multi-block read BCACHE_RA_MAX blocks at a time so the driver can batch them. */
+		if(last_blk > first_blk && (blk_idx - first_blk) % BCACHE_RA_MAX == 0){
+			uint32_t left = last_blk + 1 - blk_idx;
+			read_ahead(inode, blk_idx, (left < BCACHE_RA_MAX) ? left : BCACHE_RA_MAX);
+		}
+		data = get_data_block(block);
+		if(data == NULL){
+			break;
+		}
+		memcpy(buf + copied, data + b_offset, chunk);
+		put_block(data, 0);
+		copied += chunk;												//re-initialize parameters
+		blk_idx++;																//for the next loop
+		b_offset = 0;
+	}
+	return (copied == 0 && length != 0) ? -1 : copied;
+
+}
+
 /* uint32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
  * Inputs:      uint32_t inode
  *              int32_t offset
@@ -86,40 +891,80 @@ int32_t read_dentry_by_name (const uint8_t* fname, dentry_t* dentry){
  * Return Value: -1 if failed, bytes copied if success
  * Function: read data */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
-	uint32_t f_addr = (uint32_t)boot_block;									//starting address of boot block
-	uint8_t* dest;
-	// uint32_t temp_length;
+	inode_t* inode_ptr = get_inode(inode);
 
-	uint32_t first_inode = FOUR_KB + (uint32_t)boot_block;
-	uint32_t inode_addr = FOUR_KB*inode + first_inode;
-	inode_t* inode_ptr = (inode_t*) inode_addr;
-
-	if(offset >= inode_ptr->length){			//if out of range, return 0
-		return 0;
+	if(inode_ptr == NULL){
+		return -1;
 	}
+	int32_t ret = read_inode(inode, inode_ptr, offset, buf, length);
+	put_block(inode_ptr, 0);
+	return ret;
+}
 
-	int blk_idx = offset / FOUR_KB;		 	//block index
-	uint32_t b_offset = offset % FOUR_KB;											//block offset
-	uint32_t save_length = length;		 												//bytes to be copied
-	while(1){
-		//case of copying the entire block
-		if((FOUR_KB - b_offset) >= length){
-			dest = (uint8_t*)(FOUR_KB * (inode_ptr->data_block_num[blk_idx] + boot_block->inode_count + 1) + f_addr + b_offset);
-			memcpy(buf, dest, length);
-			return save_length;
-		}
-		//case of copying more than one block
-		// temp_length = length - FOUR_KB + b_offset+1;
-		dest = (uint8_t*)(FOUR_KB * (inode_ptr->data_block_num[blk_idx] + boot_block->inode_count + 1) + f_addr + b_offset);
-		memcpy(buf, dest, FOUR_KB-b_offset);
-		// printf("%s   buf test\n", buf);
-		buf = buf + FOUR_KB - b_offset;															//re-initialize parameters
-		length = length - FOUR_KB + b_offset;												//for the next loop
-		blk_idx++;
-		b_offset = 0;
+/* int32_t file_handle_open(const uint8_t* fname, file_handle_t* handle)
+ * Inputs:      const uint8_t* fname = name of a regular file
+ *              file_handle_t* handle = filled in on success
+ * Return Value: 0 if success else -1
+ * Function: looks the name up once and holds on to the inode until
+ * file_handle_close, so reads through the handle skip both the directory
+ * scan and the inode fetch. */
+int32_t file_handle_open(const uint8_t* fname, file_handle_t* handle){
+	dentry_t dentry;
+
+	if(handle == NULL || read_dentry_by_name(fname, &dentry) == -1 || dentry.file_type != TYPE_FILE){
+		return -1;
+	}
+	handle->inode_ptr = get_inode(dentry.inode_num);
+	if(handle->inode_ptr == NULL){
+		return -1;
 	}
+	handle->inode = dentry.inode_num;
+	handle->length = handle->inode_ptr->length;
 	return 0;
+}
 
+/* int32_t file_handle_read(file_handle_t* handle, uint32_t offset, uint8_t* buf, uint32_t length)
+ * Inputs:      file_handle_t* handle = from file_handle_open
+ *              uint32_t offset, uint8_t* buf, uint32_t length = as for read_data
+ * Return Value: -1 if failed, bytes copied if success */
+int32_t file_handle_read(file_handle_t* handle, uint32_t offset, uint8_t* buf, uint32_t length){
+	return read_inode(handle->inode, handle->inode_ptr, offset, buf, length);
+}
+
+/* int32_t file_handle_map(file_handle_t* handle, uint32_t idx, uint8_t** data)
+ * Inputs:      file_handle_t* handle = from file_handle_open
+ *              uint32_t idx = block index within the file
+ *              uint8_t** data = set to the first byte of block idx
+ * Return Value: number of contiguous blocks at *data, 0 past the end of
+ *               the file, -1 if the blocks cannot be addressed directly
+ * Function: only a RAM image keeps a file's blocks in memory at a fixed
+ * place, and only uncompressed files are stored as they read. Callers
+ * fall back to file_handle_read on -1. The pointers stay valid while the
+ * handle is open and the file is not truncated or rewritten. */
+int32_t file_handle_map(file_handle_t* handle, uint32_t idx, uint8_t** data){
+	uint32_t run;
+
+	if(fs_ram == NULL || IS_LZ_INODE(handle->inode_ptr)){
+		return -1;
+	}
+	if(idx >= inode_blocks(handle->inode_ptr)){
+		return 0;
+	}
+	int32_t block = inode_run(handle->inode_ptr, idx, &run);
+	if(block < 0){
+		return 0;
+	}
+	*data = get_data_block(block);
+	return run;
+}
+
+/* void file_handle_close(file_handle_t* handle)
+ * Inputs:      file_handle_t* handle = from file_handle_open
+ * Return Value: NONE
+ * Function: releases the inode */
+void file_handle_close(file_handle_t* handle){
+	put_block(handle->inode_ptr, 0);
+	handle->inode_ptr = NULL;
 }
 
 
@@ -131,12 +976,7 @@ int32_t get_file_length(dentry_t* dentry){
 	if(dentry->file_type != 2){
 		return 0;
 	}
-	uint32_t inode_num = dentry->inode_num;				//get the inode number for this directory entry
-
-	uint32_t first_inode = FOUR_KB + (uint32_t)boot_block;		//initialize the first inode
-	uint32_t inode_addr = FOUR_KB*inode_num + first_inode;		//initialize the inode addr
-	inode_t* inode = (inode_t*) inode_addr;										//set inode
-	return (uint32_t)inode->length;														//get it length
+	return inode_length(dentry->inode_num);				//get the length from this entry's inode
 }
 
 /* int32_t get_file_length_by_name(uint8_t* fname)
@@ -145,13 +985,151 @@ int32_t get_file_length(dentry_t* dentry){
  * Function: gets file length */
 int32_t get_file_length_by_name(uint8_t* fname){
 	dentry_t dentry;
-	read_dentry_by_name(fname, &dentry);
-	uint32_t inode_num = dentry.inode_num;				//get the inode number for this directory entry
+	if(read_dentry_by_name(fname, &dentry) == -1){
+		return -1;
+	}
+	return inode_length(dentry.inode_num);				//get the length from this entry's inode
+}
 
-	uint32_t first_inode = FOUR_KB + (uint32_t)boot_block;		//initialize the first inode
-	uint32_t inode_addr = FOUR_KB*inode_num + first_inode;		//initialize the inode addr
-	inode_t* inode = (inode_t*) inode_addr;										//set inode
-	return (uint32_t)inode->length;														//get it length
+
+/* int32_t file_stat(int32_t file_type, int32_t inode_num, stat_t* st)
+ * Inputs:      int32_t file_type = TYPE_RTC, TYPE_DIR or TYPE_FILE
+ *              int32_t inode_num = inode of the file (ignored unless TYPE_FILE)
+ *              stat_t* st = destination
+ * Return Value: 0 if success else -1
+ * Function: fills st from the inode without touching any data blocks */
+int32_t file_stat(int32_t file_type, int32_t inode_num, stat_t* st){
+	if(st == NULL){
+		return -1;
+	}
+	st->file_type = file_type;
+	st->inode_num = inode_num;
+	st->length = 0;
+	st->blocks = 0;
+	if(file_type == TYPE_FILE){
+		if(inode_num < 0 || inode_num >= boot_block->inode_count){
+			return -1;
+		}
+		inode_t* inode = get_inode(inode_num);
+		if(inode == NULL){
+			return -1;
+		}
+		st->length = inode->length;
+		st->blocks = inode_blocks(inode);		//what is stored, less than the length for a compressed file
+		put_block(inode, 0);
+	}
+	return 0;
+}
+
+
+/* int32_t file_create(const uint8_t* fname)
+ * Inputs:      const uint8_t* fname = name of the new file
+ * Return Value: 0 if success else -1
+ * Function: adds an empty regular file to the directory. Fails if the name
+ * is taken or too long, or if there is no free dentry or inode. */
+int32_t file_create(const uint8_t* fname){
+	dentry_t dentry;
+	uint32_t flags;
+	uint32_t len = strlen((int8_t*)fname);
+
+	if(len == 0 || len > MAX_NAME_LEN){
+		return -1;
+	}
+
+	/* No other process may take the name, dentry or inode before we do. */
+	preempt_disable();
+	if(read_dentry_by_name(fname, &dentry) == 0 || boot_block->dir_count >= MAX_DENTRIES || free_inode_count == 0){
+		preempt_enable();
+		return -1;
+	}
+	uint32_t inode_num = free_inodes[free_inode_count - 1];
+	inode_t* inode = get_inode(inode_num);
+	if(inode == NULL){
+		preempt_enable();
+		return -1;
+	}
+
+	/* Nothing can fail from here on, so the update is certain. */
+	op_begin(2);
+	inode->length = 0;
+	inode->data_block_num[0] = INODE_EXTENT_MAGIC;		//new files always use extents
+	((inode_ext_t*)inode)->extent_count = 0;
+	put_inode(inode_num, inode, 1);
+	cli_and_save(flags);
+	free_inode_count--;
+	restore_flags(flags);
+
+	dentry_t* entry = &boot_block->d_entries[boot_block->dir_count];
+	memset(entry, 0, sizeof(dentry_t));
+	memcpy(entry->fname, fname, len);
+	entry->file_type = TYPE_FILE;
+	entry->inode_num = inode_num;
+	boot_block->dir_count++;
+	sync_boot_block();
+	op_end();
+	preempt_enable();
+	return 0;
+}
+
+/* int32_t file_truncate(uint32_t inode, uint32_t length)
+ * Inputs:      uint32_t inode = inode of a regular file
+ *              uint32_t length = new length in bytes
+ * Return Value: 0 if success else -1
+ * Function: shrinks or grows the file. Freed blocks go back to the bitmap,
+ * new bytes read as zero. Compressed files cannot be truncated. */
+int32_t file_truncate(uint32_t inode, uint32_t length){
+	int32_t ret_val = -1;
+
+	preempt_disable();
+	inode_t* inode_ptr = get_inode(inode);
+	if(inode_ptr == NULL){
+		preempt_enable();
+		return -1;
+	}
+	if(IS_LZ_INODE(inode_ptr) || length > inode_max_blocks(inode_ptr) * FOUR_KB){
+		put_block(inode_ptr, 0);
+		preempt_enable();
+		return -1;
+	}
+
+	/* From here the bitmap or the inode changes, so every exit goes through out. */
+	op_begin(1);
+	uint32_t keep = (length + FOUR_KB - 1) / FOUR_KB;
+	uint32_t have = (inode_ptr->length + FOUR_KB - 1) / FOUR_KB;
+	if(length > inode_ptr->length){
+		uint32_t got = grow_blocks(inode_ptr, length);
+		if(got < length){
+			/* Out of space: give back whatever we managed to take. */
+			for(got = (got + FOUR_KB - 1) / FOUR_KB; got > have; got--){
+				free_block(inode_run(inode_ptr, got - 1, NULL));
+			}
+			inode_trim(inode_ptr, have);
+			put_block(inode_ptr, 0);
+			goto out;
+		}
+	}
+	else{
+		for(; have > keep; have--){
+			free_block(inode_run(inode_ptr, have - 1, NULL));
+		}
+		inode_trim(inode_ptr, keep);
+
+		/* Zero the tail of the last block so growing again reads zeros. */
+		if(length % FOUR_KB){
+			uint8_t* data = get_data_block(inode_run(inode_ptr, keep - 1, NULL));
+			if(data != NULL){
+				memset(data + length % FOUR_KB, 0, FOUR_KB - length % FOUR_KB);
+				put_block(data, 1);
+			}
+		}
+	}
+	inode_ptr->length = length;
+	put_inode(inode, inode_ptr, 1);
+	ret_val = 0;
+out:
+	op_end();
+	preempt_enable();
+	return ret_val;
 }
 
 
@@ -171,12 +1149,83 @@ int32_t fclose(){
 	return 0;
 }
 
-/* uint32_t fwrite()
- * Inputs: NONE
- * Return Value: -1
- * Function: do nothing */
+/* int32_t fwrite(int32_t fd, const void* buf, int32_t nbytes)
+ * Inputs: int32_t fd = pointer to this open file's file_desc_t
+ 					 const void* buf = data to write
+					 int32_t nbytes = number of bytes to write
+ * Return Value: bytes written, -1 if nothing could be written
+ * Function: writes at the file position, growing the file as needed. To
+ * append, lseek to SEEK_END first. Writes past the end leave a zero filled
+ * gap. Compressed files cannot be written. */
 int32_t fwrite(int32_t fd, const void* buf, int32_t nbytes){
-	return -1;
+	file_desc_t* file = (file_desc_t*)fd;
+
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	if(nbytes == 0){
+		return 0;
+	}
+
+	preempt_disable();
+	inode_t* inode = get_inode(file->inode);
+	if(inode == NULL){
+		preempt_enable();
+		return -1;
+	}
+	if(IS_LZ_INODE(inode)){		//compressed files are read-only
+		put_block(inode, 0);
+		preempt_enable();
+		return -1;
+	}
+	uint32_t pos = file->file_position;
+	uint32_t end = pos + nbytes;
+	uint32_t grew = (end > inode->length);		//overwrites inside the file leave the inode alone
+	uint32_t written = 0;
+	if(grew){
+		/* Only growing touches metadata; the bracket closes at out on every path. */
+		op_begin(1);
+		uint32_t have = (inode->length + FOUR_KB - 1) / FOUR_KB;
+		end = grow_blocks(inode, end);
+		if(end <= pos){
+			/* Nothing landed in the file, so give back any gap blocks. */
+			for(end = (end + FOUR_KB - 1) / FOUR_KB; end > have; end--){
+				free_block(inode_run(inode, end - 1, NULL));
+			}
+			inode_trim(inode, have);
+			put_block(inode, 0);
+			goto out;
+		}
+	}
+
+	/* Copy one block at a time, like read_data. */
+	while(pos < end){
+		uint32_t b_offset = pos % FOUR_KB;
+		uint32_t chunk = FOUR_KB - b_offset;
+		if(chunk > end - pos){
+			chunk = end - pos;
+		}
+		int32_t block = inode_run(inode, pos / FOUR_KB, NULL);
+		uint8_t* data = (block < 0) ? NULL : get_data_block(block);
+		if(data == NULL){
+			break;
+		}
+		memcpy(data + b_offset, (uint8_t*)buf + written, chunk);
+		put_block(data, 1);
+		pos += chunk;
+		written += chunk;
+	}
+	if(pos > inode->length){
+		inode->length = pos;
+	}
+	put_inode(file->inode, inode, grew);
+	file->file_position = pos;
+out:
+	if(grew){
+		op_end();
+	}
+	preempt_enable();
+	return (written == 0) ? -1 : written;
 }
 
 /* uint32_t fread(uint8_t* buf, uint32_t count, const uint8_t* fname)
@@ -188,8 +1237,40 @@ int32_t fwrite(int32_t fd, const void* buf, int32_t nbytes){
 // int32_t fread(uint8_t* buf, uint32_t count, const uint8_t* fname)
 int32_t fread(int32_t fd, const void* buf, int32_t nbytes)
 {
-	int32_t val = read_data(((file_desc_t*)fd)->inode, ((file_desc_t*)fd)->file_position, (uint8_t*)buf, nbytes);
-	((file_desc_t*)fd)->file_position += val;
+	file_desc_t* file = (file_desc_t*)fd;
+	uint32_t pos = file->file_position;
+	int32_t val = read_data(file->inode, pos, (uint8_t*)buf, nbytes);
+	if(val <= 0){
+		return val;
+	}
+	file->file_position += val;
+
+	/*
+	 * A read that starts where the last one ended is streaming. Keep the
+	 * next ra_window blocks on their way, doubling the window each time
+	 * it has to be refilled; any other access pattern resets it.
+	 */
+	if(pos == file->ra_pos){
+		uint32_t next = (file->file_position + FOUR_KB - 1) / FOUR_KB;		//first block not yet touched
+		if(file->ra_window == 0){
+			file->ra_window = BCACHE_RA_MIN;
+			file->ra_block = next;
+		}
+		if(file->ra_block < next){
+			file->ra_block = next;
+		}
+		if(file->ra_block - next < file->ra_window / 2){		//less than half a window still ahead of us
+			read_ahead(file->inode, file->ra_block, next + file->ra_window - file->ra_block);
+			file->ra_block = next + file->ra_window;
+			if(file->ra_window < BCACHE_RA_MAX){
+				file->ra_window *= 2;
+			}
+		}
+	}
+	else{
+		file->ra_window = 0;
+	}
+	file->ra_pos = file->file_position;
 	return val;
 }
 
@@ -217,44 +1298,62 @@ int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes){
 	return -1;
 }
 
-/* uint32_t dir_read(uint32_t idx, uint8_t* buf, uint32_t length, dentry_t** dentry)
- * Inputs: uint32_t idx
- 					 uint8_t* buf
-					 uint32_t length
-					 dentry_t** dentry
- * Return Value: bytes copied
- * Function: reads directory */
-// int32_t dir_read(uint32_t idx, uint8_t* buf, uint32_t length, dentry_t** dentry)
-
-
-int dir_location = 0;
+/* int32_t dir_read(int32_t fd, const void* buf, int32_t nbytes)
+ * Inputs: int32_t fd = pointer to this open file's file_desc_t
+ 					 const void* buf = name destination
+					 int32_t nbytes = size of buf
+ * Return Value: bytes copied, 0 at the end of the directory
+ * Function: reads the next directory entry's name. The position is kept in
+ * the file descriptor, so every open of "." has its own cursor. */
 int32_t dir_read(int32_t fd, const void* buf, int32_t nbytes){
+	file_desc_t* file = (file_desc_t*)fd;
+	dentry_t dentry;
 
-    dentry_t dentry;
-    int i;
-	
-    if (read_dentry_by_index(dir_location, &dentry) == 0)
-    {
-        //clear buffer
-        for (i = 0; i < 33; i++)
-            ((int8_t*)(buf))[i] = '\0';
-
-
-        //copy file name into buffer if directory entry can be read
-        int32_t len = strlen((int8_t*)dentry.fname);
-        if(len > 32)
-        	len =32;
-        strncpy((int8_t*)buf, (int8_t*)dentry.fname, len);
-        dir_location++;
-        return len;
-    }
-    else
-    {
-		dir_location = 0;
-        return 0;
-    }
-
+	if(buf == NULL || nbytes <= 0){
+		return -1;
+	}
+	if(read_dentry_by_index(file->file_position, &dentry) != 0){
+		return 0;
+	}
 
+	//copy file name into buffer if directory entry can be read
+	int32_t len = strlen((int8_t*)dentry.fname);
+	if(len > MAX_NAME_LEN)
+		len = MAX_NAME_LEN;
+	if(len > nbytes)
+		len = nbytes;
+	memset((void*)buf, 0, nbytes);
+	strncpy((int8_t*)buf, (int8_t*)dentry.fname, len);
+	file->file_position++;
+	return len;
+}
 
+/* int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes)
+ * Inputs: int32_t fd = pointer to this open file's file_desc_t
+ 					 void* buf = array of dirent_t to fill
+					 int32_t nbytes = size of buf
+ * Return Value: bytes filled (a multiple of sizeof(dirent_t)), 0 at the end
+ * Function: reads as many directory entries as fit in buf, sharing the
+ * cursor with dir_read. */
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes){
+	file_desc_t* file = (file_desc_t*)fd;
+	dirent_t* out = (dirent_t*)buf;
+	dentry_t dentry;
+	int32_t count = 0;
 
+	if(buf == NULL || nbytes < (int32_t)sizeof(dirent_t)){
+		return -1;
+	}
+	while((count + 1) * sizeof(dirent_t) <= nbytes){
+		if(read_dentry_by_index(file->file_position, &dentry) != 0){
+			break;
+		}
+		memcpy(out[count].fname, boot_block->d_entries[file->file_position].fname, MAX_NAME_LEN);
+		out[count].file_type = dentry.file_type;
+		out[count].inode_num = dentry.inode_num;
+		out[count].length = get_file_length(&dentry);
+		file->file_position++;
+		count++;
+	}
+	return count * sizeof(dirent_t);
 }
@@ -7,9 +7,19 @@
 #define _FILE_H
 
 #include "types.h"
+#include "blkdev.h"
 
 #define MAX_NAME_LEN 32    //maximum file name length
 #define FOUR_KB 4096
+#define MAX_DENTRIES 63		//the boot block has room for 63 directory entries
+#define MAX_FILE_BLOCKS 1023	//data blocks one inode can point to
+#define MAX_FS_BLOCKS 16384	//data blocks the allocator can track (64 MB)
+#define MAX_FS_INODES 1024	//inodes the allocator can track
+#define SECTORS_PER_BLOCK 8	//512 byte disk sectors per 4 kB block
+#define MAX_EXTENTS 510		//runs one extent inode can list
+#define INODE_EXTENT_MAGIC 0x54584524	//"$EXT", far past any real data block number
+#define INODE_LZ_MAGIC 0x345A4C24	//"$LZ4"
+#define MAX_LZ_CHUNKS 1019	//4 kB chunks one compressed inode can describe
 
 
 typedef struct dentry{
@@ -23,20 +33,92 @@ typedef struct boot_block{
 	int32_t dir_count;
 	int32_t inode_count;
 	int32_t data_count;
-	int8_t reserved[52];	//reserve remaing 52 bytes
-	dentry_t d_entries[63]; //max of 63 entries available
+	int32_t journal_magic;	//JOURNAL_MAGIC if the image has a metadata journal
+	int32_t journal_start;	//first data block of the journal
+	int32_t journal_blocks;	//length of the journal in data blocks
+	int8_t reserved[40];	//reserve remaing 40 bytes
+	dentry_t d_entries[MAX_DENTRIES]; //max of 63 entries available
 }boot_block_t;
 
+/*
+ * One directory entry as returned by getdents. Records are fixed size, so a
+ * buffer of n * sizeof(dirent_t) bytes holds exactly n of them.
+ */
+typedef struct dirent{
+	int8_t fname[MAX_NAME_LEN];		// Not NULL terminated if the name is 32 characters long.
+	int32_t file_type;
+	int32_t inode_num;
+	int32_t length;					// Size in bytes, 0 for the RTC and directories.
+} dirent_t;
+
+/* File metadata as returned by stat/fstat, read straight from the inode. */
+typedef struct stat{
+	int32_t file_type;
+	int32_t inode_num;
+	int32_t length;			// Size in bytes, 0 for the RTC and directories.
+	int32_t blocks;			// Number of 4 kB data blocks the file occupies.
+} stat_t;
+
 typedef struct inode{
 	int32_t length;
-	int32_t data_block_num[1023];	//max of 1023 data block
+	int32_t data_block_num[MAX_FILE_BLOCKS];	//max of 1023 data block
 }inode_t;
 
+typedef struct extent{
+	int32_t start;		//first data block of the run
+	int32_t count;		//number of contiguous blocks
+}extent_t;
+
+/*
+ * An inode whose first block number is INODE_EXTENT_MAGIC lists runs of
+ * contiguous data blocks instead of single blocks. Its files are not
+ * limited to 1023 blocks, and a whole run can be copied at once.
+ */
+typedef struct inode_ext{
+	int32_t length;
+	int32_t magic;			//INODE_EXTENT_MAGIC, in the place of data_block_num[0]
+	int32_t extent_count;
+	extent_t extents[MAX_EXTENTS];
+}inode_ext_t;
+
+/*
+ * A compressed file. Every 4 kB of the file is compressed on its own (LZ4
+ * block format), so any block can be read without the ones before it. The
+ * compressed chunks are stored back to back in a contiguous run of data
+ * blocks. A chunk whose stored size equals its uncompressed size is kept
+ * raw. Compressed files are read-only.
+ */
+typedef struct inode_lz{
+	int32_t length;			//uncompressed length
+	int32_t magic;			//INODE_LZ_MAGIC, in the place of data_block_num[0]
+	int32_t start;			//first data block of the compressed stream
+	int32_t stored_blocks;	//data blocks the stream takes up
+	uint32_t offsets[MAX_LZ_CHUNKS + 1];	//where each chunk starts in the stream, then where the last one ends
+}inode_lz_t;
+
+/*
+ * A regular file opened by name for the kernel's own use (the program
+ * loader). The inode is held until file_handle_close.
+ */
+typedef struct file_handle{
+	uint32_t inode;			//inode number
+	uint32_t length;		//file length when it was opened
+	inode_t* inode_ptr;
+}file_handle_t;
+
+#define IS_EXTENT_INODE(inode) ((inode)->data_block_num[0] == INODE_EXTENT_MAGIC)
+#define IS_LZ_INODE(inode) ((inode)->data_block_num[0] == INODE_LZ_MAGIC)
+
 
 int32_t read_dentry_by_name (const uint8_t* fname, dentry_t* dentry);
 int32_t read_dentry_by_index (uint32_t index, dentry_t* dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t file_handle_open(const uint8_t* fname, file_handle_t* handle);
+int32_t file_handle_read(file_handle_t* handle, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t file_handle_map(file_handle_t* handle, uint32_t idx, uint8_t** data);
+void file_handle_close(file_handle_t* handle);
 extern void get_block_address(unsigned int address);
+int32_t fs_mount_disk(blkdev_t* dev);
 int32_t fopen();
 int32_t fclose();
 int32_t fwrite(int32_t fd, const void* buf, int32_t nbytes);
@@ -45,7 +127,12 @@ int32_t dir_open();
 int32_t dir_close();
 int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes);
 int32_t dir_read(int32_t fd, const void* buf, int32_t nbytes);
+int32_t dir_getdents(int32_t fd, void* buf, int32_t nbytes);
 int32_t get_file_length(dentry_t* dentry);
 int32_t get_file_length_by_name(uint8_t* fname);
+int32_t file_stat(int32_t file_type, int32_t inode_num, stat_t* st);
+int32_t file_create(const uint8_t* fname);
+int32_t file_truncate(uint32_t inode, uint32_t length);
+void fs_sync();
 
 #endif /* _FILE_H */
@@ -9,47 +9,17 @@
  * appropriate interrupt vectors for the system calls we must implement.
  */
 void idt_init(){
-	//SET_IDT_ENTRY(str, handler)
-	// Array of function pointers for 20 (really 18) non-reserved exceptions.
-	void* intFuncArr[20] = {divide_error,
-							reserved_error,
-							nonmask_interrupt, 
-							breakpoint, 
-							overflow,
-							bound_range_exceeded,
-							invalid_opcode,
-							device_unavailable,
-							double_fault,
-							coprocessor_segment_overrun,
-							invalid_tss,
-							segment_not_present,
-							stack_segment_fault,
-							general_protection,
-							page_fault,
-							reserved_error,
-							fpu_floating_point_error,
-							alignment_check,
-							machine_check,
-							simd_floating_point_exception};
-	
 	/* 
 	 * Set all of the interrupt vectors for the intel-defined exceptions to
-	 * point to our exception handler. 
+	 * point to their assembly stubs, which all end up in exception_dispatch.
 	 */
 	int idtIt;				// Iterator over the interrupt vectors.
-	int numExcept = 32;		// Number of intel-defined exceptions.
-	for(idtIt = 0; idtIt < numExcept; idtIt++){
+	for(idtIt = 0; idtIt < NUM_EXCEPTIONS; idtIt++){
 		idt[idtIt].size = 0x1;			// This is a 32-bit gate.
 		idt[idtIt].seg_selector = KERNEL_CS;
 		idt[idtIt].reserved1 = 0x1;		// Set these reserved bits to signal to the IDT that this is an interrupt.
 		idt[idtIt].reserved2 = 0x1;
-		
-		if(idtIt < 20){ //20 (really 18) non-reserved exceptions.
-			SET_IDT_ENTRY(idt[idtIt], intFuncArr[idtIt]);
-		}
-		else{
-			SET_IDT_ENTRY(idt[idtIt], &reserved_error);
-		}
+		SET_IDT_ENTRY(idt[idtIt], exception_linker_table[idtIt]);
 		idt[idtIt].present = 0x1;		// Mark the interrupt as present.		
 	}
 	
@@ -63,3 +33,30 @@ void idt_init(){
 	SET_IDT_ENTRY(idt[0x80], &syscall_linker);
 	idt[0x80].present = 0x1;		// Mark the interrupt as present.		
 }
+
+/*
+ * Points the SYSENTER MSRs at sysenter_linker. SYSEXIT derives the user
+ * selectors from IA32_SYSENTER_CS (+16 for CS, +24 for SS), which lines up
+ * with our GDT: KERNEL_CS + 16 is USER_CS and KERNEL_CS + 24 is USER_DS.
+ *
+ * RETURN: 0 on success, -1 if the processor has no SYSENTER (programs must
+ *		   then stick to INT 0x80).
+ */
+int32_t sysenter_init(){
+	uint32_t features;
+	asm volatile(
+		"cpuid;"
+		:"=d"(features)
+		:"a"(1)
+		:"ebx", "ecx"
+	);
+	if(!(features & CPUID_SEP)){
+		return -1;
+	}
+	
+	/* The ESP value is only a placeholder, sysenter_linker loads tss.esp0. */
+	wrmsr(IA32_SYSENTER_CS, KERNEL_CS, 0);
+	wrmsr(IA32_SYSENTER_ESP, tss.esp0, 0);
+	wrmsr(IA32_SYSENTER_EIP, (uint32_t)&sysenter_linker, 0);
+	return 0;
+}
@@ -6,6 +6,15 @@
 #include "interrupts.h"
 #include "syscalls.h"
 
+/* Model specific registers used by SYSENTER. */
+#define IA32_SYSENTER_CS	0x174
+#define IA32_SYSENTER_ESP	0x175
+#define IA32_SYSENTER_EIP	0x176
+#define CPUID_SEP			0x800		// CPUID.1:EDX bit 11, SYSENTER/SYSEXIT present.
+
 void idt_init();
 
+/* Enables the SYSENTER system call path if the processor supports it. */
+int32_t sysenter_init();
+
 #endif
@@ -1,128 +1,112 @@
 /* This file will implement the interrupts and exceptions in the interrupt table. */
 #include "interrupts.h"
 #include "lib.h"
+#include "syscalls.h"
+#include "trace.h"
+
+/* Human readable names for the 32 intel-defined exceptions. */
+static int8_t* exception_names[NUM_EXCEPTIONS] = {
+	"Division error",
+	"Debug exception",
+	"Nonmaskable interrupt",
+	"Breakpoint reached",
+	"OVERFLOW error!",
+	"Index out of bounds!",
+	"Invalid opcode",
+	"Device unavailable",
+	"Double fault",
+	"coprocessor segment overrun",
+	"Invalid tss",
+	"Segment not present",
+	"Stack segment fault",
+	"General protection exception",
+	"PAGE FAULT",
+	"RESERVED INTERRUPT CALLED!!!",
+	"FPU floating point error",
+	"Alignment check exception",
+	"Machine check exception",
+	"SIMD floating point exception"
+};
 
 /*
- * This section of code implements the 32 intel-defined exceptions at the 
- * beginning of the IDT.
+ * Ring buffer of the most recent faults. exc_log_count only ever grows, so
+ * the newest entry lives at (exc_log_count - 1) % EXC_LOG_SIZE.
  */
-uint32_t exception_handler(){
-	while(1){
-		puts("Made it to the exception handler\n");
-	};
-	return 0;
-}
-
-uint32_t reserved_error(){
-	puts("RESERVED INTERRUPT CALLED!!!\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t divide_error(){
-	puts("Division error\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t nonmask_interrupt(){
-	puts("Nonmaskable interrupt\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t breakpoint(){
-	puts("Breakpoint reached\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t overflow(){
-	puts("OVERFLOW error!\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t bound_range_exceeded(){
-	puts("Index out of bounds!\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t invalid_opcode(){
-	puts("Invalid opcode\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t device_unavailable(){
-	puts("Device unavailable\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t double_fault(){
-	puts("Double fault\n");
-	while(1){}
-	return -1;
-}
+static exc_log_entry_t exc_log[EXC_LOG_SIZE];
+static uint32_t exc_log_count = 0;
 
-uint32_t coprocessor_segment_overrun(){
-	puts("coprocessor segment overrun\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t invalid_tss(){
-	puts("Invalid tss\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t segment_not_present(){
-	puts("Segment not present\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t stack_segment_fault(){
-	puts("Stack segment fault\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t general_protection(){
-	puts("General protection exception\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t page_fault(){
-	puts("PAGE FAULT\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t fpu_floating_point_error(){
-	puts("FPU floating point error\n");
-	while(1){}
-	return -1;
-}
-
-uint32_t alignment_check(){
-	puts("Alignment check exception\n");
-	while(1){}
-	return -1;
+/*
+ * Copies the n-th most recent log entry into entry.
+ * RETURN: 0 on success, -1 if fewer than n+1 faults have been logged.
+ */
+static int32_t get_exception_log(uint32_t n, exc_log_entry_t* entry){
+	if(entry == NULL || n >= EXC_LOG_SIZE || n >= exc_log_count){
+		return -1;
+	}
+	*entry = exc_log[(exc_log_count - 1 - n) % EXC_LOG_SIZE];
+	return 0;
 }
 
-uint32_t machine_check(){
-	puts("Machine check exception");
-	while(1){}
-	return -1;
+/* Prints every entry still held in the log, oldest first. */
+static void dump_exception_log(){
+	exc_log_entry_t entry;
+	int32_t n = (exc_log_count < EXC_LOG_SIZE) ? exc_log_count : EXC_LOG_SIZE;
+	for(n = n - 1; n >= 0; n--){
+		get_exception_log(n, &entry);
+		printf("pid %d vec %d eip 0x%x cr2 0x%x err 0x%x\n",
+				entry.pid, entry.vector, entry.eip, entry.cr2, entry.error_code);
+	}
 }
 
-uint32_t simd_floating_point_exception(){
-	puts("SIMD floating point exception");
+/*
+ * This section of code implements the 32 intel-defined exceptions at the
+ * beginning of the IDT. Every vector enters through exc_common in x86_desc.S,
+ * which hands us the full trap frame.
+ *
+ * Faults raised in user mode kill only the offending program: its parent's
+ * execute returns EXCEPTION_STATUS, or a base shell is started again, and
+ * every other terminal keeps running.
+ * Faults raised by the kernel itself cannot be recovered from, so we still
+ * stop the machine there.
+ */
+void exception_dispatch(exc_frame_t* frame){
+	uint32_t cr2 = 0;
+	if(frame -> vector == PAGE_FAULT_VEC){
+		asm volatile(
+			"movl	%%cr2, %0;"
+			:"=r"(cr2)
+			:
+		);
+		TRACE_EVENT(TR_PAGE_FAULT, frame -> eip, cr2);
+		proc_stat_t* stat = acct_current();
+		if(stat != NULL){
+			stat -> page_faults++;
+		}
+	}
+
+	/* Record the fault before doing anything that could fault again. */
+	exc_log_entry_t* entry = &exc_log[exc_log_count % EXC_LOG_SIZE];
+	entry -> vector = frame -> vector;
+	entry -> error_code = frame -> error_code;
+	entry -> eip = frame -> eip;
+	entry -> cr2 = cr2;
+	entry -> pid = get_process_number();
+	exc_log_count++;
+
+	int8_t* name = "RESERVED INTERRUPT CALLED!!!";
+	if(frame -> vector < NUM_EXCEPTIONS && exception_names[frame -> vector] != NULL){
+		name = exception_names[frame -> vector];
+	}
+	printf("pid %d: %s (eip 0x%x, cr2 0x%x, err 0x%x)\n", entry -> pid, name, entry -> eip, entry -> cr2, entry -> error_code);
+
+	/* The low two bits of the saved CS are the privilege level we came from. */
+	if((frame -> cs & 0x3) == 0x3){
+		kill_process(EXCEPTION_STATUS);
+	}
+
+	/* Whatever faulted before this one may explain it. */
+	dump_exception_log();
+	puts("Unrecoverable exception, system halted.\n");
+	cli();
 	while(1){}
-	return -1;
 }
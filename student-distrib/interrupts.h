@@ -4,71 +4,77 @@
 /* This file will handle instantiation of the intel exceptions */
 #include "types.h"
 
+#define NUM_EXCEPTIONS		32		// Number of intel-defined exception vectors.
+#define EXC_LOG_SIZE		16		// Number of faults remembered in the exception log (power of 2).
+#define EXCEPTION_STATUS	256		// Status returned to the parent when a program dies by exception.
+#define PAGE_FAULT_VEC		14		// The page fault vector, the only one that sets CR2.
+
+#ifndef ASM
+/*
+ * This is the trap frame built by exc_common in x86_desc.S. The fields are
+ * in increasing address order: pushal, then the vector and error code the
+ * stub pushed, then what the processor pushed. user_esp and user_ss are
+ * only valid when the fault came from ring 3.
+ */
+typedef struct exc_frame{
+	uint32_t edi;
+	uint32_t esi;
+	uint32_t ebp;
+	uint32_t esp;				// Kernel ESP at pushal time, not the faulting ESP.
+	uint32_t ebx;
+	uint32_t edx;
+	uint32_t ecx;
+	uint32_t eax;
+	uint32_t vector;
+	uint32_t error_code;		// Zero for vectors that do not push one.
+	uint32_t eip;
+	uint32_t cs;
+	uint32_t eflags;
+	uint32_t user_esp;
+	uint32_t user_ss;
+} exc_frame_t;
+
+/*
+ * What an IRQ linker in x86_desc.S hands its handler: pushal, then what
+ * the processor pushed. As above, user_esp and user_ss are only there when
+ * the interrupt came from ring 3.
+ */
+typedef struct irq_frame{
+	uint32_t edi;
+	uint32_t esi;
+	uint32_t ebp;
+	uint32_t esp;
+	uint32_t ebx;
+	uint32_t edx;
+	uint32_t ecx;
+	uint32_t eax;
+	uint32_t eip;
+	uint32_t cs;
+	uint32_t eflags;
+	uint32_t user_esp;
+	uint32_t user_ss;
+} irq_frame_t;
+
+/* A single entry of the exception ring buffer. */
+typedef struct exc_log_entry{
+	uint32_t vector;
+	uint32_t error_code;
+	uint32_t eip;
+	uint32_t cr2;
+	int32_t pid;
+} exc_log_entry_t;
+
 /* Keyboard interrupt handler. */
 void keyboard_handler();
 
-/* The exception handler will perform the necessary assembly linkage before
- * continuting on ot the called exception. */
-uint32_t exception_handler();
-
-uint32_t reserved_error();
-
-uint32_t divide_error();
-
-uint32_t nonmask_interrupt();
-
-uint32_t breakpoint();
-
-uint32_t overflow();
-
-uint32_t bound_range_exceeded();
-
-uint32_t invalid_opcode();
-
-uint32_t device_unavailable();
-
-uint32_t double_fault();
-
-uint32_t coprocessor_segment_overrun();
-
-uint32_t invalid_tss();
-
-uint32_t segment_not_present();
-
-uint32_t stack_segment_fault();
-
-uint32_t general_protection();
-
-uint32_t page_fault();
-
-uint32_t fpu_floating_point_error();
-
-uint32_t alignment_check();
-
-uint32_t machine_check();
+/*
+ * Per-vector assembly stubs (x86_desc.S). Each one funnels into
+ * exception_dispatch with a uniform exc_frame_t.
+ */
+extern uint32_t exception_linker_table[NUM_EXCEPTIONS];
 
-uint32_t simd_floating_point_exception();
+/* Common C entry point for all 32 intel-defined exceptions. */
+void exception_dispatch(exc_frame_t* frame);
+#endif		// ASM
 
-// Array of function pointers.
-/*void* intFuncArr[20] = {&divide_error,
-						&reserved_error,
-						&nonmask_interrupt, 
-						&breakpoint, 
-						&overflow,
-						&bound_range_exceeded,
-						&invalid_opcode,
-						&device_unavailable,
-						&double_fault,
-						&coprocessor_segment_overrun,
-						&invalid_tss,
-						&segment_not_present,
-						&stack_segment_fault,
-						&general_protection,
-						&page_fault,
-						&reserved_error,
-						&fpu_floating_point_error,
-						&alignment_check,
-						&machine_check,
-						&simd_floating_point_exception};*/
-						
 #endif
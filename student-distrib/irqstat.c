@@ -0,0 +1,152 @@
+/*
+ * This file will contain the interrupt latency statistics.
+ *
+ * Every IRQ linker calls irq_enter and irq_exit, and every cli/sti pair in
+ * lib.h calls irqoff_begin and irqoff_end. Durations go into log2
+ * histograms of TSC cycles, so one stuck handler or one long cli section
+ * stands out instead of disappearing into an average. Only the low half of
+ * the TSC is read: nothing here runs for 2^32 cycles, and unsigned
+ * subtraction handles the wrap.
+ */
+#include "irqstat.h"
+#include "lib.h"
+#include "clock.h"
+#include "trace.h"
+
+static irqstat_t stats;
+static uint32_t irq_start[IRQSTAT_LINES];	// Kept here, not on the stack: pit_handler returns on another one.
+
+/* The window of interrupts off that is open, if any. */
+static uint32_t irqoff_active = 0;
+static uint32_t irqoff_start;
+static const int8_t* irqoff_file;
+static uint32_t irqoff_line;
+
+/* uint32_t tsc_lo()
+ * Inputs:      NONE
+ * Return Value: low 32 bits of the time stamp counter */
+static inline uint32_t tsc_lo(){
+	uint32_t lo;
+	asm volatile("rdtsc" : "=a"(lo) : : "edx");
+	return lo;
+}
+
+/* uint32_t record(irq_hist_t* h, uint32_t cycles)
+ * Inputs:      irq_hist_t* h = histogram to add to
+ *              uint32_t cycles = duration
+ * Return Value: 1 if this is the longest h has seen, 0 otherwise */
+static uint32_t record(irq_hist_t* h, uint32_t cycles){
+	uint32_t b = 0;
+
+	if(cycles != 0){
+		asm("bsrl %1, %0" : "=r"(b) : "rm"(cycles));
+	}
+	h->count++;
+	h->bucket[b]++;
+	if(cycles > h->max){
+		h->max = cycles;
+		return 1;
+	}
+	return 0;
+}
+
+/* void set_site(const int8_t* file, uint32_t line)
+ * Inputs:      const int8_t* file = source file, or "irq" for a handler
+ *              uint32_t line = line number, or the IRQ line
+ * Return Value: NONE
+ * Function: remembers where the longest interrupts-off window started as "file:line".
+ * Only the part of file after the last '/' is kept. */
+static void set_site(const int8_t* file, uint32_t line){
+	const int8_t* base = file;
+	int8_t num[12];
+	uint32_t i = 0, j;
+
+	for(; *file != '\0'; file++){
+		if(*file == '/'){
+			base = file + 1;
+		}
+	}
+	for(; *base != '\0' && i < IRQSTAT_SITE_LEN - 1; base++){
+		stats.irqoff_site[i++] = *base;
+	}
+	itoa(line, num, 10);
+	if(i < IRQSTAT_SITE_LEN - 1){
+		stats.irqoff_site[i++] = ':';
+	}
+	for(j = 0; num[j] != '\0' && i < IRQSTAT_SITE_LEN - 1; j++){
+		stats.irqoff_site[i++] = num[j];
+	}
+	stats.irqoff_site[i] = '\0';
+}
+
+/* void irq_enter(uint32_t irq)
+ * Inputs:      uint32_t irq = IRQ line
+ * Return Value: NONE
+ * Function: an interrupt arriving means interrupts were on, so a window
+ * still open was left by code that turned them on some other way (an iret
+ * into a user program, say) and is dropped rather than counted. */
+void irq_enter(uint32_t irq){
+	TRACE_EVENT(TR_IRQ, irq, 0);
+	irqoff_active = 0;
+	irq_start[irq] = tsc_lo();
+}
+
+/* void irq_exit(uint32_t irq)
+ * Inputs:      uint32_t irq = IRQ line
+ * Return Value: NONE
+ * Function: handlers run behind interrupt gates, so the time spent in one
+ * is also time with interrupts off and is counted as both. */
+void irq_exit(uint32_t irq){
+	uint32_t cycles = tsc_lo() - irq_start[irq];
+
+	record(&stats.handler[irq], cycles);
+	if(record(&stats.irqoff, cycles)){
+		set_site("irq", irq);
+	}
+	TRACE_EVENT(TR_IRQRET, irq, 0);
+}
+
+/* void irqoff_begin(const int8_t* file, uint32_t line)
+ * Inputs:      const int8_t* file, uint32_t line = call site of the cli
+ * Return Value: NONE
+ * Function: only called when interrupts were on, so it always opens a new window */
+void irqoff_begin(const int8_t* file, uint32_t line){
+	irqoff_file = file;
+	irqoff_line = line;
+	irqoff_start = tsc_lo();
+	irqoff_active = 1;
+}
+
+/* void irqoff_end()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: closes the open window, if any; called just before interrupts go back on */
+void irqoff_end(){
+	if(!irqoff_active){
+		return;
+	}
+	irqoff_active = 0;
+	if(record(&stats.irqoff, tsc_lo() - irqoff_start)){
+		set_site(irqoff_file, irqoff_line);
+	}
+}
+
+/* void irqstat_get(irqstat_t* buf, int32_t flags)
+ * Inputs:      irqstat_t* buf = where to copy the statistics, may be NULL
+ *              int32_t flags = IRQSTAT_RESET to zero them afterwards
+ * Return Value: NONE
+ * Function: copies with interrupts off so a handler cannot change them halfway.
+ * The asm is used instead of cli_and_save, which would count this window too. */
+void irqstat_get(irqstat_t* buf, int32_t flags){
+	uint32_t eflags;
+
+	asm volatile("pushfl; popl %0; cli" : "=r"(eflags) : : "memory", "cc");
+	stats.tsc_khz = clock_tsc_khz();
+	if(buf != NULL){
+		memcpy(buf, &stats, sizeof(stats));
+	}
+	if(flags & IRQSTAT_RESET){
+		memset(&stats, 0, sizeof(stats));
+	}
+	asm volatile("pushl %0; popfl" : : "r"(eflags) : "memory", "cc");
+}
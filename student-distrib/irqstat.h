@@ -0,0 +1,43 @@
+#ifndef _IRQSTAT_H
+#define _IRQSTAT_H
+
+/* How long interrupt handlers run and how long interrupts stay off, in TSC cycles. */
+#include "types.h"
+
+#define IRQSTAT_LINES		16			// PIC lines.
+#define IRQSTAT_BUCKETS		32			// Bucket i counts durations of 2^i to 2^(i+1)-1 cycles.
+#define IRQSTAT_SITE_LEN	32
+#define IRQSTAT_RESET		1			// sys_irqstat flag: zero everything after copying.
+
+#ifndef ASM
+/* A log2 histogram of durations. */
+typedef struct irq_hist{
+	uint32_t count;
+	uint32_t max;						// Longest, in cycles.
+	uint32_t bucket[IRQSTAT_BUCKETS];
+} irq_hist_t;
+
+/* What sys_irqstat copies out. */
+typedef struct irqstat{
+	uint32_t tsc_khz;					// For turning cycles into time.
+	irq_hist_t handler[IRQSTAT_LINES];	// Entry to exit of each IRQ's linker.
+	irq_hist_t irqoff;					// Windows between cli and the matching sti, handlers included.
+	int8_t irqoff_site[IRQSTAT_SITE_LEN];	// Where the longest one started: "file.c:line" or "irq:n".
+} irqstat_t;
+
+/* Called by the IRQ linkers in x86_desc.S around each handler. */
+void irq_enter(uint32_t irq);
+void irq_exit(uint32_t irq);
+
+/*
+ * Called by cli(), cli_and_save() and friends in lib.h when they turn
+ * interrupts off or back on. file and line name the call site.
+ */
+void irqoff_begin(const int8_t* file, uint32_t line);
+void irqoff_end();
+
+/* Copies the statistics to buf (if not NULL); IRQSTAT_RESET zeroes them afterwards. */
+void irqstat_get(irqstat_t* buf, int32_t flags);
+#endif		// ASM
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * This file will contain the metadata journal.
+ *
+ * Updates to the boot block and inodes are not written in place right
+ * away. Each operation (create, truncate, a write that grows a file) runs
+ * between journal_begin_op and journal_end_op and hands the blocks it
+ * changed to journal_dirty. They stay in memory, and up to
+ * JOURNAL_GROUP_OPS operations are grouped into one transaction so a burst
+ * of appends costs one commit instead of one inode write each.
+ *
+ * A commit writes a descriptor and a copy of every block to the journal
+ * area, then the commit block, and only then writes the blocks to their
+ * real locations and clears the descriptor. A crash before the commit
+ * block lands leaves the image as it was before the transaction; a crash
+ * after it is finished by journal_replay at the next mount. The journal
+ * never holds more than one transaction, so replay reads at most
+ * JOURNAL_BLOCKS blocks.
+ *
+ * Data blocks are still written through as they are filled, so they are
+ * on disk before any inode that points at them commits.
+ */
+#include "journal.h"
+#include "lib.h"
+#include "bcache.h"
+
+static blkdev_t* jdev = NULL;			// NULL until journal_init; metadata is written through until then.
+static uint32_t jstart;					// Image block of the descriptor.
+static uint32_t jseq = 1;				// Sequence number of the next transaction.
+
+/* The running transaction. */
+static uint32_t txn_count = 0;
+static uint32_t txn_ops = 0;
+static uint32_t txn_block[JOURNAL_MAX_TXN];
+static uint8_t* txn_data[JOURNAL_MAX_TXN];
+
+/* Descriptor, copies and commit block, laid out as they are on disk. */
+static uint8_t jbuf[JOURNAL_BLOCKS * FOUR_KB];
+
+/* int32_t block_io(blkdev_t* dev, uint32_t block, uint32_t count, uint8_t* buf, uint32_t write)
+ * Inputs:      blkdev_t* dev = disk to use
+ *              uint32_t block = first image block
+ *              uint32_t count = number of 4 kB blocks
+ *              uint8_t* buf = source or destination
+ *              uint32_t write = nonzero to write
+ * Return Value: 0 if success else -1
+ * Function: splits the transfer into requests the driver accepts */
+static int32_t block_io(blkdev_t* dev, uint32_t block, uint32_t count, uint8_t* buf, uint32_t write){
+	uint32_t per = dev->max_sectors / SECTORS_PER_BLOCK;
+	uint32_t n;
+
+	if(per == 0){
+		per = 1;
+	}
+	for(; count > 0; count -= n, block += n, buf += n * FOUR_KB){
+		n = (count < per) ? count : per;
+		int32_t ret = write ? dev->write(block * SECTORS_PER_BLOCK, n * SECTORS_PER_BLOCK, buf)
+		                    : dev->read(block * SECTORS_PER_BLOCK, n * SECTORS_PER_BLOCK, buf);
+		if(ret == -1){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* uint32_t checksum(const uint8_t* data, uint32_t count)
+ * Inputs:      const uint8_t* data = count consecutive 4 kB blocks
+ *              uint32_t count = number of blocks
+ * Return Value: rotate-and-xor over every word */
+static uint32_t checksum(const uint8_t* data, uint32_t count){
+	const uint32_t* word = (const uint32_t*)data;
+	uint32_t sum = 0;
+	uint32_t i;
+
+	for(i = 0; i < count * FOUR_KB / 4; i++){
+		sum = ((sum << 1) | (sum >> 31)) ^ word[i];
+	}
+	return sum;
+}
+
+/* int32_t journal_replay(blkdev_t* dev, uint32_t start, uint32_t nblocks)
+ * Inputs:      blkdev_t* dev = disk (or RAM image) holding the filesystem
+ *              uint32_t start = image block of the journal area
+ *              uint32_t nblocks = size of the journal area
+ * Return Value: blocks replayed, -1 if the journal could not be read
+ * Function: copies a committed transaction to its home locations. A
+ * transaction without a matching commit block never reached its home
+ * locations, so it is simply dropped. */
+int32_t journal_replay(blkdev_t* dev, uint32_t start, uint32_t nblocks){
+	journal_desc_t* d = (journal_desc_t*)jbuf;
+	uint32_t i;
+
+	if(nblocks < 3 || nblocks > JOURNAL_BLOCKS || block_io(dev, start, 1, jbuf, 0) == -1){
+		return -1;
+	}
+	jseq = d->seq + 1;
+	if(d->magic != JOURNAL_DESC_MAGIC || d->count == 0 || d->count > nblocks - 2){
+		return 0;
+	}
+	uint32_t count = d->count;
+	if(block_io(dev, start + 1, count + 1, jbuf + FOUR_KB, 0) == -1){
+		return -1;
+	}
+	journal_commit_t* c = (journal_commit_t*)(jbuf + (count + 1) * FOUR_KB);
+	if(c->magic != JOURNAL_COMMIT_MAGIC || c->seq != d->seq || c->checksum != checksum(jbuf + FOUR_KB, count)){
+		return 0;
+	}
+
+	for(i = 0; i < count; i++){
+		if((d->target[i] + 1) * SECTORS_PER_BLOCK > dev->sectors || d->target[i] - start < nblocks){
+			continue;		// Never overwrite the journal itself or run off the disk.
+		}
+		if(block_io(dev, d->target[i], 1, jbuf + (i + 1) * FOUR_KB, 1) == -1){
+			return -1;
+		}
+	}
+	d->magic = 0;
+	if(block_io(dev, start, 1, jbuf, 1) == -1){
+		return -1;
+	}
+	return count;
+}
+
+/* void journal_init(blkdev_t* dev, uint32_t start)
+ * Inputs:      blkdev_t* dev = disk holding the filesystem
+ *              uint32_t start = image block of the journal area
+ * Return Value: NONE
+ * Function: from now on journal_dirty logs instead of writing through */
+void journal_init(blkdev_t* dev, uint32_t start){
+	jdev = dev;
+	jstart = start;
+	txn_count = 0;
+	txn_ops = 0;
+}
+
+/* int32_t journal_begin_op(uint32_t nblocks)
+ * Inputs:      uint32_t nblocks = most blocks the operation will dirty
+ * Return Value: 1 if the running transaction was committed to make room
+ * Function: callers must have preemption disabled until journal_end_op */
+int32_t journal_begin_op(uint32_t nblocks){
+	if(jdev == NULL || txn_count + nblocks <= JOURNAL_MAX_TXN){
+		return 0;
+	}
+	return (journal_commit() == 0) ? 1 : 0;
+}
+
+/* int32_t journal_end_op()
+ * Inputs:      NONE
+ * Return Value: 1 if this completed a group and it was committed
+ * Function: operations are only committed whole, so this is the only
+ * place besides journal_begin_op and journal_commit a commit happens */
+int32_t journal_end_op(){
+	if(jdev == NULL){
+		return 0;
+	}
+	if(++txn_ops < JOURNAL_GROUP_OPS){
+		return 0;
+	}
+	return (journal_commit() == 0) ? 1 : 0;
+}
+
+/* int32_t journal_dirty(uint32_t block, void* data)
+ * Inputs:      uint32_t block = image block number
+ *              void* data = the block's contents (see journal.h)
+ * Return Value: 0 if logged, -1 if it must be written through
+ * Function: a block already in the transaction is simply logged again
+ * with its newest contents at commit time */
+int32_t journal_dirty(uint32_t block, void* data){
+	uint32_t i;
+
+	if(jdev == NULL){
+		return -1;
+	}
+	for(i = 0; i < txn_count; i++){
+		if(txn_block[i] == block){
+			return 0;
+		}
+	}
+	if(txn_count == JOURNAL_MAX_TXN){
+		return -1;
+	}
+	if(block != 0){
+		uint8_t* held = bcache_get(block);		// A second hold keeps it cached until the commit.
+		if(held != data){
+			if(held != NULL){
+				bcache_put(held, 0);
+			}
+			return -1;
+		}
+	}
+	txn_block[txn_count] = block;
+	txn_data[txn_count] = (uint8_t*)data;
+	txn_count++;
+	return 0;
+}
+
+/* int32_t journal_commit()
+ * Inputs:      NONE
+ * Return Value: 0 if success else -1
+ * Function: logs, then checkpoints the running transaction. On failure the
+ * transaction is kept and the next commit tries again. Callers must have
+ * preemption disabled. */
+int32_t journal_commit(){
+	journal_desc_t* d = (journal_desc_t*)jbuf;
+	uint32_t i;
+
+	txn_ops = 0;
+	if(jdev == NULL || txn_count == 0){
+		return 0;
+	}
+
+	d->magic = JOURNAL_DESC_MAGIC;
+	d->seq = jseq;
+	d->count = txn_count;
+	for(i = 0; i < txn_count; i++){
+		d->target[i] = txn_block[i];
+		memcpy(jbuf + (i + 1) * FOUR_KB, txn_data[i], FOUR_KB);
+	}
+	uint8_t* commit = jbuf + (txn_count + 1) * FOUR_KB;
+	journal_commit_t* c = (journal_commit_t*)commit;
+	memset(commit, 0, FOUR_KB);
+	c->magic = JOURNAL_COMMIT_MAGIC;
+	c->seq = jseq;
+	c->checksum = checksum(jbuf + FOUR_KB, txn_count);
+
+	/* The commit block must not reach the disk before the copies it vouches for. */
+	if(block_io(jdev, jstart, txn_count + 1, jbuf, 1) == -1 ||
+	   block_io(jdev, jstart + txn_count + 1, 1, commit, 1) == -1){
+		return -1;
+	}
+
+	/* Committed. A crash from here on is finished by journal_replay. */
+	for(i = 0; i < txn_count; i++){
+		if(block_io(jdev, txn_block[i], 1, txn_data[i], 1) == -1){
+			return -1;
+		}
+	}
+	d->magic = 0;
+	if(block_io(jdev, jstart, 1, jbuf, 1) == -1){
+		return -1;
+	}
+
+	for(i = 0; i < txn_count; i++){
+		if(txn_block[i] != 0){
+			bcache_put(txn_data[i], 0);
+		}
+	}
+	txn_count = 0;
+	jseq++;
+	return 0;
+}
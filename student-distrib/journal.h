@@ -0,0 +1,61 @@
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+/* Write-ahead journal for filesystem metadata: the boot block and the inodes. */
+#include "types.h"
+#include "file.h"
+#include "blkdev.h"
+
+#define JOURNAL_MAGIC			0x4C4E524A		// "JRNL" in boot_block_t.journal_magic.
+#define JOURNAL_DESC_MAGIC		0x4353444A		// "JDSC", first block of a transaction.
+#define JOURNAL_COMMIT_MAGIC	0x544D434A		// "JCMT", last block of a transaction.
+#define JOURNAL_BLOCKS			32				// Size of the journal area in 4 kB blocks.
+#define JOURNAL_MAX_TXN			(JOURNAL_BLOCKS - 2)	// Room left beside the descriptor and commit blocks.
+#define JOURNAL_GROUP_OPS		32				// Operations grouped into one transaction.
+
+#ifndef ASM
+/* First block of the journal area. magic is cleared once the transaction is checkpointed. */
+typedef struct journal_desc{
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t count;								// Block copies that follow.
+	uint32_t target[JOURNAL_MAX_TXN];			// Where each copy belongs in the image.
+} journal_desc_t;
+
+/* Written after the copies. The transaction counts only if this matches the descriptor. */
+typedef struct journal_commit{
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t checksum;							// Over the copies, catches a torn write.
+} journal_commit_t;
+
+/*
+ * Applies a committed but unfinished transaction found in the journal area
+ * (nblocks blocks starting at image block start) and retires it.
+ * RETURN: number of blocks replayed, -1 if the journal could not be read.
+ */
+int32_t journal_replay(blkdev_t* dev, uint32_t start, uint32_t nblocks);
+
+/* Starts logging metadata to the journal area. Call journal_replay on it first. */
+void journal_init(blkdev_t* dev, uint32_t start);
+
+/*
+ * Brackets one metadata update that dirties at most nblocks blocks. Each
+ * returns 1 if it committed the running transaction, 0 otherwise.
+ */
+int32_t journal_begin_op(uint32_t nblocks);
+int32_t journal_end_op();
+
+/*
+ * Adds a modified metadata block to the running transaction. data must stay
+ * valid until the commit: the boot block is static, anything else is a
+ * buffer cache block that the journal holds on to.
+ * RETURN: 0 if logged, -1 if the caller should write it through itself.
+ */
+int32_t journal_dirty(uint32_t block, void* data);
+
+/* Writes out the running transaction and checkpoints it. 0 on success, -1 on I/O failure. */
+int32_t journal_commit();
+#endif		// ASM
+
+#endif
@@ -17,6 +17,14 @@
 #include "page.h"
 #include "terminal.h"
 #include "task_switch.h"
+#include "file.h"
+#include "ata.h"
+#include "pci.h"
+#include "virtio.h"
+#include "clock.h"
+#include "timer.h"
+#include "serial.h"
+#include "bootprof.h"
 
 #define RUN_TESTS
 
@@ -24,24 +32,11 @@
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags, bit)   ((flags) & (1 << (bit)))
 
-/* Check if MAGIC is valid and print the Multiboot information structure
-   pointed by ADDR. */
-void entry(unsigned long magic, unsigned long addr) {
-
-    multiboot_info_t *mbi;
-
+/* Print the Multiboot information structure MBI. */
+static void multiboot_print(multiboot_info_t *mbi) {
     /* Clear the screen. */
     clear();
 
-    /* Am I booted by a Multiboot-compliant boot loader? */
-    if (magic != MULTIBOOT_BOOTLOADER_MAGIC) {
-        printf("Invalid magic number: 0x%#x\n", (unsigned)magic);
-        return;
-    }
-
-    /* Set MBI to the address of the Multiboot information structure. */
-    mbi = (multiboot_info_t *) addr;
-
     /* Print out the flags. */
     printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -61,7 +56,6 @@ void entry(unsigned long magic, unsigned long addr) {
         int mod_count = 0;
         int i;
         module_t* mod = (module_t*)mbi->mods_addr;
-        get_block_address((unsigned int)mod->mod_start);
         while (mod_count < mbi->mods_count) {
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
@@ -74,11 +68,6 @@ void entry(unsigned long magic, unsigned long addr) {
             mod++;
         }
     }
-    /* Bits 4 and 5 are mutually exclusive! */
-    if (CHECK_FLAG(mbi->flags, 4) && CHECK_FLAG(mbi->flags, 5)) {
-        printf("Both bits 4 and 5 are set.\n");
-        return;
-    }
 
     /* Is the section header table of ELF valid? */
     if (CHECK_FLAG(mbi->flags, 5)) {
@@ -104,6 +93,44 @@ void entry(unsigned long magic, unsigned long addr) {
                     (unsigned)mmap->length_high,
                     (unsigned)mmap->length_low);
     }
+}
+
+/* Check if MAGIC is valid and print the Multiboot information structure
+   pointed by ADDR. */
+void entry(unsigned long magic, unsigned long addr) {
+
+    multiboot_info_t *mbi;
+    int fs_mounted = 0;
+
+    boot_mark(BOOT_ENTRY);
+
+    /* Am I booted by a Multiboot-compliant boot loader? */
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC) {
+        clear();
+        printf("Invalid magic number: 0x%#x\n", (unsigned)magic);
+        return;
+    }
+
+    /* Set MBI to the address of the Multiboot information structure. */
+    mbi = (multiboot_info_t *) addr;
+
+    /* A fast boot prints nothing here; terminal_open clears the screen anyway. */
+    if (CHECK_FLAG(mbi->flags, 2))
+        boot_parse_cmdline((int8_t *)mbi->cmdline);
+    if (!boot_fast)
+        multiboot_print(mbi);
+
+    if (CHECK_FLAG(mbi->flags, 3) && mbi->mods_count > 0) {
+        module_t* mod = (module_t*)mbi->mods_addr;
+        get_block_address((unsigned int)mod->mod_start);
+        fs_mounted = 1;
+    }
+    /* Bits 4 and 5 are mutually exclusive! */
+    if (CHECK_FLAG(mbi->flags, 4) && CHECK_FLAG(mbi->flags, 5)) {
+        printf("Both bits 4 and 5 are set.\n");
+        return;
+    }
+    boot_mark(BOOT_MULTIBOOT);
 
     /* Construct an LDT entry in the GDT */
     {
@@ -145,30 +172,74 @@ void entry(unsigned long magic, unsigned long addr) {
         tss.esp0 = 0x800000;
         ltr(KERNEL_TSS);
     }
+    boot_mark(BOOT_GDT);
 	
 	/* Init the IDT */
 	idt_init();
+	sysenter_init();
+	boot_mark(BOOT_IDT);
 	
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
 	/***** Init the PIC *****/
     i8259_init();
+	boot_mark(BOOT_PIC);
 	
 	/***** Keyboard initialization. *****/
 	keyboard_init();
 	enable_irq(1);		// The keyboard is connected to IRQ1 on the master.
+	boot_mark(BOOT_KEYBOARD);
+
+	/***** Serial port for profiles and traces. *****/
+	serial_init();
+	boot_mark(BOOT_SERIAL);
 
 	/***** RTC initialization *****/
+	timer_init();		// The RTC interrupt ticks the timer wheel.
 	rtc_init();	
 	enable_irq(2);		// Unmask slave, which is on IRQ2.
 	enable_irq(8);		// The RTC occupies IRQ8 (IRQ0 on the slave).
+	boot_mark(BOOT_RTC);
+	
+	/***** DISK INITIALIZATION *****/
+	/* Without a filesys_img module, look for the image at the start of a disk, virtio first. */
+	pci_enumerate();
+	int32_t virtio_irq = virtio_blk_init();
+	if(virtio_irq != -1){
+		enable_irq(virtio_irq);	// The PCI interrupt line the firmware assigned.
+		if(!fs_mounted && fs_mount_disk(&virtio_blk_dev) == 0){
+			fs_mounted = 1;
+			if(!boot_fast){
+				puts("Filesystem mounted from virtio-blk.\n");
+			}
+		}
+	}
+	if(ata_init() == 0){
+		enable_irq(ATA_IRQ);	// The disk occupies IRQ14 (IRQ6 on the slave).
+		if(!fs_mounted && fs_mount_disk(&ata_dev) == 0){
+			fs_mounted = 1;
+			if(!boot_fast){
+				puts("Filesystem mounted from ATA disk.\n");
+			}
+		}
+	}
+	if(!fs_mounted){
+		puts("No filesystem found.\n");
+	}
+	boot_mark(BOOT_DISK);
 	
 	/***** PIT INITIALIZATION *****/
 	init_pit();
 	enable_irq(0);	
+	boot_mark(BOOT_PIT);
 	
 	/***** Page initialization *****/
 	initialize_page();
+	boot_mark(BOOT_PAGING);
+	
+	/***** CLOCK INITIALIZATION *****/
+	clock_init();		// Needs page_table_vid for the clock page.
+	boot_mark(BOOT_CLOCK);
 	
 	/***** TERMINAL INITIALIZATION *****/
 	terminal_open();
@@ -179,6 +250,7 @@ void entry(unsigned long magic, unsigned long addr) {
      * without showing you any output */
     //printf("Enabling Interrupts\n");
     init_term_cursor();
+	boot_mark(BOOT_TERMINAL);
 	sys_execute((uint8_t*)"shell");
     sti();
 
@@ -314,7 +314,7 @@ void keyboard_handler(){
 					void* buf;	// Empty buffer.
 					rtc_write(0, buf, freqs[freq_idx]);
 					break;
-				/* This will close and then open RTC, which should reset the freq to 2 Hz.*/
+				/* This will close and then open RTC. Rates are per open file now, so this no longer resets anything. */
 				case '2':
 					puts("\nResetting RTC!\n");
 					rtc_close();
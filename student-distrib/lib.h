@@ -6,6 +6,9 @@
 #define _LIB_H
 
 #include "types.h"
+#include "irqstat.h"
+
+#define EFLAGS_IF 0x200
 
 /***** MY FUNCTIONS *****/
 /* Getter function for screen_x. */
@@ -118,21 +121,41 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
     );                                  \
 } while (0)
 
+/* Writes the 64-bit value hi:lo to model specific register "msr" */
+#define wrmsr(msr, lo, hi)              \
+do {                                    \
+    asm volatile ("wrmsr"               \
+            :                           \
+            : "c"(msr), "a"(lo), "d"(hi) \
+            : "memory"                  \
+    );                                  \
+} while (0)
+
+/* The macros below also time how long interrupts stay off (see irqstat.c),
+ * so code should use them rather than its own cli and sti. */
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
-    asm volatile ("cli"                 \
-            :                           \
+    uint32_t cli_flags_;                \
+    asm volatile ("                   \n\
+            pushfl                    \n\
+            popl %0                   \n\
+            cli                       \n\
+            "                           \
+            : "=r"(cli_flags_)          \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    if (cli_flags_ & EFLAGS_IF)         \
+        irqoff_begin(__FILE__, __LINE__); \
 } while (0)
 
 /* Save flags and then clear interrupt flag
@@ -149,11 +172,14 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    if ((flags) & EFLAGS_IF)            \
+        irqoff_begin(__FILE__, __LINE__); \
 } while (0)
 
 /* Set interrupt flag - enable interrupts on this processor */
 #define sti()                           \
 do {                                    \
+    irqoff_end();                       \
     asm volatile ("sti"                 \
             :                           \
             :                           \
@@ -166,6 +192,8 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+    if ((flags) & EFLAGS_IF)            \
+        irqoff_end();                   \
     asm volatile ("                   \n\
             pushl %0                  \n\
             popfl                     \n\
@@ -176,4 +204,14 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Sleeps until the next interrupt with interrupts off before and after.
+ * "sti; hlt" is atomic, so an interrupt cannot slip in between and be
+ * missed; the sleep itself is not counted as time with interrupts off. */
+#define wait_for_interrupt()            \
+do {                                    \
+    irqoff_end();                       \
+    asm volatile ("sti; hlt; cli" ::: "memory", "cc"); \
+    irqoff_begin(__FILE__, __LINE__);   \
+} while (0)
+
 #endif /* _LIB_H */
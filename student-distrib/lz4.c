@@ -0,0 +1,152 @@
+/*
+ * This file will contain the LZ4 block decoder.
+ *
+ * A block is a series of sequences. Each starts with a token whose high
+ * nibble is the literal count and whose low nibble is the match length
+ * minus 4; a nibble of 15 is continued by bytes that are added on until
+ * one is not 255. The literals follow, then a 2 byte little endian offset
+ * back into the output. The last sequence has literals only.
+ *
+ * Most sequences are a few bytes long, so calling memcpy for each costs
+ * more than the copy itself. Away from the ends of the buffers the decoder
+ * copies in 8 byte steps and lets the last step run a little past the
+ * sequence; the next sequence overwrites the extra bytes. The kernel is
+ * built without optimization, so the copies are macros rather than calls.
+ */
+#include "lz4.h"
+#include "lib.h"
+
+#define WILD_COPY			8			// Bytes a wild copy may run past its length.
+#define FAST_IN				18			// Input a fast sequence may read: 16 literal bytes and an offset.
+#define FAST_OUT			40			// Output it may write: 14 literals and a 24 byte match copy.
+
+/* Copies 8 bytes. If they overlap, src must be at least 8 bytes behind dst. */
+#define COPY8(dst, src)                                              \
+do {                                                                 \
+	((uint32_t*)(dst))[0] = ((const uint32_t*)(src))[0];             \
+	((uint32_t*)(dst))[1] = ((const uint32_t*)(src))[1];             \
+} while (0)
+
+/* Copies len bytes 8 at a time, rounding len up. Both buffers need
+ * WILD_COPY bytes of slack past len. */
+#define WILD_COPY_RUN(dst, src, len)                                 \
+do {                                                                 \
+	uint8_t* _d = (dst);                                             \
+	const uint8_t* _s = (src);                                       \
+	uint8_t* _end = _d + (len);                                      \
+	do {                                                             \
+		COPY8(_d, _s);                                               \
+		_d += 8;                                                     \
+		_s += 8;                                                     \
+	} while (_d < _end);                                             \
+} while (0)
+
+/* uint32_t read_length(const uint8_t** ip, const uint8_t* iend, uint32_t len)
+ * Inputs:      const uint8_t** ip = input cursor, advanced past the extra bytes
+ *              const uint8_t* iend = end of the input
+ *              uint32_t len = the nibble from the token, 15
+ * Return Value: the full length, 0xFFFFFFFF if the input ran out */
+static uint32_t read_length(const uint8_t** ip, const uint8_t* iend, uint32_t len){
+	uint32_t b;
+	do{
+		if(*ip >= iend){
+			return 0xFFFFFFFF;
+		}
+		b = *(*ip)++;
+		len += b;
+	}while(b == 255);
+	return len;
+}
+
+/* int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len)
+ * Inputs:      const uint8_t* src = compressed block
+ *              uint32_t src_len = its size in bytes
+ *              uint8_t* dst = destination
+ *              uint32_t dst_len = size of dst
+ * Return Value: bytes decompressed, -1 on corrupt input */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len){
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_len;
+
+	while(ip < iend){
+		uint32_t token = *ip++;
+		uint32_t len = token >> 4;
+		uint32_t offset;
+
+		/* Most sequences have short literals and a short match, far from
+		 * either end. They need no length bytes and no clipping: copy 16
+		 * literal bytes and 24 match bytes whatever the lengths are. */
+		if(len != 15 && (token & 0xF) != 15 && iend - ip >= FAST_IN && oend - op >= FAST_OUT){
+			COPY8(op, ip);
+			COPY8(op + 8, ip + 8);
+			op += len;
+			ip += len;
+			offset = ip[0] | (ip[1] << 8);
+			if(offset >= WILD_COPY && offset <= (uint32_t)(op - dst)){
+				const uint8_t* match = op - offset;
+				ip += 2;
+				COPY8(op, match);
+				COPY8(op + 8, match + 8);
+				COPY8(op + 16, match + 16);
+				op += (token & 0xF) + LZ4_MIN_MATCH;
+				continue;
+			}
+			/* A near or bad offset: the general match code below deals with it. */
+		}
+		else{
+			if(len == 15){
+				len = read_length(&ip, iend, len);
+			}
+			if(len > (uint32_t)(iend - ip) || len > (uint32_t)(oend - op)){
+				return -1;
+			}
+			if(len + WILD_COPY <= (uint32_t)(iend - ip) && len + WILD_COPY <= (uint32_t)(oend - op)){
+				WILD_COPY_RUN(op, ip, len);
+			}
+			else{
+				memcpy(op, ip, len);
+			}
+			op += len;
+			ip += len;
+			if(ip == iend){
+				break;		// The last sequence has no match.
+			}
+		}
+
+		if(iend - ip < 2){
+			return -1;
+		}
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (uint32_t)(op - dst)){
+			return -1;
+		}
+		len = token & 0xF;
+		if(len == 15){
+			len = read_length(&ip, iend, len);
+		}
+		if(len == 0xFFFFFFFF || len + LZ4_MIN_MATCH > (uint32_t)(oend - op)){
+			return -1;
+		}
+		len += LZ4_MIN_MATCH;
+
+		/* Matches 8 or more back can be copied 8 bytes a step; nearer ones repeat a short pattern. */
+		const uint8_t* match = op - offset;
+		if(offset >= WILD_COPY && len + WILD_COPY <= (uint32_t)(oend - op)){
+			WILD_COPY_RUN(op, match, len);
+			op += len;
+		}
+		else if(offset >= len){
+			memcpy(op, match, len);
+			op += len;
+		}
+		else{
+			while(len-- > 0){
+				*op++ = *match++;
+			}
+		}
+	}
+	return op - dst;
+}
@@ -0,0 +1,18 @@
+#ifndef _LZ4_H
+#define _LZ4_H
+
+/* Decoder for the LZ4 block format, used for compressed files. */
+#include "types.h"
+
+#define LZ4_MIN_MATCH		4			// Match lengths are stored minus this.
+
+#ifndef ASM
+/*
+ * Decompresses one block of src_len bytes into dst, which has room for
+ * dst_len bytes. Malformed input is rejected rather than trusted.
+ * RETURN: bytes written to dst, -1 if the input is corrupt or too large.
+ */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+#endif		// ASM
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * This file will contain all functions relating to the PCI bus.
+ *
+ * pci_enumerate walks every bus/device/function once at boot and keeps a
+ * small table of what it found; drivers then look themselves up by ID or
+ * class instead of scanning the bus on their own.
+ */
+#include "pci.h"
+#include "lib.h"
+
+static pci_dev_t pci_devs[PCI_MAX_DEVICES];
+static int32_t pci_num_devs = 0;
+
+/* Builds the configuration address for a register of one function. */
+static uint32_t pci_addr(uint32_t bus, uint32_t dev, uint32_t func, uint32_t reg){
+	return 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xFC);
+}
+
+/* Raw configuration read used while enumerating. */
+static uint32_t pci_read_raw(uint32_t bus, uint32_t dev, uint32_t func, uint32_t reg){
+	outl(pci_addr(bus, dev, func, reg), PCI_CONFIG_ADDR);
+	return inl(PCI_CONFIG_DATA);
+}
+
+uint32_t pci_read(pci_dev_t* pdev, uint32_t reg){
+	return pci_read_raw(pdev->bus, pdev->dev, pdev->func, reg);
+}
+
+void pci_write(pci_dev_t* pdev, uint32_t reg, uint32_t val){
+	outl(pci_addr(pdev->bus, pdev->dev, pdev->func, reg), PCI_CONFIG_ADDR);
+	outl(val, PCI_CONFIG_DATA);
+}
+
+/* Records one function in pci_devs. */
+static void pci_add(uint32_t bus, uint32_t dev, uint32_t func, uint32_t id){
+	int32_t i;
+
+	if(pci_num_devs == PCI_MAX_DEVICES){
+		return;
+	}
+	pci_dev_t* pdev = &pci_devs[pci_num_devs++];
+	pdev->bus = bus;
+	pdev->dev = dev;
+	pdev->func = func;
+	pdev->vendor = id & 0xFFFF;
+	pdev->device = id >> 16;
+	pdev->class = pci_read(pdev, PCI_REG_CLASS) >> 16;
+	pdev->irq = pci_read(pdev, PCI_REG_IRQ) & 0xFF;
+	for(i = 0; i < 6; i++){
+		pdev->bar[i] = pci_read(pdev, PCI_REG_BAR0 + 4 * i);
+	}
+}
+
+/*
+ * int32_t pci_enumerate()
+ * Only function 0 is probed unless the header says the device is
+ * multifunction. RETURN: the number of functions recorded.
+ */
+int32_t pci_enumerate(){
+	uint32_t bus, dev, func, id;
+
+	pci_num_devs = 0;
+	for(bus = 0; bus < 256; bus++){
+		for(dev = 0; dev < 32; dev++){
+			for(func = 0; func < 8; func++){
+				id = pci_read_raw(bus, dev, func, PCI_REG_ID);
+				if((id & 0xFFFF) == 0xFFFF){
+					if(func == 0){
+						break;				// Empty slot.
+					}
+					continue;
+				}
+				pci_add(bus, dev, func, id);
+				if(func == 0 && !(pci_read_raw(bus, dev, 0, PCI_REG_HEADER) & 0x00800000)){
+					break;					// Single function device.
+				}
+			}
+		}
+	}
+	return pci_num_devs;
+}
+
+pci_dev_t* pci_find_device(uint16_t vendor, uint16_t device){
+	int32_t i;
+	for(i = 0; i < pci_num_devs; i++){
+		if(pci_devs[i].vendor == vendor && pci_devs[i].device == device){
+			return &pci_devs[i];
+		}
+	}
+	return NULL;
+}
+
+pci_dev_t* pci_find_class(uint16_t class){
+	int32_t i;
+	for(i = 0; i < pci_num_devs; i++){
+		if(pci_devs[i].class == class){
+			return &pci_devs[i];
+		}
+	}
+	return NULL;
+}
+
+void pci_enable(pci_dev_t* pdev){
+	uint32_t cmd = pci_read(pdev, PCI_REG_COMMAND);
+	pci_write(pdev, PCI_REG_COMMAND, cmd | PCI_CMD_IO | PCI_CMD_MASTER);
+}
@@ -0,0 +1,52 @@
+#ifndef _PCI_H
+#define _PCI_H
+
+/* PCI bus enumeration through configuration mechanism #1. */
+#include "types.h"
+
+#define PCI_CONFIG_ADDR		0xCF8
+#define PCI_CONFIG_DATA		0xCFC
+#define PCI_MAX_DEVICES		32			// Functions remembered by pci_enumerate.
+
+/* Configuration space registers. */
+#define PCI_REG_ID			0x00		// Device ID << 16 | vendor ID.
+#define PCI_REG_COMMAND		0x04
+#define PCI_REG_CLASS		0x08		// Class << 24 | subclass << 16 | ...
+#define PCI_REG_HEADER		0x0C		// Header type is bits 16-23.
+#define PCI_REG_BAR0		0x10
+#define PCI_REG_IRQ			0x3C		// Interrupt line is the low byte.
+
+#define PCI_CMD_IO			0x1
+#define PCI_CMD_MASTER		0x4
+#define PCI_BAR_IO			0x1
+#define PCI_NO_IRQ			0xFF
+
+#ifndef ASM
+/* One PCI function found on the bus. */
+typedef struct pci_dev{
+	uint8_t bus;
+	uint8_t dev;
+	uint8_t func;
+	uint8_t irq;				// Legacy PIC line, PCI_NO_IRQ if none.
+	uint16_t vendor;
+	uint16_t device;
+	uint16_t class;				// Class << 8 | subclass.
+	uint32_t bar[6];
+} pci_dev_t;
+
+/* Reads/writes a 32 bit configuration register. */
+uint32_t pci_read(pci_dev_t* pdev, uint32_t reg);
+void pci_write(pci_dev_t* pdev, uint32_t reg, uint32_t val);
+
+/* Scans every bus and records the functions present. Returns how many. */
+int32_t pci_enumerate();
+
+/* Look up a function found by pci_enumerate. NULL if there is none. */
+pci_dev_t* pci_find_device(uint16_t vendor, uint16_t device);
+pci_dev_t* pci_find_class(uint16_t class);
+
+/* Turns on I/O decoding and bus mastering. */
+void pci_enable(pci_dev_t* pdev);
+#endif		// ASM
+
+#endif
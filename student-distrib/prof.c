@@ -0,0 +1,215 @@
+/*
+ * This file will contain the sampling profiler.
+ *
+ * While profiling is on, every RTC interrupt appends the interrupted EIP,
+ * process and privilege level to a ring buffer. The RTC is used rather
+ * than the PIT because it runs at RTC_MAX_FREQ, against the PIT's 18.2 Hz,
+ * and it does not switch tasks, so a sample never lands in the scheduler
+ * itself. Code that runs with interrupts disabled is never sampled; its
+ * time shows up at the instruction that enables them again.
+ *
+ * The samples are only aggregated when someone asks, by hashing them into
+ * a histogram, so a tick costs a handful of stores.
+ */
+#include "prof.h"
+#include "lib.h"
+#include "serial.h"
+#include "syscalls.h"
+
+static prof_sample_t samples[PROF_SAMPLES];
+static uint32_t sample_count = 0;			// Only grows while on; the newest is at (count - 1) % PROF_SAMPLES.
+static volatile uint32_t prof_on = 0;
+
+static prof_entry_t hist[PROF_HASH_SIZE];
+static uint32_t hist_count = 0;
+
+static uint8_t prog_names[PROF_MAX_PROGS][PROF_NAME_LEN];
+static uint32_t prog_count = 0;
+static uint8_t cur_prog[MAX_PROCESSES];		// Index into prog_names per process slot.
+
+/* void prof_tick(uint32_t eip, uint32_t cs)
+ * Inputs:      uint32_t eip = where the interrupt hit
+ *              uint32_t cs = code segment pushed with it
+ * Return Value: NONE
+ * Function: runs in the RTC interrupt, so the stack is the interrupted
+ * process's kernel stack and get_process_number still names it */
+void prof_tick(uint32_t eip, uint32_t cs){
+	if(!prof_on){
+		return;
+	}
+	int32_t pid = get_process_number();
+	prof_sample_t* s = &samples[sample_count % PROF_SAMPLES];
+
+	s->eip = eip;
+	s->cpl = cs & 0x3;
+	if(pid < 0 || pid >= MAX_PROCESSES){
+		s->pid = PROF_NO_PID;
+		s->prog = PROF_NO_PROG;
+	}
+	else{
+		s->pid = pid;
+		s->prog = cur_prog[pid];
+	}
+	sample_count++;
+}
+
+/* void prof_exec(int32_t pid, const uint8_t* name)
+ * Inputs:      int32_t pid = process slot being started
+ *              const uint8_t* name = program file name
+ * Return Value: NONE
+ * Function: called for every execute, profiling or not, so the shells
+ * started at boot are named too */
+void prof_exec(int32_t pid, const uint8_t* name){
+	uint32_t i;
+
+	if(pid < 0 || pid >= MAX_PROCESSES){
+		return;
+	}
+	for(i = 0; i < prog_count; i++){
+		if(strncmp((int8_t*)prog_names[i], (int8_t*)name, PROF_NAME_LEN - 1) == 0){
+			break;
+		}
+	}
+	if(i == prog_count){
+		if(prog_count == PROF_MAX_PROGS){
+			cur_prog[pid] = PROF_NO_PROG;
+			return;
+		}
+		strncpy((int8_t*)prog_names[i], (int8_t*)name, PROF_NAME_LEN - 1);
+		prog_names[i][PROF_NAME_LEN - 1] = '\0';
+		prog_count++;
+	}
+	cur_prog[pid] = i;
+}
+
+/* void aggregate()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: hashes the samples still in the ring into hist. A key that
+ * finds the table full is dropped; PROF_HASH_SIZE is half the ring, which
+ * only a profile of a huge amount of straight-line code would fill. */
+static void aggregate(){
+	uint32_t n = (sample_count < PROF_SAMPLES) ? sample_count : PROF_SAMPLES;
+	uint32_t i;
+
+	memset(hist, 0, sizeof(hist));
+	hist_count = 0;
+	for(i = 0; i < n; i++){
+		prof_sample_t* s = &samples[i];
+		uint32_t h = (s->eip ^ (s->pid << 24) ^ (s->prog << 16) ^ s->cpl) * 0x9E3779B1;
+		uint32_t slot = h >> (32 - PROF_HASH_BITS);
+		uint32_t probe;
+
+		for(probe = 0; probe < PROF_HASH_SIZE; probe++, slot = (slot + 1) & (PROF_HASH_SIZE - 1)){
+			prof_entry_t* e = &hist[slot];
+			if(e->count == 0){
+				e->eip = s->eip;
+				e->pid = s->pid;
+				e->cpl = s->cpl;
+				e->prog = s->prog;
+				e->count = 1;
+				hist_count++;
+				break;
+			}
+			if(e->eip == s->eip && e->pid == s->pid && e->cpl == s->cpl && e->prog == s->prog){
+				e->count++;
+				break;
+			}
+		}
+	}
+}
+
+/* void dump()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: one line per bucket, framed so prof.py can find it in a log:
+ *     prof-begin <samples> <dropped>
+ *     prof-prog <index> <name>
+ *     prof <cpl> <pid> <prog> <eip hex> <count>
+ *     prof-end */
+static void dump(){
+	uint32_t i;
+
+	serial_puts("prof-begin ");
+	serial_putu(sample_count, 10);
+	serial_putc(' ');
+	serial_putu((sample_count > PROF_SAMPLES) ? sample_count - PROF_SAMPLES : 0, 10);
+	serial_putc('\n');
+	for(i = 0; i < prog_count; i++){
+		serial_puts("prof-prog ");
+		serial_putu(i, 10);
+		serial_putc(' ');
+		serial_puts((int8_t*)prog_names[i]);
+		serial_putc('\n');
+	}
+	for(i = 0; i < PROF_HASH_SIZE; i++){
+		if(hist[i].count == 0){
+			continue;
+		}
+		serial_puts("prof ");
+		serial_putu(hist[i].cpl, 10);
+		serial_putc(' ');
+		serial_putu(hist[i].pid, 10);
+		serial_putc(' ');
+		serial_putu(hist[i].prog, 10);
+		serial_putc(' ');
+		serial_putu(hist[i].eip, 16);
+		serial_putc(' ');
+		serial_putu(hist[i].count, 10);
+		serial_putc('\n');
+	}
+	serial_puts("prof-end\n");
+}
+
+/* int32_t prof_ctl(int32_t cmd, void* buf, int32_t n)
+ * Inputs:      int32_t cmd = PROF_* command
+ *              void* buf = see prof.h
+ *              int32_t n = see prof.h
+ * Return Value: see prof.h
+ * Function: sampling is stopped while the buffer is read, so a profile is
+ * a consistent snapshot */
+int32_t prof_ctl(int32_t cmd, void* buf, int32_t n){
+	uint32_t i, copied = 0;
+	uint32_t was_on = prof_on;
+
+	switch(cmd){
+		case PROF_START:
+			prof_on = 0;
+			sample_count = 0;
+			prof_on = 1;
+			return 0;
+
+		case PROF_STOP:
+			prof_on = 0;
+			return 0;
+
+		case PROF_READ:
+			if(buf == NULL || n < 0){
+				return -1;
+			}
+			prof_on = 0;
+			aggregate();
+			for(i = 0; i < PROF_HASH_SIZE && copied < (uint32_t)n; i++){
+				if(hist[i].count != 0){
+					((prof_entry_t*)buf)[copied++] = hist[i];
+				}
+			}
+			prof_on = was_on;
+			return copied;
+
+		case PROF_NAME:
+			if(buf == NULL || n < 0 || (uint32_t)n >= prog_count){
+				return -1;
+			}
+			memcpy(buf, prog_names[n], PROF_NAME_LEN);
+			return 0;
+
+		case PROF_DUMP:
+			prof_on = 0;
+			aggregate();
+			dump();
+			prof_on = was_on;
+			return hist_count;
+	}
+	return -1;
+}
@@ -0,0 +1,58 @@
+#ifndef _PROF_H
+#define _PROF_H
+
+/* Sampling profiler: the RTC interrupt records where it interrupted. */
+#include "types.h"
+
+#define PROF_SAMPLES		8192		// Ring buffer size, 8 s at RTC_MAX_FREQ (power of 2).
+#define PROF_HASH_BITS		12
+#define PROF_HASH_SIZE		(1 << PROF_HASH_BITS)	// Most distinct (eip, pid, cpl, prog) keys aggregated.
+#define PROF_MAX_PROGS		32			// Program names remembered per boot.
+#define PROF_NAME_LEN		32
+#define PROF_NO_PID			0xFF		// Interrupted before any process ran.
+#define PROF_NO_PROG		0xFF		// Name table was full.
+
+/* sys_profile commands. */
+#define PROF_START			0			// Empty the buffer and start sampling.
+#define PROF_STOP			1
+#define PROF_READ			2			// Copy the aggregated histogram out.
+#define PROF_NAME			3			// Copy out the name of one program index.
+#define PROF_DUMP			4			// Write the histogram to COM1 for prof.py.
+
+#ifndef ASM
+/* One sample, written by the RTC interrupt. */
+typedef struct prof_sample{
+	uint32_t eip;
+	uint8_t pid;
+	uint8_t cpl;						// Privilege level interrupted: 0 kernel, 3 user.
+	uint8_t prog;						// Index of the program the process was running.
+	uint8_t reserved;
+} prof_sample_t;
+
+/* One histogram bucket: every sample with the same key. */
+typedef struct prof_entry{
+	uint32_t eip;
+	uint8_t pid;
+	uint8_t cpl;
+	uint8_t prog;
+	uint8_t reserved;
+	uint32_t count;
+} prof_entry_t;
+
+/* Records one sample if profiling is on. Called by the RTC handler. */
+void prof_tick(uint32_t eip, uint32_t cs);
+
+/* Notes the program a process slot now runs, so samples can be told apart by binary. */
+void prof_exec(int32_t pid, const uint8_t* name);
+
+/*
+ * PROF_START, PROF_STOP and PROF_DUMP ignore buf and n. PROF_READ fills
+ * buf with up to n prof_entry_t. PROF_NAME copies the name of program n
+ * into buf (PROF_NAME_LEN bytes, NUL terminated).
+ * RETURN: entries for PROF_READ and PROF_DUMP, 0 for the others, -1 on a
+ * bad command or argument.
+ */
+int32_t prof_ctl(int32_t cmd, void* buf, int32_t n);
+#endif		// ASM
+
+#endif
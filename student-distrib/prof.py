@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Turn a profile dumped with `prof dump` into a flat profile.
+
+The kernel writes the histogram to COM1, so run QEMU with something like
+`-serial file:serial.log`, then:
+
+    ./prof.py serial.log
+    ./prof.py --kernel bootimg --user-dir ../syscalls --lines 40 serial.log
+
+Kernel samples are resolved against bootimg and user samples against
+<user-dir>/<program>.exe, both with nm. If the log holds several dumps,
+the last one is used.
+"""
+import argparse
+import bisect
+import collections
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+class Symbols:
+    """Function symbols of one ELF, sorted by address."""
+
+    def __init__(self, path):
+        self.addrs = []
+        self.names = []
+        if not os.path.exists(path):
+            return
+        out = subprocess.run(["nm", "-n", "--defined-only", path],
+                             capture_output=True, text=True, check=False).stdout
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in "TtWw":
+                self.addrs.append(int(fields[0], 16))
+                self.names.append(fields[2])
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        return self.names[i] if i >= 0 else None
+
+
+def read_dump(path):
+    """Returns (samples, dropped, program names, [(cpl, pid, prog, eip, count)])."""
+    dump = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            fields = line.split()
+            if not fields:
+                continue
+            if fields[0] == "prof-begin":
+                dump = (int(fields[1]), int(fields[2]), {}, [])
+            elif dump is None:
+                continue
+            elif fields[0] == "prof-prog":
+                dump[2][int(fields[1])] = fields[2] if len(fields) > 2 else "?"
+            elif fields[0] == "prof" and len(fields) == 6:
+                cpl, pid, prog = (int(x) for x in fields[1:4])
+                dump[3].append((cpl, pid, prog, int(fields[4], 16), int(fields[5])))
+    if dump is None:
+        sys.exit("%s: no prof-begin line; was `prof dump` run?" % path)
+    return dump
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="serial output holding a prof dump")
+    parser.add_argument("--kernel", default=os.path.join(HERE, "bootimg"))
+    parser.add_argument("--user-dir", default=os.path.join(HERE, "..", "syscalls"))
+    parser.add_argument("--lines", type=int, default=30, help="functions to show")
+    parser.add_argument("--pid", type=int, help="only samples from this process slot")
+    args = parser.parse_args()
+
+    samples, dropped, progs, buckets = read_dump(args.log)
+    kernel = Symbols(args.kernel)
+    user = {}
+    flat = collections.Counter()
+    total = in_kernel = 0
+
+    for cpl, pid, prog, eip, count in buckets:
+        if args.pid is not None and pid != args.pid:
+            continue
+        name = progs.get(prog, "?")
+        if cpl == 0:
+            where = "[kernel] %s" % (kernel.lookup(eip) or hex(eip))
+            in_kernel += count
+        else:
+            if name not in user:
+                user[name] = Symbols(os.path.join(args.user_dir, name + ".exe"))
+            where = "[%s] %s" % (name, user[name].lookup(eip) or hex(eip))
+        flat[where] += count
+        total += count
+
+    if total == 0:
+        sys.exit("no samples")
+    print("%d samples (%d overwritten), %.1f%% in the kernel"
+          % (samples, dropped, 100.0 * in_kernel / total))
+    print("%7s %6s  %s" % ("samples", "%", "function"))
+    for where, count in flat.most_common(args.lines):
+        print("%7d %6.2f  %s" % (count, 100.0 * count / total, where))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,27 +1,34 @@
 /*
  * This file will contain all functions relating to the RTC.
+ *
+ * The hardware RTC interrupts at RTC_MAX_FREQ all the time and the handler
+ * only counts. Every open RTC file has its own virtual frequency, kept in
+ * its file descriptor as a period in hardware ticks and the tick count of
+ * its next virtual tick, so programs on different terminals can each run
+ * at their own rate without reprogramming the chip under each other.
  */
 #include "rtc.h"
+#include "syscalls.h"
+#include "timer.h"
+#include "prof.h"
+#include "bootprof.h"
 
-volatile uint8_t read_wait = 0;		// Signals if the user is waiting the read the RTC. 1 means waiting.
-uint8_t rtc_opened = 0;		// Signals that the RTC is open if 1. 
+static volatile uint32_t rtc_ticks = 0;		// RTC interrupts since boot.
+static file_desc_t kernel_rtc;				// Used by kernel callers that pass no file (fd 0).
 /***********************************/
 /***** RTC INTERRUPT FUNCTIONS *****/
 /***********************************/
 /* 
- * Here, we initialize the RTC. We set the default interrupt frequency
- * to 2 Hz and enable periodic interrupts. This function is called from
+ * Here, we initialize the RTC. We set the interrupt frequency to
+ * RTC_MAX_FREQ and enable periodic interrupts. This function is called from
  * the OS intialization (boot) sequence, so interrupts are already disabled.
  * Additionally, we set up the IDT entry for the RTC so that the handler can 
  * be called.
  */
 void rtc_init(){
-	/* Flag the RTC as open so it will not initialize again. */
-	rtc_opened = 1;
-	
 	/* Initialize the RTC chip itself. */
 	outb(0x8A, RTC_INDEX_PORT);				// Select register A on the RTC.
-	outb(0x2F, RTC_DATA_PORT);				// Enable the oscillator circuit and set the rate.
+	outb(0x20 | RTC_MAX_RATE, RTC_DATA_PORT);	// Enable the oscillator circuit and set the rate.
 	outb(0x8B, RTC_INDEX_PORT);				// Select register B.
 	uint8_t b_orig = inb(RTC_DATA_PORT);	// Read the current value of B.
 	outb(0x8B, RTC_INDEX_PORT);				// Reset index to B.		
@@ -43,15 +50,20 @@ void rtc_init(){
 	SET_IDT_ENTRY(idt[idtPort], rtc_linker);	
 	idt[idtPort].present = 0x1;			//Mark the interrupt as present.
 	
+	rtc_set_freq(&kernel_rtc, RTC_DEFAULT_FREQ);
+
 	/* Tell the user it worked. */
-	puts("RTC initialized.\n");
+	if(!boot_fast){
+		puts("RTC initialized.\n");
+	}
 }
 
 /* 
- * This function indicates that an RTC interrupt has occurred. In the future
- * it may be associated with other functions and/or system calls. 
+ * Counts one RTC interrupt, ticks the timer wheel and takes a profiler
+ * sample. Readers compare the count against their own next tick, so there
+ * is nothing else to do here.
  */
-void rtc_handler(){
+void rtc_handler(irq_frame_t* frame){
 	uint32_t irq_num = 8;		// The RTC is on IRQ8 (Slave IRQ0)
 		
 	/* 
@@ -61,150 +73,112 @@ void rtc_handler(){
 	outb(0x8C, RTC_INDEX_PORT);
 	inb(RTC_DATA_PORT);
 	
-	/* Set the read_wait to 0. This way read knows to return 0. */
-	read_wait = 0;
+	rtc_ticks++;
+	timer_tick();
+	prof_tick(frame->eip, frame->cs);
 	
 	/* Send the EOI and enable this interrupt pin again. */
 	send_eoi(irq_num);
 }
 
+/*
+ * Returns the number of RTC interrupts since boot, RTC_MAX_FREQ per second.
+ */
+uint32_t rtc_get_ticks(){
+	return rtc_ticks;
+}
+
+/*
+ * Sets the virtual frequency of an open RTC file. Its next tick is one
+ * period from now, as if the RTC had just been reprogrammed.
+ *
+ * INPUTS:
+ *		file -- 	The RTC file's descriptor.
+ *		freq -- 	A power of 2 from 2 to RTC_MAX_FREQ Hz.
+ *
+ * RETURN: Returns 0 on success, -1 on failure.
+ */
+int32_t rtc_set_freq(file_desc_t* file, int32_t freq){
+	if(freq < 2 || freq > RTC_MAX_FREQ || (freq & (freq - 1)) != 0){
+		return -1;
+	}
+	file->rtc_period = RTC_MAX_FREQ / freq;
+	file->rtc_next = rtc_ticks + file->rtc_period;
+	return 0;
+}
+
 /*******************************/
 /****** CORE RTC FUNCTIONS *****/
 /*******************************/
 /* 
- * This function will check to see if the RTC is already opened,
- * and will open it if not. By "opening," I mean that the rate of 
- * periodic interrupts will be reset to 2 Hz if the rtc is not open.
+ * Opening the RTC used to reset the shared interrupt rate to 2 Hz. Now
+ * sys_open gives each new RTC file its own 2 Hz rate instead, so there is
+ * nothing left to do here.
  *
  * RETURN: Returns 0 on success, -1 on failure.
  */
 int32_t rtc_open(){
-	/* Make sure that the RTC is not already open. */
-	// if(rtc_opened){
-	// 	puts("The RTC is already open.\n");
-	// 	return -1;
-	// }
-	rtc_opened = 1;								// Mark RTC as opened. 
-	
-	/* If the RTC is closed (interrupts disabled), then reset the interrupt rate. */
-	cli();										// We don't want interrupts.
-	outb(0x8A, RTC_INDEX_PORT);					// Select register A on the RTC.
-	uint8_t a_orig = inb(RTC_DATA_PORT);		// Get the current values of register A.
-	a_orig &= 0xF0;								// Preserve only the upper bits of A.
-	outb(0x8A, RTC_INDEX_PORT);					// Reset index.		
-	outb(a_orig | 0x0F, RTC_DATA_PORT);			// Write to register A and reset the interrupt frequency to 2 Hz.
-	sti();
 	return 0;									// Success.
 }
 
 /*
- * This function will check to see if the RTC is already closed, and
- * will close it if not. Currently "closing" the RTC has no meaning.
+ * Closing an RTC file leaves the hardware running for everyone else.
  *
  * RETURN: Returns 0 on success, -1 on failure.
  */
 int32_t rtc_close(){
-	/* Make sure that the RTC is already open. */
-	if(!rtc_opened){
-		puts("The RTC is already closed.\n");
-		return -1;
-	}
-	rtc_opened = 0;								// Mark RTC as closed.
 	return 0;									// Success.
 }
 
 /* 
- * This function will wait for the next RTC interrupt and then returns 0.
- * It uses the read_wait flag to "synchronize" this in a simple way.
+ * This function will wait for this file's next virtual tick and then
+ * returns 0. A tick that passed while the caller was busy is returned at
+ * once, like a latched interrupt; if several passed, only the last one
+ * counts, so a slow reader does not get a burst of ticks. If the file has
+ * a read timeout and it runs out first, returns -1 and the tick stays due.
  */
 int32_t rtc_read(int32_t fd, const void* buf, int32_t nbytes){
-	read_wait = 1;		// Signal that we are waiting for an interrupt.
-	while(read_wait){
-		// Wait for read_wait to be brought low again by an RTC interrupt.
+	file_desc_t* file = fd ? (file_desc_t*)fd : &kernel_rtc;
+	int32_t late = (int32_t)(rtc_ticks - file->rtc_next);
+	timer_t timeout = {NULL, NULL, 0, 0};
+
+	if(late >= (int32_t)file->rtc_period){
+		file->rtc_next += (late / file->rtc_period) * file->rtc_period;
+	}
+	if(file->read_timeout){
+		timer_add(&timeout, file->read_timeout);
+	}
+	while((int32_t)(rtc_ticks - file->rtc_next) < 0){
+		// Wait for the RTC interrupts to catch up with this file's next tick.
+		if(timeout.fired){
+			return -1;
+		}
 	}
-	//puts("Read the RTC.\n");
-	// putc('1');		// For debugging just print this random char to screen.
+	timer_del(&timeout);
+	file->rtc_next += file->rtc_period;
 	return 0;
 }
 
 /* 
- * rtc_write will set the RTC interrupt frequency to the desired rate
- * specified by the caller. In reality, each frequency corresponds to a
- * 4-bit code in register A that needs to be changed.
+ * rtc_write sets the virtual interrupt frequency of this RTC file. The
+ * hardware rate is not touched, so other programs keep their own rates.
  *
  * INPUTS:
- *		freq -- 	The desired frequency to set the RTC interrupts to. Must be a
- *					power of 2 below 1024 Hz.
+ *		buf -- 	Points to the desired frequency, a power of 2 from 2 to
+ *				1024 Hz.
+ *		nbytes -- Must be 4.
  *
  * RETURN: Returns 0 on success, -1 on failure.
  */
 int32_t rtc_write(int32_t fd, const void* buf, int32_t nbytes){
-	/* Make sure freq is between 2 Hz and 1024 Hz. */
 	if(buf == 0)
 		return -1;
 	if(nbytes != 4)
 		return -1;
 
-	int freq = *(int*)buf;
-
-	if(freq < 2 || freq > 1024){ //power of 2 below 1024 Hz.
-		puts("This frequency is out of range.\n");
+	if(rtc_set_freq(fd ? (file_desc_t*)fd : &kernel_rtc, *(int*)buf) != 0){
+		puts("Frequency given is invalid.\n");
 		return -1;				// Failure.
 	}
-	
-	/* 
-	 * If it is in range, let's just do a switch over the 10 possible frequencies.
-	 * Since select_bits is only 4 bits, the upper 4 bits will always be 0x0. The
-	 * codes for the lower 4 bits come from the RTC data sheet.
-	 */
-	uint8_t select_bits;		// This is the value we will write into the last 4 bits of register A.
-	switch(freq){				// Recall that freq is in Hz.
-		case 2:
-			select_bits = 0x0F;
-			break;
-		case 4:
-			select_bits = 0x0E;
-			break;
-		case 8:
-			select_bits = 0x0D;
-			break;
-		case 16:
-			select_bits = 0x0C;
-			break;
-		case 32:
-			select_bits = 0x0B;
-			break;
-		case 64:
-			select_bits = 0x0A;
-			break;
-		case 128:
-			select_bits = 0x09;
-			break;
-		case 256:
-			select_bits = 0x08;
-			break;
-		case 512:
-			select_bits = 0x07;
-			break;
-		case 1024:
-			select_bits = 0x06;
-			break;
-		default:
-			puts("Frequency given is invalid.\n");
-			return -1;						// Failure.
-	}
-	
-	/* 
-	 * If we made it past the switch statement, we have a valid code.
-	 * Now we need to append these 4 bits onto the end of register A.
-	 */
-	cli();									// We shouldn't be interrupted during this process.
-	outb(0x8A, RTC_INDEX_PORT);				// Select register A.
-	uint8_t a_orig = inb(RTC_DATA_PORT);	// Grab A's original value.
-	a_orig &= 0xF0;							// Save only the upper 4-bits (nibble?).
-	select_bits |= a_orig;					// Combine values.
-	outb(0x8A, RTC_INDEX_PORT);				// Reset index.		
-	outb(select_bits, RTC_DATA_PORT);		// Write the data to register A.
-	sti();
-	return 0;								// Success.
+	return 0;					// Success.
 }
@@ -4,9 +4,15 @@
 #include "lib.h"
 #include "x86_desc.h"
 #include "i8259.h"
+#include "interrupts.h"
 
 #define RTC_INDEX_PORT 0x70
 #define RTC_DATA_PORT 0x71
+#define RTC_MAX_FREQ 1024		// The hardware always runs at this rate.
+#define RTC_MAX_RATE 0x06		// Rate select bits of register A for 1024 Hz.
+#define RTC_DEFAULT_FREQ 2		// What a newly opened RTC file ticks at.
+
+struct file_descriptor;
 
 /***********************************/
 /***** RTC INTERRUPT FUNCTIONS *****/
@@ -17,22 +23,28 @@ extern void rtc_linker();
 /* RTC initialization function. */
 void rtc_init();
 
-/* Interrupt handler for the RTC. */
-void rtc_handler();
+/* Interrupt handler for the RTC. frame is where it interrupted. */
+void rtc_handler(irq_frame_t* frame);
+
+/* Number of RTC interrupts since boot. */
+uint32_t rtc_get_ticks();
+
+/* Sets the virtual frequency of one open RTC file and restarts its ticks. */
+int32_t rtc_set_freq(struct file_descriptor* file, int32_t freq);
 
 /*******************************/
 /****** CORE RTC FUNCTIONS *****/
 /*******************************/
-/* Initializes the RTC if it is not yet open. */
+/* Nothing to do: every open RTC file has its own virtual rate. */
 int32_t rtc_open();
 
-/* Closes the RTC if it has opened. */
+/* Nothing to do either. */
 int32_t rtc_close();
 
-/* Returns 0 after the next RTC interrupt occurs. */
+/* Returns 0 at this file's next virtual tick. */
 int32_t rtc_read(int32_t fd, const void* buf, int32_t nbytes);
 
-/* Write an interrupt frequency (must be a power of 2 up to 1024) to the RTC. */
+/* Sets this file's virtual frequency (a power of 2 from 2 to 1024 Hz). */
 int32_t rtc_write(int32_t fd, const void* buf, int32_t freq);
 
 #endif
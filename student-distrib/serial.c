@@ -0,0 +1,58 @@
+/*
+ * This file will contain the COM1 output driver.
+ *
+ * Output is polled: each byte waits for the transmit register to empty.
+ * Nothing reads the port, and the UART's interrupt stays off, so this can
+ * be called from anywhere, including with interrupts disabled.
+ */
+#include "serial.h"
+#include "lib.h"
+
+#define SERIAL_SPIN_LIMIT	100000		// Give up on a byte if no UART answers.
+
+/* void serial_init()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: 115200 baud, 8 data bits, no parity, one stop bit, FIFOs on */
+void serial_init(){
+	outb(0x00, COM1_IER);					// No interrupts.
+	outb(SERIAL_LCR_DLAB, COM1_LCR);
+	outb(SERIAL_DIVISOR & 0xFF, COM1_DATA);
+	outb(SERIAL_DIVISOR >> 8, COM1_IER);
+	outb(SERIAL_LCR_8N1, COM1_LCR);			// Also clears DLAB.
+	outb(0xC7, COM1_FCR);					// Enable and clear the FIFOs.
+	outb(0x03, COM1_MCR);					// DTR and RTS.
+}
+
+/* void serial_putc(uint8_t c)
+ * Inputs:      uint8_t c = byte to send
+ * Return Value: NONE
+ * Function: waits for room, bounded so a machine without COM1 does not hang */
+void serial_putc(uint8_t c){
+	uint32_t spin;
+
+	if(c == '\n'){
+		serial_putc('\r');
+	}
+	for(spin = 0; spin < SERIAL_SPIN_LIMIT && !(inb(COM1_LSR) & SERIAL_LSR_THRE); spin++);
+	outb(c, COM1_DATA);
+}
+
+/* void serial_puts(const int8_t* s)
+ * Inputs:      const int8_t* s = string to send
+ * Return Value: NONE */
+void serial_puts(const int8_t* s){
+	while(*s != '\0'){
+		serial_putc(*s++);
+	}
+}
+
+/* void serial_putu(uint32_t value, int32_t radix)
+ * Inputs:      uint32_t value = number to send
+ *              int32_t radix = 10 or 16 (no prefix)
+ * Return Value: NONE */
+void serial_putu(uint32_t value, int32_t radix){
+	int8_t buf[12];
+
+	serial_puts(itoa(value, buf, radix));
+}
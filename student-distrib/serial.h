@@ -0,0 +1,33 @@
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+/* Polled output on COM1, for dumping data to the host (QEMU's -serial). */
+#include "types.h"
+
+#define COM1_BASE			0x3F8
+#define COM1_DATA			(COM1_BASE + 0)		// Divisor low byte while DLAB is set.
+#define COM1_IER			(COM1_BASE + 1)		// Divisor high byte while DLAB is set.
+#define COM1_FCR			(COM1_BASE + 2)
+#define COM1_LCR			(COM1_BASE + 3)
+#define COM1_MCR			(COM1_BASE + 4)
+#define COM1_LSR			(COM1_BASE + 5)
+#define SERIAL_LCR_DLAB		0x80
+#define SERIAL_LCR_8N1		0x03
+#define SERIAL_LSR_THRE		0x20				// Transmit holding register empty.
+#define SERIAL_DIVISOR		1					// 115200 baud.
+
+#ifndef ASM
+/* Sets up COM1 for 115200 8N1 without interrupts. */
+void serial_init();
+
+/* Writes one byte, turning \n into \r\n. */
+void serial_putc(uint8_t c);
+
+/* Writes a NUL-terminated string. */
+void serial_puts(const int8_t* s);
+
+/* Writes value in the given radix. */
+void serial_putu(uint32_t value, int32_t radix);
+#endif		// ASM
+
+#endif
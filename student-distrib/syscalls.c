@@ -3,6 +3,9 @@
  * This file will implement the system calls.
  */
 #include "syscalls.h"
+#include "task_switch.h"
+
+static int32_t execute(const uint8_t* command, int32_t slot);
 
 int32_t proc_arr[MAX_PROCESSES] = {FREE};		// Contains a list of ENUM types that tell us if a certain stack space is free or not.
 
@@ -53,11 +56,21 @@ int32_t* get_proc_arr(){
  * Halts the process that calls this function.
  */
 int32_t sys_halt(uint8_t status){
+	return halt_process(status);
+}
+
+/*
+ * Tears down the current process and returns status from its parent's
+ * execute. Unlike sys_halt, status is not limited to a byte, which lets the
+ * exception path report EXCEPTION_STATUS (256).
+ */
+int32_t halt_process(uint32_t status){
 	int32_t process_number = get_process_number();
 	/* Do absolutely nothing if the process number is 0 (the base shell). */
 	if(process_number == 0){
 		return 0;
 	}
+	TRACE_EVENT(TR_HALT, process_number, status);
 	pcb_t* cur_pcb_loc = get_pcb_loc(process_number);
 	
 	/* Just close everything. */
@@ -66,6 +79,9 @@ int32_t sys_halt(uint8_t status){
 		sys_close(loopCount);
 	}
 	
+	/* Commit any metadata updates the process left in the journal. */
+	fs_sync();
+	
 	tss.esp0 = KERNEL_LOC + FOUR_MB - (EIGHT_KB * (cur_pcb_loc -> parent_pid)) - 1;
 	
 	//restore parent paging(the same paging set up in sys_execute)
@@ -81,11 +97,8 @@ int32_t sys_halt(uint8_t status){
 		:"eax"
 	);
 	
-	/* Zero extend status. */
-	uint32_t zext_status = 0;
-	zext_status += status;
-	
 	/* Denote the current process slot as free. */
+	acct_charge();
 	proc_arr[process_number] = FREE;
 	
 	//jump to execute return(jump to IRET in execute's(or parent's) stack by restoring parent's esp and ebp registers)
@@ -102,13 +115,44 @@ int32_t sys_halt(uint8_t status){
 		:
 		:"r"(cur_pcb_loc -> parent_esp),
 		"r"(cur_pcb_loc -> parent_ebp),
-		"r"(zext_status)
+		"r"(status)
 		:"esp","ebp"
 	);
 	
 	return 0;
 }
 
+/*
+ * Ends the current process after it faulted; never returns. A program is
+ * halted and its parent's execute returns status. A base shell has no
+ * parent to return to, so it is started again in place: its user page is
+ * cleared and "shell" is loaded into the same slot, on the same terminal.
+ * Either way the other terminals keep running. Only if that fails is the
+ * machine stopped.
+ */
+void kill_process(uint32_t status){
+	int32_t process_number = get_process_number();
+
+	if(process_number >= NUM_TERMS){
+		halt_process(status);
+	}
+	else if(process_number >= 0){
+		int32_t fd;
+		for(fd = 2; fd < MAX_TASK; fd++){
+			sys_close(fd);
+		}
+		fs_sync();
+		TRACE_EVENT(TR_HALT, process_number, status);
+		printf("Shell %d ended with status %d, restarting.\n", process_number, status);
+		memset((void*)OTE_MB, 0, FOUR_MB);		// Still mapped to this shell's page.
+		execute((const uint8_t*)"shell", process_number);
+	}
+
+	puts("Unrecoverable exception, system halted.\n");
+	cli();
+	while(1){}
+}
+
 /*
  * Execute will perform all of the necessary preparations for executing a user-
  * generated system call, including setting up the kernel stack for the process,
@@ -121,6 +165,17 @@ int32_t sys_halt(uint8_t status){
  *					code.
  */ 
 int32_t sys_execute(const uint8_t* command){
+	return execute(command, -1);
+}
+
+/*
+ * Does the work of sys_execute. With slot -1 the program gets a free
+ * process slot and the caller becomes its parent. Otherwise slot is the
+ * running process, which is replaced in place: it keeps its slot, its
+ * parent and its terminal, and on failure the slot is left FREE. Kept out
+ * of line so halt_process's leave/ret always lands in this frame.
+ */
+static int32_t __attribute__((noinline)) execute(const uint8_t* command, int32_t slot){
 	int32_t parent_pid = get_process_number();
 	
 	/* Figure out our current process. */
@@ -144,6 +199,10 @@ int32_t sys_execute(const uint8_t* command){
 		}
 	}
 	
+	if(slot != -1){
+		process_number = slot;
+	}
+	
 	/* If the process number is still -1, there are not any available slots. */
 	if(process_number == -1){
 		return -1;
@@ -182,21 +241,29 @@ int32_t sys_execute(const uint8_t* command){
 	/***** CHECK EXECUTABLE *****/
 	uint8_t magic_nums[4] = {0x7F,0x45,0x4C,0x46}; 
 
-	dentry_t dentry;
-	if(read_dentry_by_name(filename, &dentry) != 0){
+	/* One directory lookup; the same handle loads the program below. */
+	file_handle_t exe;
+	if(file_handle_open(filename, &exe) != 0){
 		proc_arr[process_number] = FREE;
 		return -1;
 	}
 
-	int32_t buf_size = get_file_length_by_name(filename);
-	uint8_t file_buf[FILE_BUF_SIZE];			
+	/* In a RAM image the header is checked where it lies, otherwise it is copied into file_buf. */
+	uint8_t file_buf[FILE_BUF_SIZE];
+	uint8_t* header = file_buf;
+	if(exe.length < FILE_BUF_SIZE ||
+	   (file_handle_map(&exe, 0, &header) <= 0 && file_handle_read(&exe, 0, file_buf, FILE_BUF_SIZE) != FILE_BUF_SIZE)){
+		file_handle_close(&exe);
+		proc_arr[process_number] = FREE;
+		return -1;
+	}
 	
 	/* Check to see if the file's header are the magic numbers above. */
-	read_data(dentry.inode_num, 0, file_buf, FILE_BUF_SIZE);
 	uint32_t exeIt;
 	for(exeIt = 0; exeIt < 3; exeIt++){	// Magic number is only 4 bytes long.
 		/* We fail if the first byte (the header) is not the magic number array above. */
-		if(file_buf[exeIt] != magic_nums[exeIt]){
+		if(header[exeIt] != magic_nums[exeIt]){
+			file_handle_close(&exe);
 			proc_arr[process_number] = FREE;
 			return -1;
 		}
@@ -205,7 +272,7 @@ int32_t sys_execute(const uint8_t* command){
 	/* Fetch the entry point. */
 	uint32_t entry_point = NULL;
 	for(exeIt = 0; exeIt < 4; exeIt++){
-		entry_point += file_buf[exeIt + ENTRY_PT] << (MAX_FN * exeIt);
+		entry_point += header[exeIt + ENTRY_PT] << (MAX_FN * exeIt);
 	}
 	
 	/***** SET UP PROGRAM PAGING *****/
@@ -230,7 +297,8 @@ int32_t sys_execute(const uint8_t* command){
 	/***** USER-LEVEL PROGRAM LOADER *****/
 	/* Copy file contents to correct location. */
 	// THIS FILE SIZE NEEDS TO BE ABLE TO CHANGE DYNAMICALLY!!! FIX.
-	read_data(dentry.inode_num, 0,(uint8_t*)(OTE_MB + USER_IDX), buf_size);
+	file_handle_read(&exe, 0, (uint8_t*)(OTE_MB + USER_IDX), exe.length);
+	file_handle_close(&exe);
 	
 	/***** CREATE PCB *****/
 	/* Create the file descriptor array and put it into memory. */
@@ -244,6 +312,7 @@ int32_t sys_execute(const uint8_t* command){
 		pcb.file_desc[pcb_it].inode = 0;
 		pcb.file_desc[pcb_it].file_position = 0;
 		pcb.file_desc[pcb_it].flags = 0;
+		pcb.file_desc[pcb_it].read_timeout = 0;
 	}
 
 	/* Grab the parent ESP and EBP and store them. */
@@ -274,6 +343,9 @@ int32_t sys_execute(const uint8_t* command){
 	/* Copy arg into the PCB. */
 	memcpy(pcb.arg, arg, KB_BUF_SIZE_MAX);
 	pcb.arg_size = getargs_it;
+	prof_exec(process_number, filename);
+	acct_exec(&pcb.stat, filename);
+	TRACE_EVENT(TR_EXECUTE, process_number, parent_pid);
 	
 	/* Save old parent address. */	
 	pcb.parent_phys_addr = par_phys_addr;
@@ -281,6 +353,15 @@ int32_t sys_execute(const uint8_t* command){
 	/* Save current terminal for this process. */
 	pcb.term_number = get_cur_term();
 	pcb.parent_pid = parent_pid;
+
+	/* A process replaced in place goes back to the same parent when it halts. */
+	if(slot != -1){
+		pcb.parent_esp = pcb_loc -> parent_esp;
+		pcb.parent_ebp = pcb_loc -> parent_ebp;
+		pcb.parent_phys_addr = pcb_loc -> parent_phys_addr;
+		pcb.parent_pid = pcb_loc -> parent_pid;
+		pcb.term_number = pcb_loc -> term_number;
+	}
 	
 	/* Copy our PCB into the proper memory location. */
 	memcpy((uint32_t*)pcb_loc, &pcb, sizeof(pcb));
@@ -297,6 +378,7 @@ int32_t sys_execute(const uint8_t* command){
 	tss.ss0 = KERNEL_DS;
 	
 	uint32_t int_set = 0x200;					// This will set the INTR flag in EFLAGS.
+	boot_mark(BOOT_USER);						// Only the first execute counts.
 	
 	/* Perform an IRET with proper context. */
 	asm volatile(
@@ -327,6 +409,34 @@ int32_t sys_execute(const uint8_t* command){
 	return 0;
 }
 
+/*
+ * Returns 1 if the len bytes at ptr lie inside the program page, the only
+ * memory a user pointer may name; 0 otherwise, including for NULL. Every
+ * pointer a system call dereferences is checked with this first, so a bad
+ * one fails the call instead of faulting in the kernel.
+ */
+int32_t user_range_ok(const void* ptr, uint32_t len){
+	uint32_t addr = (uint32_t)ptr;
+	return addr >= OTE_MB && len <= FOUR_MB && addr - OTE_MB <= FOUR_MB - len;
+}
+
+/*
+ * Returns 1 if s is a NUL-terminated string inside the program page that
+ * fits in max bytes, terminator included; 0 otherwise.
+ */
+int32_t user_string_ok(const uint8_t* s, uint32_t max){
+	uint32_t i;
+	for(i = 0; i < max; i++){
+		if(!user_range_ok(s + i, 1)){
+			return 0;
+		}
+		if(s[i] == '\0'){
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /* sys_read
  * Description : reads file
  	input: fd - file descriptor index
@@ -345,6 +455,11 @@ int32_t sys_read(int32_t fd, void* buf, int32_t nbytes){
 		return -1;
 	}
 
+	//the whole buffer has to be the program's
+	if(nbytes < 0 || !user_range_ok(buf, nbytes)){
+		return -1;
+	}
+
 	//check if the file exists
  	if((cur_pcb_loc->file_desc[fd].flags & 1) ==0 ){
 		return -1;
@@ -354,6 +469,9 @@ int32_t sys_read(int32_t fd, void* buf, int32_t nbytes){
 	fot_t* ret = cur_pcb_loc->file_desc[fd].fot_ptr;
 	int32_t* fd__ = (int32_t*)&(cur_pcb_loc->file_desc[fd]);
 	int32_t ret_val = ret->read((int32_t)fd__, buf, nbytes);
+	if(ret_val > 0){
+		cur_pcb_loc->stat.bytes_read += ret_val;
+	}
 	return ret_val;
 }
 
@@ -375,6 +493,11 @@ int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes){
 			return -1;
 		}
 
+	//the whole buffer has to be the program's
+	if(nbytes < 0 || !user_range_ok(buf, nbytes)){
+		return -1;
+	}
+
 	//check if file exists
  	if((cur_pcb_loc->file_desc[fd].flags & 1) == 0){
 		return -1;
@@ -382,7 +505,11 @@ int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes){
 
 	//get the file operation pointer and write
 	fot_t* ret = cur_pcb_loc->file_desc[fd].fot_ptr;
-	uint32_t ret_val = ret->write(fd, buf, nbytes);
+	int32_t* fd__ = (int32_t*)&(cur_pcb_loc->file_desc[fd]);
+	int32_t ret_val = ret->write((int32_t)fd__, buf, nbytes);
+	if(ret_val > 0){
+		cur_pcb_loc->stat.bytes_written += ret_val;
+	}
 	return ret_val;
 }
 
@@ -401,7 +528,7 @@ int32_t sys_open(const uint8_t* filename){
 	dentry_t dentry;
 
 	//read the file and get dentry
-	if(read_dentry_by_name(filename, &dentry) == -1){
+	if(!user_string_ok(filename, MAX_FILENAME_LENGTH + 1) || read_dentry_by_name(filename, &dentry) == -1){
 		return -1;
 	}
 
@@ -410,6 +537,9 @@ int32_t sys_open(const uint8_t* filename){
 		if((cur_pcb_loc->file_desc[i].flags) == 0){
 			cur_pcb_loc->file_desc[i].flags = 1;
 			cur_pcb_loc->file_desc[i].file_position = 0;
+			cur_pcb_loc->file_desc[i].ra_pos = 0;
+			cur_pcb_loc->file_desc[i].ra_window = 0;
+			cur_pcb_loc->file_desc[i].read_timeout = 0;
 			break;
 		}
 	}
@@ -424,15 +554,16 @@ int32_t sys_open(const uint8_t* filename){
 			if(rtc_open() == -1){
 				return -1;
 			}
-			cur_pcb_loc->file_desc[i].inode = -1;
+			cur_pcb_loc->file_desc[i].inode = dentry.inode_num;
 			cur_pcb_loc->file_desc[i].fot_ptr = (fot_t *)&rtc_fot;
+			rtc_set_freq(&cur_pcb_loc->file_desc[i], RTC_DEFAULT_FREQ);
 			break;
 
 		case TYPE_DIR:
 			if(dir_open() != 0){
 				return -1;
 			}
-			cur_pcb_loc->file_desc[i].inode = -1;
+			cur_pcb_loc->file_desc[i].inode = dentry.inode_num;
 			cur_pcb_loc->file_desc[i].fot_ptr = (fot_t *)&dir_fot;
 			break;
 
@@ -513,6 +644,9 @@ int32_t sys_getargs(uint8_t* buf, int32_t nbytes){
 	if(nbytes > KB_BUF_SIZE_MAX){
 		nbytes = KB_BUF_SIZE_MAX;
 	}
+	if(!user_range_ok(buf, nbytes + 1)){
+		return -1;
+	}
 	memset(buf, 0, nbytes + 1);			// Set the whole thing to NULL to begin with.
 	memcpy(buf, arg_ptr, nbytes);		// It is good practice to use memcpy instead of '='.
 	return 0;
@@ -523,7 +657,7 @@ int32_t sys_getargs(uint8_t* buf, int32_t nbytes){
  */
 int32_t sys_vidmap(uint8_t** screen_start){	
 	/* Check that the physical address provided is in a valid location. */
-	if(screen_start < (uint8_t**)OTE_MB || screen_start > (uint8_t**)(OTE_MB + FOUR_MB)){
+	if(!user_range_ok(screen_start, sizeof(*screen_start))){
 		return -1;
 	}
 	
@@ -560,3 +694,480 @@ int32_t sys_set_handler(int32_t signum, void* handler_address){
 int32_t sys_sigreturn(void){
 	return 0;
 }
+
+/*
+ * Does nothing. This exists so that the cost of getting into and out of the
+ * kernel can be measured on its own.
+ */
+int32_t sys_nop(void){
+	return 0;
+}
+
+/* sys_readv
+ * Description : reads into several buffers with one kernel entry
+ 	input: fd - file descriptor index
+ 			iov - array of buffers to fill, in order
+ 			iovcnt - number of entries in iov
+ 	output: total bytes read, -1 error
+ 	effect: stops at the first buffer that is not filled completely
+ */
+int32_t sys_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt){
+	if(iovcnt < 1 || iovcnt > MAX_IOV || !user_range_ok(iov, iovcnt * sizeof(iovec_t))){
+		return -1;
+	}
+
+	int32_t total = 0;
+	int32_t i;
+	for(i = 0; i < iovcnt; i++){
+		/* sys_read checks each base and len against the program page. */
+		int32_t ret_val = sys_read(fd, iov[i].base, iov[i].len);
+		if(ret_val == -1){
+			return (total == 0) ? -1 : total;
+		}
+		total += ret_val;
+		if(ret_val < iov[i].len){		// Short read, nothing more to give.
+			break;
+		}
+	}
+	return total;
+}
+
+/* sys_writev
+ * Description : writes several buffers with one kernel entry
+ 	input: fd - file descriptor index
+ 			iov - array of buffers to write, in order
+ 			iovcnt - number of entries in iov
+ 	output: sum of what each write returned, -1 error
+ 	effect: write
+ */
+int32_t sys_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt){
+	if(iovcnt < 1 || iovcnt > MAX_IOV || !user_range_ok(iov, iovcnt * sizeof(iovec_t))){
+		return -1;
+	}
+
+	int32_t total = 0;
+	int32_t i;
+	for(i = 0; i < iovcnt; i++){
+		/* sys_write checks each base and len against the program page. */
+		int32_t ret_val = sys_write(fd, iov[i].base, iov[i].len);
+		if(ret_val == -1){
+			return (total == 0) ? -1 : total;
+		}
+		total += ret_val;
+	}
+	return total;
+}
+
+/* sys_batch
+ * Description : runs an array of system calls with one kernel entry
+ 	input: calls - descriptors to run, in order; each ret is filled in
+ 			count - number of descriptors
+ 	output: number of calls that succeeded before the first failure, -1 error
+ 	effect: halt, execute and batch itself cannot be batched
+ */
+int32_t sys_batch(syscall_desc_t* calls, int32_t count){
+	if(count < 1 || count > MAX_BATCH || !user_range_ok(calls, count * sizeof(syscall_desc_t))){
+		return -1;
+	}
+
+	int32_t i;
+	for(i = 0; i < count; i++){
+		int32_t num = calls[i].num;
+		if(num < SYS_READ || num > NUM_SYSCALLS || num == SYS_BATCH){
+			calls[i].ret = -1;
+			return i;
+		}
+		/* Each call checks its own pointer arguments. */
+		calls[i].ret = syscall_table[num](calls[i].arg[0], calls[i].arg[1], calls[i].arg[2], calls[i].arg[3]);
+		if(calls[i].ret == -1){
+			return i;
+		}
+	}
+	return count;
+}
+
+/* sys_getdents
+ * Description : reads many directory entries with one kernel entry
+ 	input: fd - file descriptor index of an open directory
+ 			buf - array of dirent_t to fill
+ 			nbytes - size of buf in bytes
+ 	output: bytes filled (a multiple of sizeof(dirent_t)), 0 at the end, -1 error
+ 	effect: advances the directory's cursor
+ */
+int32_t sys_getdents(int32_t fd, void* buf, int32_t nbytes){
+	/* Get the current process number and PCB location. */
+	int32_t process_number = get_process_number();
+	pcb_t* cur_pcb_loc = get_pcb_loc(process_number);
+
+	//check if fd goes out of index
+	if(fd < 0 || fd >= MAX_TASK){
+		return -1;
+	}
+
+	//only open directories have entries
+	if((cur_pcb_loc->file_desc[fd].flags & 1) == 0 || cur_pcb_loc->file_desc[fd].fot_ptr != &dir_fot){
+		return -1;
+	}
+	if(nbytes < 0 || !user_range_ok(buf, nbytes)){
+		return -1;
+	}
+	return dir_getdents((int32_t)&(cur_pcb_loc->file_desc[fd]), buf, nbytes);
+}
+
+/* sys_stat
+ * Description : looks up a file's metadata by name
+ 	input: filename - file name string
+ 			buf - stat_t to fill
+ 	output: 0 if sucess, -1 error
+ 	effect: none, no data blocks are read
+ */
+int32_t sys_stat(const uint8_t* filename, stat_t* buf){
+	dentry_t dentry;
+
+	if(!user_string_ok(filename, MAX_FILENAME_LENGTH + 1) || !user_range_ok(buf, sizeof(stat_t)) ||
+	   read_dentry_by_name(filename, &dentry) == -1){
+		return -1;
+	}
+	return file_stat(dentry.file_type, dentry.inode_num, buf);
+}
+
+/* sys_fstat
+ * Description : looks up an open file's metadata
+ 	input: fd - file descriptor index
+ 			buf - stat_t to fill
+ 	output: 0 if sucess, -1 error (including stdin/stdout)
+ 	effect: none, no data blocks are read
+ */
+int32_t sys_fstat(int32_t fd, stat_t* buf){
+	/* Get the current process number and PCB location. */
+	int32_t process_number = get_process_number();
+	pcb_t* cur_pcb_loc = get_pcb_loc(process_number);
+
+	//check if fd goes out of index
+	if(fd < 0 || fd >= MAX_TASK){
+		return -1;
+	}
+
+	//check if the file exists
+	if((cur_pcb_loc->file_desc[fd].flags & 1) == 0 || !user_range_ok(buf, sizeof(stat_t))){
+		return -1;
+	}
+
+	//the file type is implied by the operations table
+	fot_t* fot = cur_pcb_loc->file_desc[fd].fot_ptr;
+	int32_t file_type;
+	if(fot == &file_fot){
+		file_type = TYPE_FILE;
+	}
+	else if(fot == &dir_fot){
+		file_type = TYPE_DIR;
+	}
+	else if(fot == &rtc_fot){
+		file_type = TYPE_RTC;
+	}
+	else{
+		return -1;
+	}
+	return file_stat(file_type, cur_pcb_loc->file_desc[fd].inode, buf);
+}
+
+/*
+ * Returns the file descriptor entry for fd if it is an open regular file,
+ * NULL otherwise. Only regular files have a byte position to move.
+ */
+static file_desc_t* get_open_file(int32_t fd){
+	pcb_t* cur_pcb_loc = get_pcb_loc(get_process_number());
+
+	if(fd < 0 || fd >= MAX_TASK){
+		return NULL;
+	}
+	if((cur_pcb_loc->file_desc[fd].flags & 1) == 0 || cur_pcb_loc->file_desc[fd].fot_ptr != &file_fot){
+		return NULL;
+	}
+	return &(cur_pcb_loc->file_desc[fd]);
+}
+
+/* sys_lseek
+ * Description : moves a regular file's read position
+ 	input: fd - file descriptor index
+ 			offset - signed byte offset
+ 			whence - SEEK_SET, SEEK_CUR or SEEK_END
+ 	output: the new position, -1 error
+ 	effect: later reads start at the new position. Seeking past the end is
+ 			allowed, reads there return 0.
+ */
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence){
+	file_desc_t* file = get_open_file(fd);
+	stat_t st;
+	int32_t base;
+
+	if(file == NULL){
+		return -1;
+	}
+	switch(whence){
+		case SEEK_SET:
+			base = 0;
+			break;
+		case SEEK_CUR:
+			base = file->file_position;
+			break;
+		case SEEK_END:
+			if(file_stat(TYPE_FILE, file->inode, &st) != 0){
+				return -1;
+			}
+			base = st.length;
+			break;
+		default:
+			return -1;
+	}
+	if(base + offset < 0){
+		return -1;
+	}
+	file->file_position = base + offset;
+	return file->file_position;
+}
+
+/* sys_pread
+ * Description : reads from a regular file at a given offset
+ 	input: fd - file descriptor index
+ 			buf - buffer to read into
+ 			nbytes - number of bytes to read
+ 			offset - byte offset to read from
+ 	output: bytes read, 0 past the end, -1 error
+ 	effect: the file's position is left untouched
+ */
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, int32_t offset){
+	file_desc_t* file = get_open_file(fd);
+
+	if(file == NULL || nbytes < 0 || offset < 0 || !user_range_ok(buf, nbytes)){
+		return -1;
+	}
+	int32_t ret_val = read_data(file->inode, offset, (uint8_t*)buf, nbytes);
+	if(ret_val > 0){
+		get_pcb_loc(get_process_number())->stat.bytes_read += ret_val;
+	}
+	return ret_val;
+}
+
+/* sys_create
+ * Description : creates an empty regular file and opens it
+ 	input: filename - name of the new file (at most 32 characters)
+ 	output: file descriptor index, -1 error
+ 	effect: fails if the file already exists or no descriptor is free; in
+ 		either case nothing is created
+ */
+int32_t sys_create(const uint8_t* filename){
+	pcb_t* cur_pcb_loc = get_pcb_loc(get_process_number());
+	int32_t i;
+
+	if(!user_string_ok(filename, MAX_FILENAME_LENGTH + 1)){
+		return -1;
+	}
+
+	//a full descriptor table must fail before the file exists, or a retry would find the name taken
+	for(i = MIN_TASK; i < MAX_TASK && cur_pcb_loc->file_desc[i].flags != 0; i++);
+	if(i == MAX_TASK || file_create(filename) != 0){
+		return -1;
+	}
+
+	//only this process uses its table, and opening a regular file cannot fail otherwise
+	return sys_open(filename);
+}
+
+/* sys_truncate
+ * Description : sets the length of an open regular file
+ 	input: fd - file descriptor index
+ 			length - new length in bytes
+ 	output: 0 if sucess, -1 error
+ 	effect: frees or allocates data blocks; the file position is not moved
+ */
+int32_t sys_truncate(int32_t fd, int32_t length){
+	file_desc_t* file = get_open_file(fd);
+
+	if(file == NULL || length < 0){
+		return -1;
+	}
+	return file_truncate(file->inode, length);
+}
+
+/* sys_cachestat
+ * Description : reports the buffer cache counters
+ 	input: buf - where to copy the counters, may be NULL
+ 			flags - CACHE_RESET to zero the counters afterwards, CACHE_DROP
+ 					to empty the cache (for cold cache measurements)
+ 	output: 0 if sucess, -1 error
+ 	effect: the counters stay at zero while the filesystem is a GRUB module
+ */
+int32_t sys_cachestat(bcache_stat_t* buf, int32_t flags){
+	if(flags & ~(CACHE_RESET | CACHE_DROP)){
+		return -1;
+	}
+	if(buf != NULL && !user_range_ok(buf, sizeof(bcache_stat_t))){
+		return -1;
+	}
+	bcache_stats(buf, flags);
+	return 0;
+}
+
+/* sys_clock_gettime
+ * Description : reads the kernel clock
+ 	input: clock_id - CLOCK_MONOTONIC
+ 			ts - where to store the time
+ 	output: 0 if sucess, -1 error
+ 	effect: none
+ */
+int32_t sys_clock_gettime(int32_t clock_id, timespec_t* ts){
+	if(clock_id != CLOCK_MONOTONIC || !user_range_ok(ts, sizeof(timespec_t))){
+		return -1;
+	}
+	clock_ns_to_timespec(clock_ns(), ts);
+	return 0;
+}
+
+/* sys_clockmap
+ * Description : tells a program where the read-only clock page is
+ 	input: page - where to store the page's address
+ 	output: the address if sucess, -1 error
+ 	effect: the page is mapped in every process from boot on; see clock.h
+ 		for turning a TSC reading into the clock's time with it
+ */
+int32_t sys_clockmap(const clock_page_t** page){
+	if(!user_range_ok(page, sizeof(*page))){
+		return -1;
+	}
+	*page = (const clock_page_t*)CLOCK_PAGE_ADDR;
+	return CLOCK_PAGE_ADDR;
+}
+
+/* sys_nanosleep
+ * Description : sleeps for at least the given time
+ 	input: req - how long, rounded up to a whole timer tick (1/1024 s)
+ 	output: 0 if sucess, -1 error
+ 	effect: the wait costs the timer wheel nothing per tick; the process
+ 		halts between interrupts until its timer fires
+ */
+int32_t sys_nanosleep(const timespec_t* req){
+	int32_t ticks;
+
+	if(!user_range_ok(req, sizeof(timespec_t)) || (ticks = timer_ticks(req)) == -1){
+		return -1;
+	}
+	timer_sleep(ticks);
+	return 0;
+}
+
+/* sys_set_timeout
+ * Description : limits how long reads on a file may block
+ 	input: fd - file descriptor index
+ 			timeout - longest wait, NULL or zero to wait forever
+ 	output: 0 if sucess, -1 error
+ 	effect: a terminal or RTC read that is not done in time returns -1.
+ 		Regular files and directories never block, so it does not matter
+ 		for them.
+ */
+int32_t sys_set_timeout(int32_t fd, const timespec_t* timeout){
+	pcb_t* cur_pcb_loc = get_pcb_loc(get_process_number());
+	int32_t ticks = 0;
+
+	if(fd < 0 || fd >= MAX_TASK || (cur_pcb_loc->file_desc[fd].flags & 1) == 0){
+		return -1;
+	}
+	if(timeout != NULL && (!user_range_ok(timeout, sizeof(timespec_t)) || (ticks = timer_ticks(timeout)) == -1)){
+		return -1;
+	}
+	cur_pcb_loc->file_desc[fd].read_timeout = ticks;
+	return 0;
+}
+
+/* sys_profile
+ * Description : controls the sampling profiler
+ 	input: cmd - PROF_START, PROF_STOP, PROF_READ, PROF_NAME or PROF_DUMP
+ 			buf - histogram entries for PROF_READ, a name for PROF_NAME
+ 			n - entries buf holds for PROF_READ, the program index for PROF_NAME
+ 	output: see prof.h, -1 error
+ 	effect: PROF_START discards the previous profile; PROF_DUMP writes the
+ 		histogram to COM1 for prof.py
+ */
+int32_t sys_profile(int32_t cmd, void* buf, int32_t n){
+	uint32_t len = 0;
+
+	if(cmd == PROF_READ){
+		if(n < 0 || n > PROF_HASH_SIZE){
+			return -1;
+		}
+		len = n * sizeof(prof_entry_t);
+	}
+	else if(cmd == PROF_NAME){
+		len = PROF_NAME_LEN;
+	}
+	if(len != 0 && !user_range_ok(buf, len)){
+		return -1;
+	}
+	return prof_ctl(cmd, buf, n);
+}
+
+/* sys_trace
+ * Description : reads out the kernel event trace
+ 	input: cmd - TRACE_DUMP or TRACE_CLEAR
+ 	output: events dumped, 0 for TRACE_CLEAR, -1 error or a kernel built
+ 		without TRACE
+ 	effect: TRACE_DUMP writes the events to COM1 but keeps them
+ */
+int32_t sys_trace(int32_t cmd){
+	return trace_ctl(cmd);
+}
+
+/* sys_irqstat
+ * Description : reports how long interrupt handlers ran and how long
+ 		interrupts were off
+ 	input: buf - where to copy the histograms, may be NULL
+ 			flags - IRQSTAT_RESET to zero them afterwards
+ 	output: 0 if sucess, -1 error
+ 	effect: none
+*/
+int32_t sys_irqstat(irqstat_t* buf, int32_t flags){
+	if(flags & ~IRQSTAT_RESET){
+		return -1;
+	}
+	if(buf != NULL && !user_range_ok(buf, sizeof(irqstat_t))){
+		return -1;
+	}
+	irqstat_get(buf, flags);
+	return 0;
+}
+
+/* sys_procstat
+ * Description : reports the CPU time and I/O of every running process
+ 	input: buf - where to copy one proc_info_t per process
+ 			n - how many fit in buf
+ 	output: number of processes copied, -1 error
+ 	effect: the running process is charged up to now first, so its own
+ 		times are current
+*/
+int32_t sys_procstat(proc_info_t* buf, int32_t n){
+	int32_t pid, count = 0;
+
+	if(n <= 0){
+		return -1;
+	}
+	if(n > MAX_PROCESSES){
+		n = MAX_PROCESSES;
+	}
+	if(!user_range_ok(buf, n * sizeof(proc_info_t))){
+		return -1;
+	}
+	acct_charge();
+	for(pid = 0; pid < MAX_PROCESSES && count < n; pid++){
+		if(proc_arr[pid] == FREE){
+			continue;
+		}
+		pcb_t* pcb = get_pcb_loc(pid);
+		buf[count].pid = pid;
+		buf[count].parent_pid = pcb->parent_pid;
+		buf[count].term = pcb->term_number;
+		buf[count].reserved = 0;
+		memcpy(&buf[count].stat, &pcb->stat, sizeof(proc_stat_t));
+		count++;
+	}
+	return count;
+}
@@ -10,6 +10,15 @@
 #include "lib.h"
 #include "terminal.h"
 #include "rtc.h"
+#include "sysnum.h"
+#include "bcache.h"
+#include "clock.h"
+#include "timer.h"
+#include "prof.h"
+#include "trace.h"
+#include "irqstat.h"
+#include "acct.h"
+#include "bootprof.h"
 
 #define MAX_PROCESSES 6		// Total number of processes allowed.
 
@@ -35,6 +44,13 @@
 /* Other useful constants. */
 #define MAX_FILENAME_LENGTH  	32		// This is the longest that a filename can be.
 #define KB_BUF_SIZE_MAX			128
+#define MAX_IOV					16		// Most buffers readv/writev take in one call.
+#define MAX_BATCH				32		// Most descriptors sys_batch runs in one call.
+
+/* Values of whence for sys_lseek. */
+#define SEEK_SET	0
+#define SEEK_CUR	1
+#define SEEK_END	2
 
 enum process_flags{
 	FREE = 0,
@@ -59,8 +75,30 @@ typedef struct file_descriptor{
 	uint32_t inode;
 	uint32_t file_position;
 	uint32_t flags;
+	uint32_t ra_pos;		// Where a streaming read would continue.
+	uint32_t ra_block;		// First file block not read ahead yet.
+	uint32_t ra_window;		// Read-ahead size in blocks, 0 when not streaming.
+	uint32_t rtc_period;	// RTC interrupts per virtual tick of an RTC file.
+	uint32_t rtc_next;		// RTC interrupt count of its next virtual tick.
+	uint32_t read_timeout;	// Timer ticks a blocking read waits, 0 for no limit.
 } file_desc_t;
 
+/* One buffer of a readv/writev call. */
+typedef struct iovec{
+	void* base;
+	int32_t len;
+} iovec_t;
+
+/*
+ * One system call of a sys_batch call. The kernel fills in ret with what the
+ * call would have returned on its own.
+ */
+typedef struct syscall_desc{
+	int32_t num;
+	int32_t arg[4];
+	int32_t ret;
+} syscall_desc_t;
+
 /*
  * This struct represents a single PCB.
  */
@@ -76,6 +114,7 @@ typedef struct pcb{
 	uint8_t arg[KB_BUF_SIZE_MAX];
 	uint32_t arg_size;				// Holds the size of the arg including the NULL char.
 	uint8_t term_number;			// Holds the terminal number of the given process.
+	proc_stat_t stat;				// CPU time and I/O, see acct.h.
 } pcb_t;
 
 #ifndef ASM
@@ -91,8 +130,25 @@ int32_t* get_proc_arr();
 /* This is the assembly linkage for system calls from INT 0x80. */
 extern void syscall_linker();
 
+/* Assembly linkage for system calls made with SYSENTER. */
+extern void sysenter_linker();
+
+/* The system call jump table shared by both linkers (x86_desc.S). */
+typedef int32_t (*syscall_fn_t)(int32_t arg1, int32_t arg2, int32_t arg3, int32_t arg4);
+extern syscall_fn_t syscall_table[];
+
 int32_t sys_halt(uint8_t status);
 
+/* Halts the current process with a full-width status (used for exceptions). */
+int32_t halt_process(uint32_t status);
+
+/* Whether len bytes at ptr, or a string of at most max bytes at s, lie in the program page. */
+int32_t user_range_ok(const void* ptr, uint32_t len);
+int32_t user_string_ok(const uint8_t* s, uint32_t max);
+
+/* Halts a faulting program, or restarts a faulting base shell; never returns. */
+void kill_process(uint32_t status);
+
 int32_t sys_execute(const uint8_t* command);
 
 int32_t sys_read(int32_t fd, void* buf, int32_t nbytes);
@@ -110,5 +166,45 @@ int32_t sys_vidmap(uint8_t** screen_start);
 int32_t sys_set_handler(int32_t signum, void* handler_address);
 
 int32_t sys_sigreturn(void);
+
+int32_t sys_nop(void);
+
+int32_t sys_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+int32_t sys_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+int32_t sys_batch(syscall_desc_t* calls, int32_t count);
+
+int32_t sys_getdents(int32_t fd, void* buf, int32_t nbytes);
+
+int32_t sys_stat(const uint8_t* filename, stat_t* buf);
+
+int32_t sys_fstat(int32_t fd, stat_t* buf);
+
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence);
+
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+
+int32_t sys_create(const uint8_t* filename);
+
+int32_t sys_truncate(int32_t fd, int32_t length);
+
+int32_t sys_cachestat(bcache_stat_t* buf, int32_t flags);
+
+int32_t sys_clock_gettime(int32_t clock_id, timespec_t* ts);
+
+int32_t sys_clockmap(const clock_page_t** page);
+
+int32_t sys_nanosleep(const timespec_t* req);
+
+int32_t sys_set_timeout(int32_t fd, const timespec_t* timeout);
+
+int32_t sys_profile(int32_t cmd, void* buf, int32_t n);
+
+int32_t sys_trace(int32_t cmd);
+
+int32_t sys_irqstat(irqstat_t* buf, int32_t flags);
+
+int32_t sys_procstat(proc_info_t* buf, int32_t n);
 #endif		// ASM
 #endif		// SYSCALLS_H
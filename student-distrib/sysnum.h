@@ -0,0 +1,40 @@
+/* sysnum.h - System call numbers, shared by the C code and the assembly
+ * linkage in x86_desc.S. These must match syscalls/ece391sysnum.h.
+ */
+#ifndef _SYSNUM_H
+#define _SYSNUM_H
+
+#define SYS_HALT			1
+#define SYS_EXECUTE			2
+#define SYS_READ			3
+#define SYS_WRITE			4
+#define SYS_OPEN			5
+#define SYS_CLOSE			6
+#define SYS_GETARGS			7
+#define SYS_VIDMAP			8
+#define SYS_SET_HANDLER		9
+#define SYS_SIGRETURN		10
+#define SYS_NOP				11
+#define SYS_READV			12
+#define SYS_WRITEV			13
+#define SYS_BATCH			14
+#define SYS_GETDENTS		15
+#define SYS_STAT			16
+#define SYS_FSTAT			17
+#define SYS_LSEEK			18
+#define SYS_PREAD			19
+#define SYS_CREATE			20
+#define SYS_TRUNCATE		21
+#define SYS_CACHESTAT		22
+#define SYS_CLOCK_GETTIME	23
+#define SYS_CLOCKMAP		24
+#define SYS_NANOSLEEP		25
+#define SYS_SET_TIMEOUT		26
+#define SYS_PROFILE			27
+#define SYS_TRACE			28
+#define SYS_IRQSTAT			29
+#define SYS_PROCSTAT		30
+
+#define NUM_SYSCALLS		30		// Highest valid system call number.
+
+#endif /* _SYSNUM_H */
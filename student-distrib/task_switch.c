@@ -1,4 +1,6 @@
 #include "task_switch.h"
+#include "trace.h"
+#include "bootprof.h"
 
 /* Globals for shell setup. */
 uint8_t shells_running[NUM_TERMS] = {1, 0, 0};
@@ -8,6 +10,9 @@ uint8_t sched_arr_init = 0;
 sched_t sched_arr[NUM_TERMS];
 sched_t temp_sched;
 
+/* While nonzero, the PIT interrupt is acknowledged but no task switch happens. */
+volatile uint32_t preempt_count = 0;
+
 /*
  * This function will initialize the PIT to perform an interrupt every 10-50 ms.
  */
@@ -24,7 +29,29 @@ void init_pit(){
 	idt[idtPort].present = 0x1;					//Mark the interrupt as present.
 	
 	/* Tell the user it worked. */
-	puts("PIT initialized.\n");
+	if(!boot_fast){
+		puts("PIT initialized.\n");
+	}
+}
+
+/*
+ * Keeps the current process on the CPU until the matching preempt_enable.
+ * Used around work that must not be interleaved with another process but
+ * still needs interrupts, such as waiting for a disk request. Calls nest.
+ */
+void preempt_disable(){
+	uint32_t flags;
+	cli_and_save(flags);
+	preempt_count++;
+	restore_flags(flags);
+}
+
+/* Undoes one preempt_disable. */
+void preempt_enable(){
+	uint32_t flags;
+	cli_and_save(flags);
+	preempt_count--;
+	restore_flags(flags);
 }
 
 /*
@@ -32,22 +59,14 @@ void init_pit(){
  * scheduled.
  */
 int32_t get_next_proc(int32_t cur_term, int32_t* proc_arr){
-<<<<<<< HEAD
-	int32_t next_proc_num = (cur_term + 1) % MAX_PROCESSES;
-=======
 	int32_t next_proc_num = (cur_term + 1) % NUM_TERMS;
->>>>>>> f21547c05921ca98dc9045a0d0dceb879c0241b3
 
 	/* 
 	 * Check to see if the current terminal/shell has a child process. 
 	 */
 	int proc_it; // Generic iterator.
 	pcb_t* child_pcb = NULL;
-<<<<<<< HEAD
-	for(proc_it = next_proc_num; proc_it < MAX_PROCESSES; proc_it++){
-=======
 	for(proc_it = NUM_TERMS; proc_it < MAX_PROCESSES; proc_it++){ // Start at 3 since there are 3 shells.
->>>>>>> f21547c05921ca98dc9045a0d0dceb879c0241b3
 		if(proc_arr[proc_it] != FREE){
 			child_pcb = get_pcb_loc(proc_it);
 			if(child_pcb -> term_number == next_proc_num){
@@ -102,6 +121,12 @@ void run_shell(int32_t shell_num, uint8_t active_term){
  * of VGA mappings and stack pointers.
  */
 void pit_handler(){
+	/* Someone asked not to be switched out, so just acknowledge the tick. */
+	if(preempt_count){
+		send_eoi(0);
+		return;
+	}
+
 	/***** SAVE PROCESS STATE *****/
 	asm volatile(
 		"movl	%%ebp, %0;"
@@ -117,6 +142,10 @@ void pit_handler(){
 	int32_t* proc_arr = get_proc_arr();
 	int32_t curr_term = get_pcb_loc(proc_num) -> term_number;
 	int32_t next_proc_num = get_next_proc(curr_term, proc_arr);
+	TRACE_EVENT(TR_SWITCH, proc_num, next_proc_num);
+	if(next_proc_num != proc_num){
+		acct_switch();
+	}
 	// int32_t next_proc_num = proc_num;
 	
 	/* Go through all of the processes and see which one should be serviced next. */
@@ -28,4 +28,8 @@ void init_pit();
 
 /* Interrupt handler. */
 void pit_handler();
+
+/* Hold off and re-allow task switches from the PIT. These nest. */
+void preempt_disable();
+void preempt_enable();
 #endif
@@ -1,5 +1,6 @@
 /* This file contains functions pertaining to the terminal driver. */
 #include "terminal.h"
+#include "syscalls.h"
 
 /* 
  * This boolean is a testing variable that tells the read function to call the
@@ -168,12 +169,25 @@ int32_t terminal_close(){
 
 
 int32_t terminal_read(int32_t fd, const void* buf, int32_t num_bytes){		
-	/* Wait until the keyboard handler sends us a buffer. */
+	timer_t timeout = {NULL, NULL, 0, 0};
+
+	boot_mark(BOOT_PROMPT);		// Only the first read counts.
+
+	/* Kernel callers pass fd 0 and always wait. */
+	if(fd && ((file_desc_t*)fd)->read_timeout){
+		timer_add(&timeout, ((file_desc_t*)fd)->read_timeout);
+	}
+
+	/* Wait until the keyboard handler sends us a buffer, or give up at the timeout. */
 	while(1){
 		if(buf_sent && (cur_term_num == term_in_service)){
 			break;
 		}
+		if(timeout.fired){
+			return -1;
+		}
 	}	
+	timer_del(&timeout);
 
 	/* 	
 	 * Make sure that the user will not try to write MORE characters than are in
@@ -4,6 +4,15 @@
 #include "page.h"
 #include "file.h"
 #include "terminal.h"
+#include "ata.h"
+#include "virtio.h"
+#include "syscalls.h"
+#include "clock.h"
+#include "timer.h"
+#include "prof.h"
+#include "trace.h"
+#include "irqstat.h"
+#include "bootprof.h"
 
 #define PASS 1
 #define FAIL 0
@@ -176,6 +185,566 @@ void test_display_files()
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* ATA throughput
+ *
+ * Reads the first 4 MB of the disk sequentially in 64 kB requests, then 256
+ * random 4 kB blocks, once with PIO and once with DMA. Prints cycles per
+ * MB for each so the two modes can be compared.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves the driver in the mode it started in
+ * Files: ata.h/c
+ */
+int ata_throughput_test(){
+	TEST_HEADER;
+
+	static uint8_t buf[ATA_MAX_SECTORS * ATA_SECTOR_SIZE];
+	uint32_t seq_sectors = (4 * 1024 * 1024) / ATA_SECTOR_SIZE;
+	uint32_t rand_reads = 256;
+	uint32_t old_mode = ata_get_mode();
+	uint32_t mode, i, seed;
+	uint64_t start;
+
+	if(ata_sector_count() < seq_sectors){
+		return FAIL;
+	}
+	for(mode = ATA_MODE_PIO; mode <= ATA_MODE_DMA; mode++){
+		if(ata_set_mode(mode) == -1){
+			continue;
+		}
+		start = clock_tsc();
+		for(i = 0; i < seq_sectors; i += ATA_MAX_SECTORS){
+			if(ata_read(i, ATA_MAX_SECTORS, buf) == -1){
+				ata_set_mode(old_mode);
+				return FAIL;
+			}
+		}
+		printf("ata_%s_seq_cycles_per_mb %u\n", mode ? "dma" : "pio", (uint32_t)(clock_tsc() - start) / 4);
+
+		seed = 1;
+		start = clock_tsc();
+		for(i = 0; i < rand_reads; i++){
+			seed = seed * 1103515245 + 12345;
+			uint32_t lba = ((seed >> 8) % (ata_sector_count() / 8)) * 8;
+			if(ata_read(lba, 8, buf) == -1){
+				ata_set_mode(old_mode);
+				return FAIL;
+			}
+		}
+		printf("ata_%s_rand_cycles_per_mb %u\n", mode ? "dma" : "pio", (uint32_t)(clock_tsc() - start) / (rand_reads * 4096 / (1024 * 1024)));
+	}
+	ata_set_mode(old_mode);
+	return PASS;
+}
+
+/* virtio-blk throughput
+ *
+ * Same workload as ata_throughput_test, except that the random 4 kB reads
+ * are handed to the driver 16 at a time so each batch costs one queue
+ * notification and one interrupt.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: virtio.h/c
+ */
+int virtio_throughput_test(){
+	TEST_HEADER;
+
+	static uint8_t buf[16 * FOUR_KB];
+	blkdev_t* dev = &virtio_blk_dev;
+	blk_req_t reqs[16];
+	uint32_t seq_sectors = (4 * 1024 * 1024) / BLK_SECTOR_SIZE;
+	uint32_t i, j, seed;
+	uint64_t start;
+
+	if(dev->sectors < seq_sectors){
+		return FAIL;
+	}
+	start = clock_tsc();
+	for(i = 0; i < seq_sectors; i += dev->max_sectors){
+		if(dev->read(i, dev->max_sectors, buf) == -1){
+			return FAIL;
+		}
+	}
+	printf("virtio_seq_cycles_per_mb %u\n", (uint32_t)(clock_tsc() - start) / 4);
+
+	seed = 1;
+	start = clock_tsc();
+	for(i = 0; i < 256; i += 16){
+		for(j = 0; j < 16; j++){
+			seed = seed * 1103515245 + 12345;
+			reqs[j].lba = ((seed >> 8) % (dev->sectors / 8)) * 8;
+			reqs[j].count = 8;
+			reqs[j].buf = buf + j * FOUR_KB;
+		}
+		if(dev->submit(reqs, 16) == -1){
+			return FAIL;
+		}
+	}
+	printf("virtio_rand_cycles_per_mb %u\n", (uint32_t)(clock_tsc() - start));		// 256 x 4 kB is exactly 1 MB.
+	return PASS;
+}
+
+/* Large file read throughput
+ *
+ * Creates an 8 MB file (twice what an old-style inode can hold), which
+ * file_create makes an extent inode, and reads it back with read_data in
+ * 64 kB pieces, printing cycles per MB. Then reads the largest file of
+ * the image the same way for comparison with old-style inodes. Truncates
+ * the new file to 0 at the end.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves an empty "extent_test" file behind
+ * Files: file.h/c
+ */
+int extent_read_test(){
+	TEST_HEADER;
+
+	static uint8_t buf[16 * FOUR_KB];
+	file_desc_t file;
+	dentry_t dentry;
+	uint32_t size = 8 * 1024 * 1024;
+	uint32_t i, j, pass;
+	uint64_t start;
+
+	if(read_dentry_by_name((uint8_t*)"extent_test", &dentry) == -1 &&
+	   (file_create((uint8_t*)"extent_test") == -1 || read_dentry_by_name((uint8_t*)"extent_test", &dentry) == -1)){
+		return FAIL;
+	}
+	memset(&file, 0, sizeof(file));
+	file.inode = dentry.inode_num;
+	for(i = 0; i < size; i += sizeof(buf)){
+		for(j = 0; j < sizeof(buf); j += 4){
+			*(uint32_t*)(buf + j) = i + j;
+		}
+		if(fwrite((int32_t)&file, buf, sizeof(buf)) != sizeof(buf)){
+			file_truncate(dentry.inode_num, 0);
+			return FAIL;
+		}
+	}
+
+	start = clock_tsc();
+	for(i = 0; i < size; i += sizeof(buf)){
+		if(read_data(dentry.inode_num, i, buf, sizeof(buf)) != sizeof(buf) || *(uint32_t*)(buf + 4) != i + 4){
+			file_truncate(dentry.inode_num, 0);
+			return FAIL;
+		}
+	}
+	printf("extent_read_cycles_per_mb %u\n", (uint32_t)(clock_tsc() - start) / 8);
+	file_truncate(dentry.inode_num, 0);
+
+	/* The biggest file in the image, read until 8 MB have been copied. */
+	uint32_t best = 0, best_len = 0;
+	for(i = 0; read_dentry_by_index(i, &dentry) == 0; i++){
+		int32_t len = get_file_length(&dentry);
+		if(len > (int32_t)best_len){
+			best = dentry.inode_num;
+			best_len = len;
+		}
+	}
+	if(best_len == 0){
+		return PASS;
+	}
+	uint32_t copied = 0;
+	start = clock_tsc();
+	for(pass = 0; copied < size; pass++){
+		for(i = 0; i < best_len && copied < size; i += sizeof(buf)){
+			int32_t got = read_data(best, i, buf, sizeof(buf));
+			if(got <= 0){
+				return FAIL;
+			}
+			copied += got;
+		}
+	}
+	printf("image_largest_read_cycles_per_mb %u\n", (uint32_t)(clock_tsc() - start) / 8);
+	return PASS;
+}
+
+/* Returns 1 if the n bytes at a and b are equal. */
+static int32_t same_bytes(const uint8_t* a, const uint8_t* b, int32_t n){
+	while(n-- > 0){
+		if(*a++ != *b++){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Open inode handles
+ *
+ * Opens every regular file through a handle and checks that the handle's
+ * length, reads and (in a RAM image) mapped blocks agree with read_data.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: file.h/c
+ */
+int file_handle_test(){
+	TEST_HEADER;
+
+	static uint8_t want[FOUR_KB], got[FOUR_KB];
+	file_handle_t handle;
+	dentry_t dentry;
+	uint8_t* data;
+	uint32_t i;
+
+	for(i = 0; read_dentry_by_index(i, &dentry) == 0; i++){
+		if(dentry.file_type != TYPE_FILE || dentry.fname[MAX_NAME_LEN - 1] != '\0'){
+			continue;		// A 32 character name has no terminator to look it up by.
+		}
+		if(file_handle_open((uint8_t*)dentry.fname, &handle) != 0){
+			return FAIL;
+		}
+		int32_t len = read_data(dentry.inode_num, 0, want, FOUR_KB);
+		if(handle.inode != dentry.inode_num || handle.length != get_file_length(&dentry) ||
+		   file_handle_read(&handle, 0, got, FOUR_KB) != len || !same_bytes(want, got, len)){
+			file_handle_close(&handle);
+			return FAIL;
+		}
+		if(len > 0 && file_handle_map(&handle, 0, &data) > 0 && !same_bytes(want, data, len)){
+			file_handle_close(&handle);
+			return FAIL;
+		}
+		file_handle_close(&handle);
+	}
+	return PASS;
+}
+
+/* Kernel clock
+ *
+ * Reads the clock many times and checks that it never goes back, that
+ * the clock page a user program would read agrees with it, and that
+ * clock_gettime rejects a buffer outside the program page. Prints the
+ * calibrated TSC rate.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: clock.h/c
+ */
+int clock_test(){
+	TEST_HEADER;
+
+	const clock_page_t* page = (const clock_page_t*)CLOCK_PAGE_ADDR;
+	timespec_t ts;
+	uint64_t prev = clock_ns();
+	uint32_t i;
+
+	for(i = 0; i < 10000; i++){
+		uint64_t now = clock_ns();
+		if(now < prev){
+			return FAIL;
+		}
+		prev = now;
+	}
+	if(page->tsc_khz != clock_tsc_khz() || page->shift != CLOCK_SHIFT ||
+	   sys_clock_gettime(CLOCK_MONOTONIC, &ts) != -1){	// Not a user pointer.
+		return FAIL;
+	}
+	clock_ns_to_timespec(clock_ns(), &ts);
+	if(ts.tv_nsec >= NS_PER_SEC){
+		return FAIL;
+	}
+	printf("tsc_khz %u\n", clock_tsc_khz());
+	return PASS;
+}
+
+/* Virtual RTC rates
+ *
+ * Runs two RTC files at 8 Hz and 32 Hz side by side, reading the faster
+ * one and checking the slower one's ticks as they come due. Each should
+ * take half a second (within 5%) for 4 and 16 ticks respectively.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: rtc.h/c, clock.h/c
+ */
+int rtc_virtual_test(){
+	TEST_HEADER;
+
+	file_desc_t slow, fast;
+	int32_t slow_freq = 8, fast_freq = 32;
+	uint32_t i, slow_reads = 0;
+	uint64_t slow_done = 0;
+
+	memset(&slow, 0, sizeof(slow));
+	memset(&fast, 0, sizeof(fast));
+	if(rtc_write((int32_t)&slow, &slow_freq, 4) != 0 || rtc_write((int32_t)&fast, &fast_freq, 4) != 0){
+		return FAIL;
+	}
+	uint64_t start = clock_ns();
+	for(i = 0; i < 16; i++){
+		rtc_read((int32_t)&fast, NULL, 0);
+		if(i % 4 == 3){
+			rtc_read((int32_t)&slow, NULL, 0);		// Due at the same moment, so it returns at once.
+			slow_reads++;
+			slow_done = clock_ns();
+		}
+	}
+	uint32_t fast_ms = (uint32_t)(clock_ns() - start) / 1000000;		// Well under 4 s, so 32 bits of ns do.
+	uint32_t slow_ms = (uint32_t)(slow_done - start) / 1000000;
+	printf("rtc 32 Hz x16 %u ms, 8 Hz x%u %u ms\n", fast_ms, slow_reads, slow_ms);
+	if(fast_ms < 475 || fast_ms > 525 || slow_ms < 475 || slow_ms > 525){
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* Timer wheel sleeps and timeouts
+ *
+ * Sleeps 100 ms on the timer wheel, then reads a 2 Hz RTC file with a
+ * 50 ms read timeout, which must give up long before the tick is due.
+ * Also checks that a cancelled timer never fires.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Files: timer.h/c, rtc.h/c, syscalls.c
+ */
+int timer_test(){
+	TEST_HEADER;
+
+	timespec_t req = {0, 100000000};
+	timespec_t limit = {0, 50000000};
+	timespec_t bad = {0, NS_PER_SEC};
+	file_desc_t rtc;
+	int32_t freq = 2;
+	timer_t cancelled;
+
+	uint64_t start = clock_ns();
+	if(sys_nanosleep(&req) != -1 || timer_ticks(&bad) != -1){	// &req is not a user pointer.
+		return FAIL;
+	}
+	timer_sleep(timer_ticks(&req));
+	uint32_t sleep_us = (uint32_t)(clock_ns() - start) / 1000;
+
+	timer_add(&cancelled, 5);
+	if(timer_del(&cancelled) != 1){
+		return FAIL;
+	}
+	memset(&rtc, 0, sizeof(rtc));
+	rtc.read_timeout = timer_ticks(&limit);
+	rtc_write((int32_t)&rtc, &freq, 4);
+	start = clock_ns();
+	if(rtc_read((int32_t)&rtc, NULL, 0) != -1){
+		return FAIL;
+	}
+	uint32_t timeout_us = (uint32_t)(clock_ns() - start) / 1000;
+	printf("sleep 100 ms took %u us, 50 ms timeout took %u us\n", sleep_us, timeout_us);
+	if(cancelled.fired || sleep_us < 100000 || sleep_us > 102000 || timeout_us < 50000 || timeout_us > 52000){
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* Sampling profiler
+ *
+ * Profiles 100 ms of a kernel busy loop. There should be one sample per
+ * RTC tick, all of them in ring 0.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Replaces any profile being taken
+ * Files: prof.h/c, rtc.c
+ */
+static prof_entry_t prof_buf[PROF_HASH_SIZE];
+int prof_test(){
+	TEST_HEADER;
+
+	int32_t i, n;
+	uint32_t total = 0, best = 0;
+	uint64_t end = clock_ns() + 100000000;
+
+	prof_ctl(PROF_START, NULL, 0);
+	while(clock_ns() < end);
+	prof_ctl(PROF_STOP, NULL, 0);
+	n = prof_ctl(PROF_READ, prof_buf, PROF_HASH_SIZE);
+	for(i = 0; i < n; i++){
+		if(prof_buf[i].cpl != 0){
+			return FAIL;
+		}
+		total += prof_buf[i].count;
+		if(prof_buf[i].count > prof_buf[best].count){
+			best = i;
+		}
+	}
+	printf("%u samples in %d buckets, hottest 0x%x\n", total, n, prof_buf[best].eip);
+	if(total < 100 || total > 104 || n == 0){
+		return FAIL;
+	}
+	return PASS;
+}
+
+#ifdef TRACE
+/* Trace recording
+ *
+ * Sleeps 10 ms so the RTC records its IRQ events, checks that they come
+ * out in time order, then times the recording itself, which should stay
+ * well under 100 cycles per event. Needs a kernel built with -DTRACE.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Clears the trace
+ * Files: trace.h/c, x86_desc.S
+ */
+int trace_test(){
+	TEST_HEADER;
+
+	timespec_t req = {0, 10000000};
+	trace_ring_t* irq = &trace_rings[TR_IRQ];
+	uint32_t i, rtc = 0;
+
+	trace_ctl(TRACE_CLEAR);
+	timer_sleep(timer_ticks(&req));
+	for(i = 0; i < irq->head && i < TRACE_RING_SIZE; i++){
+		if(irq->entries[i].a == 8){
+			rtc++;
+		}
+		if(i > 0 && irq->entries[i].tsc_hi == irq->entries[i - 1].tsc_hi &&
+		   irq->entries[i].tsc_lo < irq->entries[i - 1].tsc_lo){
+			return FAIL;
+		}
+	}
+
+	uint64_t start = clock_tsc();
+	for(i = 0; i < 1000; i++){
+		trace_event(TR_HALT, i, 0);
+	}
+	uint32_t cycles = (uint32_t)(clock_tsc() - start) / 1000;
+	trace_ctl(TRACE_CLEAR);
+	printf("%u RTC interrupts in 10 ms, %u cycles per event\n", rtc, cycles);
+	if(rtc < 10 || rtc > 12 || cycles >= 100){
+		return FAIL;
+	}
+	return PASS;
+}
+#endif
+
+/* Interrupt latency statistics
+ *
+ * Sleeps 10 ms so the RTC handler is timed about ten times, then holds
+ * interrupts off for about 100000 cycles, which should become the longest
+ * window, blamed on this file.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Resets the statistics
+ * Files: irqstat.h/c, lib.h, x86_desc.S
+ */
+static irqstat_t irqstat_buf;
+int irqstat_test(){
+	TEST_HEADER;
+
+	timespec_t req = {0, 10000000};
+	uint32_t flags;
+	uint64_t end;
+
+	irqstat_get(NULL, IRQSTAT_RESET);
+	timer_sleep(timer_ticks(&req));
+	cli_and_save(flags);
+	end = clock_tsc() + 100000;
+	while(clock_tsc() < end);
+	restore_flags(flags);
+	irqstat_get(&irqstat_buf, IRQSTAT_RESET);
+
+	printf("%u RTC interrupts, longest %u cycles; longest off %u cycles at %s\n",
+		irqstat_buf.handler[8].count, irqstat_buf.handler[8].max,
+		irqstat_buf.irqoff.max, irqstat_buf.irqoff_site);
+	if(irqstat_buf.handler[8].count < 10 || irqstat_buf.handler[8].count > 12 ||
+	   irqstat_buf.irqoff.max < 100000 || strncmp(irqstat_buf.irqoff_site, "tests.c:", 8) != 0){
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* Process accounting
+ *
+ * The tests run on the boot stack, where no process is charged. Starting
+ * two processes' statistics should zero them, copy the name and hand out
+ * consecutive serial numbers.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Uses up two serial numbers
+ * Files: acct.h/c
+ */
+int acct_test(){
+	TEST_HEADER;
+
+	proc_stat_t a, b;
+
+	memset(&a, 0xFF, sizeof(a));
+	acct_exec(&a, (uint8_t*)"counter");
+	acct_exec(&b, (uint8_t*)"a_name_longer_than_the_thirty_one_bytes_kept");
+	if(acct_current() != NULL || a.user_cycles != 0 || a.in_kernel != 0 || a.asleep != 0){
+		return FAIL;
+	}
+	if(strncmp((int8_t*)a.name, "counter", ACCT_NAME_LEN) != 0 || b.name[ACCT_NAME_LEN - 1] != '\0'){
+		return FAIL;
+	}
+	if(b.serial != a.serial + 1){
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* Boot profile
+ *
+ * By the time the tests run entry() has marked every phase through the
+ * terminal, in order. The command line must name fastboot as a whole word.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: boot_mark, boot_cycles, boot_parse_cmdline
+ * Files: bootprof.c/h
+ */
+int bootprof_test(){
+	TEST_HEADER;
+
+	uint32_t saved = boot_fast;
+	uint32_t i, words, partial;
+
+	for(i = BOOT_MULTIBOOT; i <= BOOT_TERMINAL; i++){
+		if(boot_cycles(i) == 0 || boot_cycles(i) < boot_cycles(i - 1)){
+			return FAIL;
+		}
+	}
+	printf("%u cycles from entry to the terminal\n", (uint32_t)boot_cycles(BOOT_TERMINAL));
+
+	boot_fast = 0;
+	boot_parse_cmdline("root=hd0 fastbootx nofastboot");
+	partial = boot_fast;
+	boot_parse_cmdline("  quiet fastboot");
+	words = boot_fast;
+	boot_fast = saved;
+	if(partial != 0 || words != 1){
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* User pointer checks
+ *
+ * Only ranges wholly inside the program page pass; kernel addresses, NULL
+ * and ranges running off the end of the page do not.
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: user_range_ok, user_string_ok
+ * Files: syscalls.c
+ */
+int user_range_test(){
+	TEST_HEADER;
+
+	uint8_t name[] = "frame0.txt";
+
+	if(!user_range_ok((void*)OTE_MB, FOUR_MB) || !user_range_ok((void*)(OTE_MB + FOUR_MB - 4), 4)){
+		return FAIL;
+	}
+	if(user_range_ok(NULL, 1) || user_range_ok((void*)(OTE_MB - 1), 2) ||
+	   user_range_ok((void*)(OTE_MB + FOUR_MB - 4), 5) || user_range_ok((void*)(OTE_MB + 4), 0xFFFFFFFF)){
+		return FAIL;
+	}
+	if(user_string_ok(name, sizeof(name)) || user_string_ok((uint8_t*)(OTE_MB + FOUR_MB), 2)){
+		return FAIL;
+	}
+	return PASS;
+}
+
 
 /* Test suite entry point */
 void launch_tests(){
@@ -202,6 +771,25 @@ void launch_tests(){
 	/* Paging Tests */
 	//TEST_OUTPUT("paging_test", paging_test());
 	
+	/* Disk tests */
+	//TEST_OUTPUT("ata_throughput_test", ata_throughput_test());
+	//TEST_OUTPUT("virtio_throughput_test", virtio_throughput_test());
+	
+	/* Filesystem tests */
+	//TEST_OUTPUT("extent_read_test", extent_read_test());
+	//TEST_OUTPUT("file_handle_test", file_handle_test());
+	//TEST_OUTPUT("clock_test", clock_test());
+	//TEST_OUTPUT("rtc_virtual_test", rtc_virtual_test());
+	//TEST_OUTPUT("timer_test", timer_test());
+	//TEST_OUTPUT("prof_test", prof_test());
+	//TEST_OUTPUT("trace_test", trace_test());		// Needs -DTRACE.
+	//TEST_OUTPUT("irqstat_test", irqstat_test());
+	//TEST_OUTPUT("acct_test", acct_test());
+	//TEST_OUTPUT("bootprof_test", bootprof_test());
+	
+	/* System call tests */
+	//TEST_OUTPUT("user_range_test", user_range_test());
+	
 	/***** TESTS FOR EXCEPTIONS *****/
 	/* Divide by 0 test: */
 	//int wow = 10 / 0;
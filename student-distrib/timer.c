@@ -0,0 +1,183 @@
+/*
+ * This file will contain the timer wheel.
+ *
+ * The wheel has TIMER_LEVELS levels of TIMER_SLOTS slots. A timer due
+ * within TIMER_SLOTS ticks goes straight into the level 0 slot of its
+ * tick; one further out goes into a coarser level, where each slot covers
+ * TIMER_SLOTS times as many ticks as a slot of the level below. Every tick
+ * fires the whole level 0 slot it lands on, and each time level 0 wraps
+ * the next level's current slot is emptied back into the wheel a level
+ * lower. Adding, removing and firing a timer are all constant time, and a
+ * timer is moved at most TIMER_LEVELS - 1 times, so a tick costs the same
+ * however many timers are pending.
+ *
+ * The wheel is ticked from the RTC interrupt, which runs at RTC_MAX_FREQ
+ * all the time. The PIT only runs at its 18.2 Hz default and drives the
+ * scheduler, so it would make every sleep a multiple of 55 ms.
+ */
+#include "timer.h"
+#include "lib.h"
+#include "acct.h"
+
+#define NS_PER_TICK_X2		(2 * NS_PER_SEC / TIMER_HZ)		// 1953125, exact at 1024 Hz.
+
+/* Each slot is a circular list through a sentinel, so unlinking needs no search. */
+static timer_t wheel[TIMER_LEVELS][TIMER_SLOTS];
+static uint32_t wheel_now = 0;			// The next tick to be processed.
+
+/* void timer_init()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: makes every slot an empty list */
+void timer_init(){
+	uint32_t level, slot;
+
+	for(level = 0; level < TIMER_LEVELS; level++){
+		for(slot = 0; slot < TIMER_SLOTS; slot++){
+			wheel[level][slot].next = &wheel[level][slot];
+			wheel[level][slot].prev = &wheel[level][slot];
+		}
+	}
+	wheel_now = 0;
+}
+
+/* void place(timer_t* t)
+ * Inputs:      timer_t* t = timer with expires set, not on any list
+ * Return Value: NONE
+ * Function: links t into the finest level whose span still reaches its
+ * tick. Must be called with interrupts disabled. */
+static void place(timer_t* t){
+	uint32_t delta = t->expires - wheel_now;
+	uint32_t level = 0;
+	timer_t* head;
+
+	if((int32_t)delta < 0){
+		delta = 0;
+		t->expires = wheel_now;			// Overdue after a cascade: fire on the next tick.
+	}
+	while(level < TIMER_LEVELS - 1 && delta >= (1U << (TIMER_LEVEL_BITS * (level + 1)))){
+		level++;
+	}
+	head = &wheel[level][(t->expires >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1)];
+	t->next = head;
+	t->prev = head->prev;
+	head->prev->next = t;
+	head->prev = t;
+}
+
+/* void unlink(timer_t* t)
+ * Inputs:      timer_t* t = pending timer
+ * Return Value: NONE
+ * Function: takes t off its slot list */
+static void unlink(timer_t* t){
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->next = NULL;
+	t->prev = NULL;
+}
+
+/* void cascade(uint32_t level)
+ * Inputs:      uint32_t level = level whose current slot is due to be spread out
+ * Return Value: NONE
+ * Function: re-places every timer of the slot, each now lands a level lower */
+static void cascade(uint32_t level){
+	timer_t* head = &wheel[level][(wheel_now >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1)];
+
+	while(head->next != head){
+		timer_t* t = head->next;
+		unlink(t);
+		place(t);
+	}
+}
+
+/* void timer_tick()
+ * Inputs:      NONE
+ * Return Value: NONE
+ * Function: fires the timers due on this tick. Runs in the RTC interrupt. */
+void timer_tick(){
+	uint32_t level = 1;
+	timer_t* head = &wheel[0][wheel_now & (TIMER_SLOTS - 1)];
+
+	/* Level 0 wrapped: pull the next stretch of ticks down from above. */
+	while(level < TIMER_LEVELS && (wheel_now & ((1U << (TIMER_LEVEL_BITS * level)) - 1)) == 0){
+		cascade(level);
+		level++;
+	}
+	while(head->next != head){
+		timer_t* t = head->next;
+		unlink(t);
+		t->fired = 1;
+	}
+	wheel_now++;
+}
+
+/* void timer_add(timer_t* t, uint32_t ticks)
+ * Inputs:      timer_t* t = timer to arm, must not be pending
+ *              uint32_t ticks = full ticks to wait, at most TIMER_MAX_TICKS
+ * Return Value: NONE
+ * Function: the next tick to be processed is less than one tick away, so
+ * counting from it waits at least ticks whole ticks */
+void timer_add(timer_t* t, uint32_t ticks){
+	uint32_t flags;
+
+	if(ticks > TIMER_MAX_TICKS){
+		ticks = TIMER_MAX_TICKS;
+	}
+	cli_and_save(flags);
+	t->fired = 0;
+	t->expires = wheel_now + ticks;
+	place(t);
+	restore_flags(flags);
+}
+
+/* int32_t timer_del(timer_t* t)
+ * Inputs:      timer_t* t = timer armed by timer_add
+ * Return Value: 1 if it was still pending, 0 if it had fired
+ * Function: must be called before a timer on the stack goes out of scope */
+int32_t timer_del(timer_t* t){
+	uint32_t flags;
+	int32_t pending;
+
+	cli_and_save(flags);
+	pending = (t->next != NULL);
+	if(pending){
+		unlink(t);
+	}
+	restore_flags(flags);
+	return pending;
+}
+
+/* int32_t timer_ticks(const timespec_t* ts)
+ * Inputs:      const timespec_t* ts = a duration
+ * Return Value: wheel ticks, rounded up, -1 if ts is negative or tv_nsec
+ *               is out of range
+ * Function: a tick is 1953125 / 2 ns, so the nanoseconds convert in 32 bits */
+int32_t timer_ticks(const timespec_t* ts){
+	if(ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= NS_PER_SEC){
+		return -1;
+	}
+	if(ts->tv_sec >= 0x7FFFFFFF / TIMER_HZ){
+		return 0x7FFFFFFF;				// Over three weeks; close enough to forever.
+	}
+	return ts->tv_sec * TIMER_HZ + ((uint32_t)ts->tv_nsec * 2 + NS_PER_TICK_X2 - 1) / NS_PER_TICK_X2;
+}
+
+/* void timer_sleep(uint32_t ticks)
+ * Inputs:      uint32_t ticks = ticks to wait
+ * Return Value: NONE
+ * Function: halts until an interrupt between checks. The wheel only moves
+ * while interrupts are enabled, so the caller must not have them off. */
+void timer_sleep(uint32_t ticks){
+	timer_t t;
+
+	acct_sleep(1);
+	while(ticks > 0){
+		uint32_t part = (ticks > TIMER_MAX_TICKS) ? TIMER_MAX_TICKS : ticks;
+		timer_add(&t, part);
+		while(!t.fired){
+			asm volatile("hlt");
+		}
+		ticks -= part;
+	}
+	acct_sleep(0);
+}
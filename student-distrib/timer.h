@@ -0,0 +1,47 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+/* Hierarchical timer wheel for sleeps and timeouts, ticked by the RTC interrupt. */
+#include "types.h"
+#include "clock.h"
+#include "rtc.h"
+
+#define TIMER_HZ			RTC_MAX_FREQ	// One wheel tick per RTC interrupt.
+#define TIMER_LEVEL_BITS	6
+#define TIMER_SLOTS			(1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVELS		4
+#define TIMER_MAX_TICKS		((1 << (TIMER_LEVEL_BITS * TIMER_LEVELS)) - 1)	// About 4.5 hours.
+
+#ifndef ASM
+/*
+ * A pending timer sits on one slot list of the wheel. Timers live wherever
+ * their owner keeps them, usually its kernel stack, so there is nothing to
+ * allocate. fired is set from the RTC interrupt once the timer expires.
+ */
+typedef struct timer{
+	struct timer* next;					// NULL when not pending.
+	struct timer* prev;
+	uint32_t expires;					// Wheel tick it fires on.
+	volatile uint32_t fired;
+} timer_t;
+
+/* Empties the wheel. Call before the RTC interrupt is enabled. */
+void timer_init();
+
+/* Advances the wheel by one tick and fires what is due. Called by the RTC handler. */
+void timer_tick();
+
+/* Arms t to fire after at least ticks full wheel ticks (capped at TIMER_MAX_TICKS). */
+void timer_add(timer_t* t, uint32_t ticks);
+
+/* Disarms t if it is still pending. Returns 1 if it was, 0 if it already fired or was zeroed and never armed. */
+int32_t timer_del(timer_t* t);
+
+/* Wheel ticks covering ts, rounded up. -1 if ts is not a valid duration. */
+int32_t timer_ticks(const timespec_t* ts);
+
+/* Waits for at least ticks wheel ticks with interrupts enabled. */
+void timer_sleep(uint32_t ticks);
+#endif		// ASM
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * This file will contain the kernel event trace.
+ *
+ * Each event type has its own ring of TSC-stamped records, written by
+ * trace_event in trace.h. Recording never stops, so after a latency spike
+ * the rings still hold what happened just before it; TRACE_DUMP merges
+ * them by timestamp and writes the result to COM1.
+ */
+#include "trace.h"
+#include "lib.h"
+#include "clock.h"
+#include "serial.h"
+#include "syscalls.h"
+
+#ifdef TRACE
+trace_ring_t trace_rings[TRACE_NUM_TYPES];
+volatile uint32_t trace_paused = 0;
+
+static int8_t* trace_names[TRACE_NUM_TYPES] = {
+	"syscall", "sysret", "switch", "irq", "irqret", "pagefault", "execute", "halt"
+};
+
+/* void trace_syscall_enter(uint32_t num)
+ * Inputs:      uint32_t num = system call number
+ * Return Value: NONE
+ * Function: the linkers only have the number at hand, so the pid is found here */
+void trace_syscall_enter(uint32_t num){
+	trace_event(TR_SYSCALL, num, get_process_number());
+}
+
+/* void trace_syscall_exit(int32_t ret)
+ * Inputs:      int32_t ret = what the call returns
+ * Return Value: NONE */
+void trace_syscall_exit(int32_t ret){
+	trace_event(TR_SYSRET, ret, get_process_number());
+}
+
+/* void put_padded(uint32_t value, uint32_t digits)
+ * Inputs:      uint32_t value = number to send in decimal
+ *              uint32_t digits = width, zero filled
+ * Return Value: NONE */
+static void put_padded(uint32_t value, uint32_t digits){
+	int8_t buf[12];
+	uint32_t len = strlen(itoa(value, buf, 10));
+
+	for(; len < digits; len++){
+		serial_putc('0');
+	}
+	serial_puts(buf);
+}
+
+/* uint32_t dump()
+ * Inputs:      NONE
+ * Return Value: events written
+ * Function: repeatedly takes the oldest unwritten event across all rings.
+ * One line per event: seconds.microseconds since boot, type, a, b. */
+static uint32_t dump(){
+	uint32_t next[TRACE_NUM_TYPES];
+	uint32_t type, written = 0;
+	timespec_t ts;
+
+	for(type = 0; type < TRACE_NUM_TYPES; type++){
+		uint32_t head = trace_rings[type].head;
+		next[type] = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+	}
+	serial_puts("trace-begin\n");
+	while(1){
+		trace_entry_t* oldest = NULL;
+		uint32_t oldest_type = 0;
+
+		for(type = 0; type < TRACE_NUM_TYPES; type++){
+			if(next[type] == trace_rings[type].head){
+				continue;
+			}
+			trace_entry_t* e = &trace_rings[type].entries[next[type] & (TRACE_RING_SIZE - 1)];
+			if(oldest == NULL || e->tsc_hi < oldest->tsc_hi ||
+			   (e->tsc_hi == oldest->tsc_hi && e->tsc_lo < oldest->tsc_lo)){
+				oldest = e;
+				oldest_type = type;
+			}
+		}
+		if(oldest == NULL){
+			break;
+		}
+		next[oldest_type]++;
+
+		clock_ns_to_timespec(clock_tsc_to_ns(((uint64_t)oldest->tsc_hi << 32) | oldest->tsc_lo), &ts);
+		serial_putu(ts.tv_sec, 10);
+		serial_putc('.');
+		put_padded(ts.tv_nsec / 1000, 6);
+		serial_putc(' ');
+		serial_puts(trace_names[oldest_type]);
+		serial_putc(' ');
+		serial_putu(oldest->a, (oldest_type == TR_PAGE_FAULT) ? 16 : 10);
+		serial_putc(' ');
+		serial_putu(oldest->b, (oldest_type == TR_PAGE_FAULT) ? 16 : 10);
+		serial_putc('\n');
+		written++;
+	}
+	serial_puts("trace-end\n");
+	return written;
+}
+
+/* int32_t trace_ctl(int32_t cmd)
+ * Inputs:      int32_t cmd = TRACE_DUMP or TRACE_CLEAR
+ * Return Value: events dumped, 0 for TRACE_CLEAR, -1 on a bad command
+ * Function: recording is paused while the rings are read or emptied */
+int32_t trace_ctl(int32_t cmd){
+	uint32_t type;
+	int32_t ret = 0;
+
+	trace_paused = 1;
+	if(cmd == TRACE_DUMP){
+		ret = dump();
+	}
+	else if(cmd == TRACE_CLEAR){
+		for(type = 0; type < TRACE_NUM_TYPES; type++){
+			trace_rings[type].head = 0;
+		}
+	}
+	else{
+		ret = -1;
+	}
+	trace_paused = 0;
+	return ret;
+}
+#else
+/* int32_t trace_ctl(int32_t cmd)
+ * Inputs:      int32_t cmd = ignored
+ * Return Value: -1, nothing is recorded without TRACE */
+int32_t trace_ctl(int32_t cmd){
+	return -1;
+}
+#endif		// TRACE
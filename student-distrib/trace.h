@@ -0,0 +1,80 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/*
+ * Kernel event trace. Build with -DTRACE (see the Makefile) to record;
+ * without it every trace point compiles to nothing.
+ */
+#include "types.h"
+
+#define TRACE_RING_SIZE		1024		// Events kept per type (power of 2).
+
+/* Event types, one ring each, so a flood of interrupts cannot push out rare events. */
+#define TR_SYSCALL			0			// a = call number, b = pid
+#define TR_SYSRET			1			// a = return value, b = pid
+#define TR_SWITCH			2			// a = pid switched from, b = pid switched to
+#define TR_IRQ				3			// a = IRQ line
+#define TR_IRQRET			4			// a = IRQ line
+#define TR_PAGE_FAULT		5			// a = eip, b = cr2
+#define TR_EXECUTE			6			// a = new pid, b = parent pid
+#define TR_HALT				7			// a = pid, b = status
+#define TRACE_NUM_TYPES		8
+
+/* sys_trace commands. */
+#define TRACE_DUMP			0			// Write every event held to COM1, oldest first.
+#define TRACE_CLEAR			1
+
+#ifndef ASM
+typedef struct trace_entry{
+	uint32_t tsc_lo;
+	uint32_t tsc_hi;
+	uint32_t a;
+	uint32_t b;
+} trace_entry_t;
+
+typedef struct trace_ring{
+	uint32_t head;						// Events ever recorded; the next goes at head % TRACE_RING_SIZE.
+	trace_entry_t entries[TRACE_RING_SIZE];
+} trace_ring_t;
+
+/* TRACE_DUMP or TRACE_CLEAR. Returns events dumped (0 for TRACE_CLEAR), -1 if built without TRACE. */
+int32_t trace_ctl(int32_t cmd);
+
+#ifdef TRACE
+extern trace_ring_t trace_rings[TRACE_NUM_TYPES];
+extern volatile uint32_t trace_paused;
+
+/*
+ * Claims a slot with one xadd, which an interrupt cannot split, so
+ * interrupt handlers and the code they interrupt never share a slot and
+ * no lock is needed. Forced inline because the kernel is built without
+ * -O; what is left is mostly the rdtsc.
+ */
+static inline __attribute__((always_inline)) void trace_event(uint32_t type, uint32_t a, uint32_t b){
+	trace_ring_t* r = &trace_rings[type];
+	uint32_t slot = 1;
+	uint32_t lo, hi;
+
+	if(trace_paused){
+		return;
+	}
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	asm volatile("xaddl %0, %1" : "+r"(slot), "+m"(r->head));
+	trace_entry_t* e = &r->entries[slot & (TRACE_RING_SIZE - 1)];
+	e->tsc_lo = lo;
+	e->tsc_hi = hi;
+	e->a = a;
+	e->b = b;
+}
+
+#define TRACE_EVENT(type, a, b)		trace_event((type), (uint32_t)(a), (uint32_t)(b))
+
+/* Called from the linkers in x86_desc.S. */
+void trace_syscall_enter(uint32_t num);
+void trace_syscall_exit(int32_t ret);
+#else
+#define TRACE_EVENT(type, a, b)		do{}while(0)
+#endif		// TRACE
+#endif		// ASM
+
+#endif
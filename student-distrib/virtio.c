@@ -0,0 +1,240 @@
+/*
+ * This file will contain all functions relating to the virtio-blk driver.
+ *
+ * The device has a single virtqueue. A batch of requests is laid out as
+ * header/data/status descriptor chains, published in the available ring
+ * and announced with one write to the notify register; the device then
+ * works through all of them and raises one interrupt for the lot. Like
+ * the ATA driver, only one batch is in flight at a time and preemption is
+ * held off until it has completed, so every batch starts on descriptor 0.
+ */
+#include "virtio.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "i8259.h"
+#include "task_switch.h"
+#include "pci.h"
+#include "bootprof.h"
+
+#define VIRTIO_POLL_LIMIT	10000000	// Used ring checks before we give up on the device.
+#define VIRTIO_HLT_LIMIT	10000		// Wakeups to wait for the interrupt before polling.
+
+static uint32_t io_base = 0;			// BAR0, 0 until a device has been set up.
+uint32_t virtio_irq_line = 0;			// Read by virtio_linker.
+static uint32_t queue_size = 0;
+static uint32_t max_batch = 0;
+static uint16_t last_used = 0;			// Used ring entries we have already consumed.
+
+/*
+ * Descriptors, the available ring and the used ring all live in this
+ * buffer. The kernel's 4 MB page is identity mapped, so its address is
+ * also the physical address the device wants.
+ */
+static uint8_t vq_mem[3 * VIRTIO_ALIGN] __attribute__((aligned(VIRTIO_ALIGN)));
+static vring_desc_t* desc;
+static vring_avail_t* avail;
+static volatile vring_used_t* used;
+
+/* Per request headers and status bytes, indexed by position in the batch. */
+static virtio_blk_req_t headers[VIRTIO_MAX_BATCH];
+static volatile uint8_t statuses[VIRTIO_MAX_BATCH];
+
+static int32_t virtio_blk_read(uint32_t lba, uint32_t count, void* buf);
+static int32_t virtio_blk_write(uint32_t lba, uint32_t count, const void* buf);
+static int32_t virtio_blk_submit(blk_req_t* reqs, uint32_t count);
+
+blkdev_t virtio_blk_dev = {
+	.name = "virtio-blk",
+	.read = virtio_blk_read,
+	.write = virtio_blk_write,
+	.submit = virtio_blk_submit,
+	.max_sectors = VIRTIO_MAX_SECTORS
+};
+
+/*
+ * Resets the device, negotiates no optional features and hands it queue 0.
+ * RETURN: the IRQ line to unmask, -1 if there is no usable device.
+ */
+int32_t virtio_blk_init(){
+	pci_dev_t* pdev = pci_find_device(VIRTIO_VENDOR, VIRTIO_BLK_DEVICE);
+	if(pdev == NULL || !(pdev->bar[0] & PCI_BAR_IO) || pdev->irq >= 16){
+		return -1;
+	}
+	pci_enable(pdev);
+	io_base = pdev->bar[0] & 0xFFFC;
+	virtio_irq_line = pdev->irq;
+
+	outb(0, io_base + VIRTIO_STATUS);						// Reset.
+	outb(VIRTIO_STATUS_ACK, io_base + VIRTIO_STATUS);
+	outb(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER, io_base + VIRTIO_STATUS);
+	(void)inl(io_base + VIRTIO_HOST_FEATURES);
+	outl(0, io_base + VIRTIO_GUEST_FEATURES);				// Plain reads and writes are all we need.
+
+	outw(0, io_base + VIRTIO_QUEUE_SELECT);
+	queue_size = inw(io_base + VIRTIO_QUEUE_SIZE);
+	if(queue_size == 0 || queue_size > VIRTIO_MAX_QUEUE){
+		outb(VIRTIO_STATUS_FAILED, io_base + VIRTIO_STATUS);
+		io_base = 0;
+		return -1;
+	}
+	max_batch = queue_size / VIRTIO_DESC_PER_REQ;
+	if(max_batch > VIRTIO_MAX_BATCH){
+		max_batch = VIRTIO_MAX_BATCH;
+	}
+
+	/* Legacy layout: descriptors, then the available ring, then the used ring on the next page. */
+	memset(vq_mem, 0, sizeof(vq_mem));
+	desc = (vring_desc_t*)vq_mem;
+	avail = (vring_avail_t*)(vq_mem + queue_size * sizeof(vring_desc_t));
+	uint32_t used_off = queue_size * sizeof(vring_desc_t) + 2 * (3 + queue_size);
+	used_off = (used_off + VIRTIO_ALIGN - 1) & ~(VIRTIO_ALIGN - 1);
+	used = (volatile vring_used_t*)(vq_mem + used_off);
+	last_used = 0;
+	outl((uint32_t)vq_mem / VIRTIO_ALIGN, io_base + VIRTIO_QUEUE_PFN);
+
+	uint32_t cap_hi = inl(io_base + VIRTIO_BLK_CAPACITY + 4);
+	virtio_blk_dev.sectors = cap_hi ? 0xFFFFFFFF : inl(io_base + VIRTIO_BLK_CAPACITY);
+
+	/* Create the device's entry in the IDT. Lines 8-15 are on the slave PIC. */
+	uint8_t idtPort = (virtio_irq_line < 8) ? ICW2_MASTER + virtio_irq_line : ICW2_SLAVE + virtio_irq_line - 8;
+	idt[idtPort].size = 0x1;			// This is a 32-bit gate.
+	idt[idtPort].seg_selector = KERNEL_CS;
+	idt[idtPort].reserved1 = 0x1;		// Set these reserved bits to signal to the IDT that this is an interrupt.
+	idt[idtPort].reserved2 = 0x1;
+	SET_IDT_ENTRY(idt[idtPort], virtio_linker);
+	idt[idtPort].present = 0x1;			// Mark the interrupt as present.
+
+	outb(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK, io_base + VIRTIO_STATUS);
+	if(!boot_fast){
+		printf("virtio-blk: %d sectors, queue of %d, IRQ %d\n", virtio_blk_dev.sectors, queue_size, virtio_irq_line);
+	}
+	return virtio_irq_line;
+}
+
+/*
+ * Reading the ISR register deasserts the (possibly shared) line. Completed
+ * requests are picked up from the used ring by whoever is waiting.
+ */
+void virtio_handler(){
+	(void)inb(io_base + VIRTIO_ISR);
+	send_eoi(virtio_irq_line);
+}
+
+/*
+ * Waits until the device has returned target used ring entries. With
+ * interrupts on we sleep between interrupts ("sti; hlt" is atomic, so one
+ * cannot be missed); otherwise we watch the used ring directly.
+ * RETURN: 0 once they are all back, -1 on timeout.
+ */
+static int32_t virtio_wait(uint16_t target, uint32_t flags){
+	uint32_t i;
+	if(flags & EFLAGS_IF){
+		for(i = 0; i < VIRTIO_HLT_LIMIT && used->idx != target; i++){
+			wait_for_interrupt();
+		}
+	}
+	for(i = 0; i < VIRTIO_POLL_LIMIT && used->idx != target; i++){
+		asm volatile("pause" ::: "memory");
+	}
+	return (used->idx == target) ? 0 : -1;
+}
+
+/*
+ * Publishes up to max_batch requests with a single notify and waits for
+ * all of them. write selects VIRTIO_BLK_T_OUT for every request.
+ * RETURN: 0 if the device reported success for all of them, -1 otherwise.
+ */
+static int32_t virtio_run_batch(blk_req_t* reqs, uint32_t count, uint32_t write){
+	uint32_t flags, i;
+	int32_t ret = 0;
+
+	preempt_disable();
+	cli_and_save(flags);
+	uint16_t head = avail->idx;
+	for(i = 0; i < count; i++){
+		uint32_t d = i * VIRTIO_DESC_PER_REQ;
+		headers[i].type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+		headers[i].reserved = 0;
+		headers[i].sector = reqs[i].lba;
+		headers[i].sector_hi = 0;
+		statuses[i] = 0xFF;
+
+		desc[d].addr = (uint32_t)&headers[i];
+		desc[d].addr_hi = 0;
+		desc[d].len = sizeof(virtio_blk_req_t);
+		desc[d].flags = VRING_DESC_F_NEXT;
+		desc[d].next = d + 1;
+
+		desc[d + 1].addr = (uint32_t)reqs[i].buf;
+		desc[d + 1].addr_hi = 0;
+		desc[d + 1].len = reqs[i].count * BLK_SECTOR_SIZE;
+		desc[d + 1].flags = VRING_DESC_F_NEXT | (write ? 0 : VRING_DESC_F_WRITE);
+		desc[d + 1].next = d + 2;
+
+		desc[d + 2].addr = (uint32_t)&statuses[i];
+		desc[d + 2].addr_hi = 0;
+		desc[d + 2].len = 1;
+		desc[d + 2].flags = VRING_DESC_F_WRITE;
+		desc[d + 2].next = 0;
+
+		avail->ring[(uint16_t)(head + i) % queue_size] = d;
+	}
+	asm volatile("" ::: "memory");			// Ring entries before the index that publishes them.
+	avail->idx = head + count;
+	asm volatile("" ::: "memory");
+	outw(0, io_base + VIRTIO_QUEUE_NOTIFY);		// One notification for the whole batch.
+
+	last_used += count;
+	if(virtio_wait(last_used, flags) == -1){
+		io_base = 0;		// The device stopped answering; the ring state can no longer be trusted.
+		ret = -1;
+	}
+	for(i = 0; i < count; i++){
+		if(statuses[i] != VIRTIO_BLK_S_OK){
+			ret = -1;
+		}
+	}
+	restore_flags(flags);
+	preempt_enable();
+	return ret;
+}
+
+/* Splits count requests into batches the queue can hold. */
+static int32_t virtio_blk_rw(blk_req_t* reqs, uint32_t count, uint32_t write){
+	uint32_t i, n;
+
+	if(io_base == 0){
+		return -1;
+	}
+	for(i = 0; i < count; i++){
+		if(reqs[i].buf == NULL || reqs[i].count == 0 || reqs[i].count > VIRTIO_MAX_SECTORS ||
+		   reqs[i].lba + reqs[i].count > virtio_blk_dev.sectors){
+			return -1;
+		}
+	}
+	for(i = 0; i < count; i += n){
+		n = (count - i < max_batch) ? count - i : max_batch;
+		if(virtio_run_batch(reqs + i, n, write) == -1){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* int32_t virtio_blk_submit(blk_req_t* reqs, uint32_t count)
+ * Inputs:      blk_req_t* reqs = reads to perform, buffers in the kernel page
+ *              uint32_t count = number of entries in reqs
+ * Return Value: 0 if every read succeeded else -1 */
+static int32_t virtio_blk_submit(blk_req_t* reqs, uint32_t count){
+	return virtio_blk_rw(reqs, count, 0);
+}
+
+static int32_t virtio_blk_read(uint32_t lba, uint32_t count, void* buf){
+	blk_req_t req = {lba, count, buf};
+	return virtio_blk_rw(&req, 1, 0);
+}
+
+static int32_t virtio_blk_write(uint32_t lba, uint32_t count, const void* buf){
+	blk_req_t req = {lba, count, (void*)buf};
+	return virtio_blk_rw(&req, 1, 1);
+}
@@ -0,0 +1,90 @@
+#ifndef _VIRTIO_H
+#define _VIRTIO_H
+
+/* Driver for a legacy (transitional) virtio-blk PCI device, QEMU's -drive if=virtio. */
+#include "types.h"
+#include "blkdev.h"
+
+#define VIRTIO_VENDOR			0x1AF4
+#define VIRTIO_BLK_DEVICE		0x1001		// Transitional block device.
+
+/* Legacy register layout, offsets from BAR0 (an I/O BAR). */
+#define VIRTIO_HOST_FEATURES	0x00
+#define VIRTIO_GUEST_FEATURES	0x04
+#define VIRTIO_QUEUE_PFN		0x08
+#define VIRTIO_QUEUE_SIZE		0x0C
+#define VIRTIO_QUEUE_SELECT		0x0E
+#define VIRTIO_QUEUE_NOTIFY		0x10
+#define VIRTIO_STATUS			0x12
+#define VIRTIO_ISR				0x13		// Reading it acknowledges the interrupt.
+#define VIRTIO_BLK_CAPACITY		0x14		// 64 bit count of 512 byte sectors.
+
+/* Device status bits. */
+#define VIRTIO_STATUS_ACK		0x1
+#define VIRTIO_STATUS_DRIVER	0x2
+#define VIRTIO_STATUS_DRIVER_OK	0x4
+#define VIRTIO_STATUS_FAILED	0x80
+
+/* Descriptor flags. */
+#define VRING_DESC_F_NEXT		0x1
+#define VRING_DESC_F_WRITE		0x2			// Device writes this buffer.
+
+/* Request types and the status byte the device writes back. */
+#define VIRTIO_BLK_T_IN			0
+#define VIRTIO_BLK_T_OUT		1
+#define VIRTIO_BLK_S_OK			0
+
+#define VIRTIO_MAX_QUEUE		256			// Largest queue we have memory for.
+#define VIRTIO_DESC_PER_REQ		3			// Header, data, status.
+#define VIRTIO_MAX_BATCH		64			// Requests per notification.
+#define VIRTIO_MAX_SECTORS		128			// Per request, to match the other drivers.
+#define VIRTIO_ALIGN			4096		// The used ring starts on its own page.
+
+#ifndef ASM
+typedef struct vring_desc{
+	uint32_t addr;				// Physical address, low half.
+	uint32_t addr_hi;			// Always 0, everything we hand out is below 4 GB.
+	uint32_t len;
+	uint16_t flags;
+	uint16_t next;
+} vring_desc_t;
+
+typedef struct vring_avail{
+	uint16_t flags;
+	uint16_t idx;				// Where the driver will put the next entry.
+	uint16_t ring[VIRTIO_MAX_QUEUE];
+} vring_avail_t;
+
+typedef struct vring_used_elem{
+	uint32_t id;				// Head descriptor of the finished chain.
+	uint32_t len;
+} vring_used_elem_t;
+
+typedef struct vring_used{
+	uint16_t flags;
+	uint16_t idx;				// Where the device will put the next entry.
+	vring_used_elem_t ring[VIRTIO_MAX_QUEUE];
+} vring_used_t;
+
+/* The header at the front of every virtio-blk request. */
+typedef struct virtio_blk_req{
+	uint32_t type;
+	uint32_t reserved;
+	uint32_t sector;
+	uint32_t sector_hi;
+} virtio_blk_req_t;
+
+/* Assembly linkage for the device's interrupt. */
+extern void virtio_linker();
+
+/* The disk as seen by the filesystem, valid once virtio_blk_init succeeds. */
+extern blkdev_t virtio_blk_dev;
+
+/* Finds and sets up the device. RETURN: its IRQ line, or -1 if there is none. */
+int32_t virtio_blk_init();
+
+/* Interrupt handler. */
+void virtio_handler();
+#endif		// ASM
+
+#endif
@@ -0,0 +1,58 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+
+/* ttybench first: its output scrolls, so the others' results stay on screen. */
+static const char* suite[] = {
+    "ttybench", "nullbench", "readbench", "execbench", "rtcbench", "switchbench"
+};
+
+/*
+ * bench [NAME...] -- runs the benchmark programs (all of them, or those
+ * named) one after the other. Every result is a "key value" line, and the
+ * run is framed by "bench-begin" and "bench-end" with one
+ * "bench_status <program> <status>" line per program, so a log of the
+ * screen can be compared run to run with a script.
+ */
+int main ()
+{
+    uint8_t args[BUFSIZE], num[16];
+    uint8_t* names[sizeof (suite) / sizeof (suite[0])];
+    int32_t count = 0, i, status;
+    uint8_t* s;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+        for (s = args; '\0' != *s && count < sizeof (suite) / sizeof (suite[0]); ) {
+            while (' ' == *s)
+                *s++ = '\0';
+            if ('\0' == *s)
+                break;
+            names[count++] = s;
+            while ('\0' != *s && ' ' != *s)
+                s++;
+        }
+    }
+    if (0 == count)
+        for (; count < sizeof (suite) / sizeof (suite[0]); count++)
+            names[count] = (uint8_t*)suite[count];
+
+    ece391_fdputs (1, (uint8_t*)"bench-begin\n");
+    for (i = 0; i < count; i++) {
+        status = ece391_execute (names[i]);
+        ece391_fdputs (1, (uint8_t*)"bench_status ");
+        ece391_fdputs (1, names[i]);
+        ece391_fdputs (1, (uint8_t*)" ");
+        if (-1 == status) {
+            ece391_fdputs (1, (uint8_t*)"-1\n");
+            continue;
+        }
+        ece391_itoa (status, num, 10);
+        ece391_fdputs (1, num);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    ece391_fdputs (1, (uint8_t*)"bench-end\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CMDSIZE 64
+
+/* Written backwards so grep never finds the pattern in this program either. */
+static uint8_t pattern_rev[] = "hctam-on-hcnebehcac";
+
+/* Prints "<prefix>_<name> <value>" on its own line. */
+static void report (const char* prefix, const char* name, uint32_t value)
+{
+    ece391_fdputs (1, (uint8_t*)prefix);
+    ece391_fdputs (1, (uint8_t*)"_");
+    ece391_report ((uint8_t*)name, value);
+}
+
+/* Runs grep over every file once and reports time and cache counters. */
+static int32_t run_grep (const char* prefix, const uint8_t* cmd, int32_t flags)
+{
+    ece391_cachestat_t st;
+    uint32_t start, cycles, total;
+
+    if (-1 == ece391_cachestat (0, flags)) {
+        ece391_fdputs (1, (uint8_t*)"cachestat failed\n");
+        return -1;
+    }
+    start = ece391_rdtsc_lo ();
+    if (0 != ece391_execute (cmd)) {
+        ece391_fdputs (1, (uint8_t*)"grep failed\n");
+        return -1;
+    }
+    cycles = ece391_rdtsc_lo () - start;
+    (void)ece391_cachestat (&st, 0);
+
+    total = st.hits + st.misses;
+    report (prefix, "cycles", cycles);
+    report (prefix, "hits", st.hits);
+    report (prefix, "misses", st.misses);
+    report (prefix, "readahead", st.readahead);
+    report (prefix, "readahead_hits", st.readahead_hits);
+    report (prefix, "hit_pct", total ? st.hits * 100 / total : 0);
+    return 0;
+}
+
+/*
+ * Greps every file for a string that does not occur anywhere, first with
+ * an empty buffer cache and then again with whatever the first run left
+ * behind. All counters stay at 0 when the filesystem is a GRUB module
+ * rather than on disk.
+ */
+int main ()
+{
+    uint8_t cmd[CMDSIZE];
+    uint32_t i, len;
+
+    len = ece391_strlen (pattern_rev);
+    ece391_strcpy (cmd, (uint8_t*)"grep ");
+    for (i = 0; i < len; i++)
+        cmd[5 + i] = pattern_rev[len - 1 - i];
+    cmd[5 + len] = '\0';
+
+    if (-1 == run_grep ("grep_cold", cmd, ECE391_CACHE_RESET | ECE391_CACHE_DROP) ||
+        -1 == run_grep ("grep_warm", cmd, ECE391_CACHE_RESET))
+        return 3;
+    return 0;
+}
@@ -3,30 +3,50 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
+#define BUFSIZE 32768
+
+static uint8_t buf[BUFSIZE];
+
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[1024];
+    int32_t fd, cnt, want, remaining;
+    uint8_t name[1024];
+    ece391_stat_t st;
 
-    if (0 != ece391_getargs (buf, 1024)) {
+    if (0 != ece391_getargs (name, 1024)) {
         ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
 	return 3;
     }
 
-    if (-1 == (fd = ece391_open (buf))) {
+    if (-1 == (fd = ece391_open (name))) {
         ece391_fdputs (1, (uint8_t*)"file not found\n");
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, 1024))) {
+    /* 
+     * For regular files the length sizes each read exactly: a file that
+     * fits in buf takes one read and one write, a larger one is copied in
+     * full buffers plus one short read for the rest, and the final read
+     * that would only return 0 is never made. Anything else is read
+     * until EOF.
+     */
+    remaining = -1;
+    if (0 == ece391_fstat (fd, &st) && 2 == st.type)
+        remaining = st.length;
+
+    while (0 != remaining) {
+        want = (remaining > 0 && remaining < BUFSIZE) ? remaining : BUFSIZE;
+        if (0 == (cnt = ece391_read (fd, buf, want)))
+	    break;
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"file read failed\n");
 	    return 3;
 	}
 	if (-1 == ece391_write (1, buf, cnt))
 	    return 3;
+	if (remaining > 0)
+	    remaining -= cnt;
     }
 
     return 0;
 }
-
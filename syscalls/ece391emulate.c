@@ -1,9 +1,12 @@
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "ece391support.h"
@@ -15,6 +18,9 @@ static uint32_t start_esp;
 static int32_t dir_fd = -1;
 static DIR* dir = NULL;
 
+#define MAX_TIMEOUT_FDS 64
+static int32_t read_timeout_ms[MAX_TIMEOUT_FDS];	/* 0 waits forever. */
+
 
 /* 
  * (copied from the real system call support)
@@ -184,8 +190,14 @@ ece391_read (int32_t fd, void* buf, int32_t nbytes)
     uint8_t* from;
     uint8_t* to;
 
-    if (NULL == dir || dir_fd != fd)
+    if (NULL == dir || dir_fd != fd) {
+        if (0 <= fd && MAX_TIMEOUT_FDS > fd && 0 != read_timeout_ms[fd]) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (1 != poll (&pfd, 1, read_timeout_ms[fd]))
+                return -1;
+        }
         return __ece391_read (fd, buf, nbytes);
+    }
     if (NULL == (de = readdir (dir)))
         return 0;
     to = buf;
@@ -225,3 +237,250 @@ ece391_close (int32_t fd)
     return 0;
 }
 
+
+int32_t 
+ece391_readv (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt)
+{
+    int32_t idx, cnt, total = 0;
+
+    for (idx = 0; idx < iovcnt; idx++) {
+        if (-1 == (cnt = ece391_read (fd, iov[idx].base, iov[idx].len)))
+	    return (0 == total ? -1 : total);
+	total += cnt;
+	if (cnt < iov[idx].len)
+	    break;
+    }
+    return total;
+}
+
+int32_t 
+ece391_writev (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt)
+{
+    int32_t idx, cnt, total = 0;
+
+    for (idx = 0; idx < iovcnt; idx++) {
+        if (-1 == (cnt = ece391_write (fd, iov[idx].base, iov[idx].len)))
+	    return (0 == total ? -1 : total);
+	total += cnt;
+    }
+    return total;
+}
+
+int32_t 
+ece391_batch (ece391_syscall_desc_t* calls, int32_t count)
+{
+    int32_t idx;
+    int32_t* a;
+
+    for (idx = 0; idx < count; idx++) {
+        a = calls[idx].arg;
+        switch (calls[idx].num) {
+	    case SYS_READ:
+	        calls[idx].ret = ece391_read (a[0], (void*)a[1], a[2]);
+		break;
+	    case SYS_WRITE:
+	        calls[idx].ret = ece391_write (a[0], (void*)a[1], a[2]);
+		break;
+	    case SYS_OPEN:
+	        calls[idx].ret = ece391_open ((uint8_t*)a[0]);
+		break;
+	    case SYS_CLOSE:
+	        calls[idx].ret = ece391_close (a[0]);
+		break;
+	    case SYS_READV:
+	        calls[idx].ret = ece391_readv (a[0], (ece391_iovec_t*)a[1], a[2]);
+		break;
+	    case SYS_WRITEV:
+	        calls[idx].ret = ece391_writev (a[0], (ece391_iovec_t*)a[1], a[2]);
+		break;
+	    default:
+	        calls[idx].ret = -1;
+		break;
+	}
+	if (-1 == calls[idx].ret)
+	    return idx;
+    }
+    return count;
+}
+
+int32_t 
+ece391_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes)
+{
+    struct dirent* de;
+    struct stat st;
+    int32_t cnt = 0, idx;
+
+    if (NULL == dir || dir_fd != fd)
+        return -1;
+    while ((cnt + 1) * (int32_t)sizeof (ece391_dirent_t) <= nbytes &&
+           NULL != (de = readdir (dir))) {
+	for (idx = 0; idx < 32 && '\0' != de->d_name[idx]; idx++)
+	    buf[cnt].name[idx] = de->d_name[idx];
+	for (; idx < 32; idx++)
+	    buf[cnt].name[idx] = '\0';
+	buf[cnt].type = 2;
+	buf[cnt].inode = de->d_ino;
+	buf[cnt].length = 0;
+	if (0 == stat (de->d_name, &st)) {
+	    if (S_ISDIR (st.st_mode))
+	        buf[cnt].type = 1;
+	    else
+	        buf[cnt].length = st.st_size;
+	}
+	cnt++;
+    }
+    return cnt * sizeof (ece391_dirent_t);
+}
+
+static void
+fill_stat (const struct stat* st, ece391_stat_t* buf)
+{
+    buf->type = (S_ISDIR (st->st_mode) ? 1 : 2);
+    buf->inode = st->st_ino;
+    buf->length = (S_ISDIR (st->st_mode) ? 0 : st->st_size);
+    buf->blocks = (buf->length + 4095) / 4096;
+}
+
+int32_t 
+ece391_stat (const uint8_t* filename, ece391_stat_t* buf)
+{
+    struct stat st;
+
+    if (0 != stat ((const char*)filename, &st))
+        return -1;
+    fill_stat (&st, buf);
+    return 0;
+}
+
+int32_t 
+ece391_fstat (int32_t fd, ece391_stat_t* buf)
+{
+    struct stat st;
+
+    if (fd < 2)
+        return -1;
+    if (NULL != dir && dir_fd == fd)
+        return ece391_stat ((uint8_t*)".", buf);
+    if (0 != fstat (fd, &st))
+        return -1;
+    fill_stat (&st, buf);
+    return 0;
+}
+
+int32_t 
+ece391_lseek (int32_t fd, int32_t offset, int32_t whence)
+{
+    if (NULL != dir && dir_fd == fd)
+        return -1;
+    return lseek (fd, offset, whence);
+}
+
+int32_t 
+ece391_pread (int32_t fd, void* buf, int32_t nbytes, int32_t offset)
+{
+    if (NULL != dir && dir_fd == fd)
+        return -1;
+    return pread (fd, buf, nbytes, offset);
+}
+
+int32_t 
+ece391_create (const uint8_t* filename)
+{
+    return open ((const char*)filename, O_RDWR | O_CREAT | O_EXCL, 0644);
+}
+
+int32_t 
+ece391_truncate (int32_t fd, int32_t length)
+{
+    if (NULL != dir && dir_fd == fd)
+        return -1;
+    return ftruncate (fd, length);
+}
+
+/* The host's page cache is not ours to report on; every counter reads 0. */
+int32_t 
+ece391_cachestat (ece391_cachestat_t* buf, int32_t flags)
+{
+    ece391_cachestat_t zero = {0};
+
+    if (flags & ~(ECE391_CACHE_RESET | ECE391_CACHE_DROP))
+        return -1;
+    if (NULL != buf)
+        *buf = zero;
+    return 0;
+}
+
+int32_t 
+ece391_clock_gettime (int32_t clock_id, ece391_timespec_t* ts)
+{
+    struct timespec now;
+
+    if (ECE391_CLOCK_MONOTONIC != clock_id || NULL == ts ||
+        0 != clock_gettime (CLOCK_MONOTONIC, &now))
+        return -1;
+    ts->tv_sec = now.tv_sec;
+    ts->tv_nsec = now.tv_nsec;
+    return 0;
+}
+
+/* There is no clock page on the host; ece391_clock_now falls back to the call above. */
+int32_t 
+ece391_clockmap (const ece391_clock_page_t** page)
+{
+    return -1;
+}
+
+int32_t 
+ece391_nanosleep (const ece391_timespec_t* req)
+{
+    struct timespec ts;
+
+    if (NULL == req || 0 > req->tv_sec || 0 > req->tv_nsec || 1000000000 <= req->tv_nsec)
+        return -1;
+    ts.tv_sec = req->tv_sec;
+    ts.tv_nsec = req->tv_nsec;
+    while (0 != nanosleep (&ts, &ts));
+    return 0;
+}
+
+/* Checked with poll() in ece391_read before a read that could block. */
+int32_t 
+ece391_set_timeout (int32_t fd, const ece391_timespec_t* timeout)
+{
+    int32_t ms = 0;
+
+    if (0 > fd || MAX_TIMEOUT_FDS <= fd)
+        return -1;
+    if (NULL != timeout) {
+        if (0 > timeout->tv_sec || 0 > timeout->tv_nsec || 1000000000 <= timeout->tv_nsec)
+            return -1;
+        ms = timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) / 1000000;
+    }
+    read_timeout_ms[fd] = ms;
+    return 0;
+}
+
+/* There is no profiler on the host; use perf there instead. */
+int32_t 
+ece391_profile (int32_t cmd, void* buf, int32_t n)
+{
+    return -1;
+}
+
+int32_t 
+ece391_trace (int32_t cmd)
+{
+    return -1;
+}
+
+int32_t 
+ece391_irqstat (ece391_irqstat_t* buf, int32_t flags)
+{
+    return -1;
+}
+
+int32_t 
+ece391_procstat (ece391_proc_info_t* buf, int32_t n)
+{
+    return -1;
+}
@@ -0,0 +1,38 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERATIONS 200
+#define BUFSIZE 16
+
+/*
+ * Runs "execbench child" ITERATIONS times and reports the cycles from
+ * execute to the parent getting the status back: loading this program,
+ * two switches between address spaces, and the halt. The child returns
+ * at once. It needs a free process slot, so run it with nothing else
+ * running on the other terminals.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t i, start, best = 0xFFFFFFFF, cycles, total = 0;
+
+    if (0 == ece391_getargs (buf, BUFSIZE) && 0 == ece391_strcmp (buf, (uint8_t*)"child"))
+        return 7;
+
+    for (i = 0; i < ITERATIONS; i++) {
+        start = ece391_rdtsc_lo ();
+        if (7 != ece391_execute ((uint8_t*)"execbench child")) {
+            ece391_fdputs (1, (uint8_t*)"execbench: execute failed\n");
+            return 2;
+        }
+        cycles = ece391_rdtsc_lo () - start;
+        total += cycles;
+        if (cycles < best)
+            best = cycles;
+    }
+    ece391_report ((uint8_t*)"exec_halt_cycles", total / ITERATIONS);
+    ece391_report ((uint8_t*)"exec_halt_min_cycles", best);
+    return 0;
+}
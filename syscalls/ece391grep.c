@@ -6,6 +6,23 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/* Writes "fname:line\n" to stdout with a single system call. */
+static void
+print_match (const char* fname, uint8_t* line)
+{
+    ece391_iovec_t iov[4];
+
+    iov[0].base = (void*)fname;
+    iov[0].len = ece391_strlen ((uint8_t*)fname);
+    iov[1].base = ":";
+    iov[1].len = 1;
+    iov[2].base = line;
+    iov[2].len = ece391_strlen (line);
+    iov[3].base = "\n";
+    iov[3].len = 1;
+    (void)ece391_writev (1, iov, 4);
+}
+
 int32_t
 do_one_file (const char* s, const char* fname) 
 {
@@ -42,10 +59,7 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    print_match (fname, data + line_start);
 		    break;
 		}
 	    }
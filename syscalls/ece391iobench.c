@@ -0,0 +1,62 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+#define LINES 2000
+
+static uint8_t fname[] = "frame0.txt";
+static uint8_t line[] = "/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/";
+
+/*
+ * Prints the same grep-style match line ("file:line\n") LINES times using
+ * each output method, and reports the cost per line. The three methods are
+ * what grep used to do (four writes), writev, and a batch of four writes.
+ */
+int main ()
+{
+    ece391_iovec_t iov[4];
+    ece391_syscall_desc_t calls[4];
+    uint32_t i, start, old_cycles, writev_cycles, batch_cycles;
+
+    iov[0].base = fname;
+    iov[0].len = ece391_strlen (fname);
+    iov[1].base = ":";
+    iov[1].len = 1;
+    iov[2].base = line;
+    iov[2].len = ece391_strlen (line);
+    iov[3].base = "\n";
+    iov[3].len = 1;
+    for (i = 0; i < 4; i++) {
+        calls[i].num = SYS_WRITE;
+	calls[i].arg[0] = 1;
+	calls[i].arg[1] = (int32_t)iov[i].base;
+	calls[i].arg[2] = iov[i].len;
+    }
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LINES; i++) {
+        ece391_fdputs (1, fname);
+        ece391_fdputs (1, (uint8_t*)":");
+        ece391_fdputs (1, line);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    old_cycles = ece391_rdtsc_lo () - start;
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LINES; i++)
+        (void)ece391_writev (1, iov, 4);
+    writev_cycles = ece391_rdtsc_lo () - start;
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LINES; i++)
+        (void)ece391_batch (calls, 4);
+    batch_cycles = ece391_rdtsc_lo () - start;
+
+    /* Report after all the output so the results don't scroll away. */
+    ece391_report ((uint8_t*)"grepline_fdputs_cycles", old_cycles / LINES);
+    ece391_report ((uint8_t*)"grepline_writev_cycles", writev_cycles / LINES);
+    ece391_report ((uint8_t*)"grepline_batch_cycles", batch_cycles / LINES);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+static ece391_irqstat_t stats;
+
+static void
+put_num (uint32_t value)
+{
+    uint8_t buf[16];
+
+    ece391_itoa (value, buf, 10);
+    ece391_fdputs (1, buf);
+}
+
+/* Prints cycles as microseconds with three decimals. */
+static void
+put_us (uint32_t cycles, uint32_t mhz)
+{
+    uint32_t frac = (cycles % mhz) * 1000 / mhz;
+
+    put_num (cycles / mhz);
+    ece391_fdputs (1, (uint8_t*)(frac < 10 ? ".00" : frac < 100 ? ".0" : "."));
+    put_num (frac);
+    ece391_fdputs (1, (uint8_t*)"us");
+}
+
+/* One line of totals, then the lower edge and count of each non-empty bucket. */
+static void
+show (const uint8_t* name, const ece391_irq_hist_t* h, uint32_t mhz)
+{
+    int32_t i;
+
+    ece391_fdputs (1, name);
+    ece391_fdputs (1, (uint8_t*)": ");
+    put_num (h->count);
+    ece391_fdputs (1, (uint8_t*)" times, longest ");
+    put_us (h->max, mhz);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    for (i = 0; i < ECE391_IRQSTAT_BUCKETS; i++) {
+        if (0 == h->bucket[i])
+            continue;
+        ece391_fdputs (1, (uint8_t*)"  >= ");
+        put_us (1U << i, mhz);
+        ece391_fdputs (1, (uint8_t*)" ");
+        put_num (h->bucket[i]);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+}
+
+/*
+ * irqstat [reset]
+ *
+ * Shows a histogram of handler run times for each IRQ that has fired and
+ * one of the stretches with interrupts off; reset zeroes them afterwards.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t name[8];
+    int32_t flags = 0, i;
+    uint32_t mhz;
+
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        if (0 != ece391_strcmp (buf, (uint8_t*)"reset")) {
+            ece391_fdputs (1, (uint8_t*)"usage: irqstat [reset]\n");
+            return 3;
+        }
+        flags = ECE391_IRQSTAT_RESET;
+    }
+    if (0 != ece391_irqstat (&stats, flags)) {
+        ece391_fdputs (1, (uint8_t*)"irqstat failed\n");
+        return 2;
+    }
+    mhz = stats.tsc_khz / 1000;
+    if (0 == mhz)
+        mhz = 1;
+
+    for (i = 0; i < ECE391_IRQSTAT_LINES; i++) {
+        if (0 == stats.handler[i].count)
+            continue;
+        ece391_strcpy (name, (uint8_t*)"irq ");
+        ece391_itoa (i, name + 4, 10);
+        show (name, &stats.handler[i], mhz);
+    }
+    show ((uint8_t*)"irqs off", &stats.irqoff, mhz);
+    stats.irqoff_site[31] = '\0';
+    ece391_fdputs (1, (uint8_t*)"longest began at ");
+    ece391_fdputs (1, stats.irqoff_site);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
@@ -3,27 +3,36 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define MAX_ENTRIES 63  /* the boot block holds at most 63 entries */
+#define NAMELEN 32
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, i, j, out;
+    ece391_dirent_t ents[MAX_ENTRIES];
+    uint8_t buf[MAX_ENTRIES * (NAMELEN + 1)];
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
-        if (-1 == cnt) {
+    /* One getdents for the whole directory, then one write for all names.
+       A short read means the directory is done; only a full one asks again. */
+    out = 0;
+    do {
+        if (-1 == (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
-    }
+	    for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	        for (j = 0; j < NAMELEN && '\0' != ents[i].name[j]; j++)
+	            buf[out++] = ents[i].name[j];
+	        buf[out++] = '\n';
+	    }
+    } while (cnt == (int32_t)sizeof (ents));
+    if (-1 == ece391_write (1, buf, out))
+        return 3;
 
     return 0;
 }
@@ -0,0 +1,46 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERATIONS 100000
+
+int main ()
+{
+    uint32_t i, start;
+    ece391_timespec_t ts;
+
+    /* Warm up both paths so the first timed loop doesn't pay for it. */
+    (void)ece391_nop ();
+    (void)ece391_fast_nop ();
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERATIONS; i++)
+        (void)ece391_nop ();
+    ece391_report ((uint8_t*)"nop_int80_cycles", (ece391_rdtsc_lo () - start) / ITERATIONS);
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERATIONS; i++)
+        (void)ece391_fast_nop ();
+    ece391_report ((uint8_t*)"nop_sysenter_cycles", (ece391_rdtsc_lo () - start) / ITERATIONS);
+
+    /* Reading the clock: through each system call path, then from the clock page. */
+    (void)ece391_clock_now (&ts);
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERATIONS; i++)
+        (void)ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts);
+    ece391_report ((uint8_t*)"clock_gettime_int80_cycles", (ece391_rdtsc_lo () - start) / ITERATIONS);
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERATIONS; i++)
+        (void)ece391_fast_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts);
+    ece391_report ((uint8_t*)"clock_gettime_sysenter_cycles", (ece391_rdtsc_lo () - start) / ITERATIONS);
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERATIONS; i++)
+        (void)ece391_clock_now (&ts);
+    ece391_report ((uint8_t*)"clock_page_cycles", (ece391_rdtsc_lo () - start) / ITERATIONS);
+
+    return 0;
+}
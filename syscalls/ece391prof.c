@@ -0,0 +1,107 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define TOP 20
+
+static ece391_prof_entry_t entries[ECE391_PROF_MAX_ENTRIES];
+
+static void
+put_num (uint32_t value, int32_t radix)
+{
+    uint8_t buf[16];
+
+    ece391_itoa (value, buf, radix);
+    ece391_fdputs (1, buf);
+}
+
+/* Shell sort, busiest first. */
+static void
+sort_entries (int32_t n)
+{
+    int32_t gap, i, j;
+    ece391_prof_entry_t e;
+
+    for (gap = n / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            e = entries[i];
+            for (j = i; j >= gap && entries[j - gap].count < e.count; j -= gap)
+                entries[j] = entries[j - gap];
+            entries[j] = e;
+        }
+    }
+}
+
+/* Prints the totals per privilege level and the TOP busiest addresses. */
+static int32_t
+show (void)
+{
+    int32_t n, i;
+    uint32_t total = 0, kernel = 0;
+    uint8_t name[32];
+
+    if (-1 == (n = ece391_profile (ECE391_PROF_READ, entries, ECE391_PROF_MAX_ENTRIES))) {
+        ece391_fdputs (1, (uint8_t*)"profile read failed\n");
+        return 2;
+    }
+    for (i = 0; i < n; i++) {
+        total += entries[i].count;
+        if (0 == entries[i].cpl)
+            kernel += entries[i].count;
+    }
+    if (0 == total) {
+        ece391_fdputs (1, (uint8_t*)"no samples; run prof start first\n");
+        return 0;
+    }
+    sort_entries (n);
+
+    ece391_fdputs (1, (uint8_t*)"samples ");
+    put_num (total, 10);
+    ece391_fdputs (1, (uint8_t*)", kernel ");
+    put_num (kernel * 100 / total, 10);
+    ece391_fdputs (1, (uint8_t*)"%\n  count   %  where\n");
+    for (i = 0; i < n && i < TOP; i++) {
+        uint32_t permille = entries[i].count * 1000 / total;
+        ece391_fdputs (1, (uint8_t*)"  ");
+        put_num (entries[i].count, 10);
+        ece391_fdputs (1, (uint8_t*)" ");
+        put_num (permille / 10, 10);
+        ece391_fdputs (1, (uint8_t*)".");
+        put_num (permille % 10, 10);
+        ece391_fdputs (1, (uint8_t*)(0 == entries[i].cpl ? "  kernel " : "  user   "));
+        if (0 == ece391_profile (ECE391_PROF_NAME, name, entries[i].prog)) {
+            name[31] = '\0';
+            ece391_fdputs (1, name);
+        } else {
+            ece391_fdputs (1, (uint8_t*)"?");
+        }
+        ece391_fdputs (1, (uint8_t*)" 0x");
+        put_num (entries[i].eip, 16);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    return 0;
+}
+
+/*
+ * prof start | stop | show | dump
+ *
+ * show prints the busiest addresses; dump sends the whole histogram to
+ * COM1, where prof.py in student-distrib turns it into a flat profile.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+
+    if (0 != ece391_getargs (buf, BUFSIZE) || 0 == ece391_strcmp (buf, (uint8_t*)"show"))
+        return show ();
+    if (0 == ece391_strcmp (buf, (uint8_t*)"start"))
+        return (0 == ece391_profile (ECE391_PROF_START, 0, 0)) ? 0 : 2;
+    if (0 == ece391_strcmp (buf, (uint8_t*)"stop"))
+        return (0 == ece391_profile (ECE391_PROF_STOP, 0, 0)) ? 0 : 2;
+    if (0 == ece391_strcmp (buf, (uint8_t*)"dump"))
+        return (-1 != ece391_profile (ECE391_PROF_DUMP, 0, 0)) ? 0 : 2;
+    ece391_fdputs (1, (uint8_t*)"usage: prof start | stop | show | dump\n");
+    return 3;
+}
@@ -0,0 +1,64 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TOTAL (256 * 1024)
+#define MAX_CHUNK 4096
+#define BUFSIZE 16
+
+static uint8_t fname[] = "readbench";
+static uint8_t buf[MAX_CHUNK];
+static const int32_t chunks[] = {16, 64, 256, 1024, 4096};
+
+/* Prints "read_<chunk>_cycles_per_kb <value>" on its own line. */
+static void report (int32_t chunk, uint32_t value)
+{
+    uint8_t num[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)"read_");
+    ece391_itoa (chunk, num, 10);
+    ece391_fdputs (1, num);
+    ece391_report ((uint8_t*)"_cycles_per_kb", value);
+}
+
+/*
+ * Reads TOTAL bytes of this program's own file with each read size in
+ * turn, rewinding at the end of the file, and reports cycles per kB. The
+ * file is read once untimed first so every size sees a warm cache.
+ */
+int main ()
+{
+    int32_t fd, i, n, got;
+    uint32_t start, cycles;
+
+    if (-1 == (fd = ece391_open (fname))) {
+        ece391_fdputs (1, (uint8_t*)"readbench: cannot open readbench\n");
+        return 2;
+    }
+    while (0 < ece391_read (fd, buf, MAX_CHUNK));
+
+    for (i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++) {
+        (void)ece391_lseek (fd, 0, ECE391_SEEK_SET);
+        got = 0;
+        start = ece391_rdtsc_lo ();
+        while (got < TOTAL) {
+            n = ece391_read (fd, buf, chunks[i]);
+            if (0 == n) {
+                (void)ece391_lseek (fd, 0, ECE391_SEEK_SET);
+                continue;
+            }
+            if (-1 == n)
+                break;
+            got += n;
+        }
+        cycles = ece391_rdtsc_lo () - start;
+        if (got < TOTAL) {
+            ece391_fdputs (1, (uint8_t*)"readbench: read failed\n");
+            return 3;
+        }
+        report (chunks[i], cycles / (got / 1024));
+    }
+    (void)ece391_close (fd);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define WAKEUPS 512
+#define BUFSIZE 16
+
+static uint32_t interval[WAKEUPS];
+
+/*
+ * rtcbench [FREQ] -- waits for WAKEUPS RTC ticks at FREQ Hz (default 1024)
+ * and reports how far apart they really were, in cycles: the ideal
+ * period from the calibrated TSC, the shortest, mean and longest gap, the
+ * mean distance from the ideal (jitter), and how many gaps were over
+ * twice the ideal (late: another terminal had the CPU, or a tick was
+ * missed).
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    const ece391_clock_page_t* page;
+    int32_t fd, freq = 1024, i, garbage;
+    uint32_t ideal, last, now, min = 0xFFFFFFFF, max = 0, late = 0;
+    uint32_t sum = 0, dev = 0;
+    uint64_t per_sec;
+
+    if (0 == ece391_getargs (buf, BUFSIZE))
+        for (freq = 0, i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            freq = freq * 10 + (buf[i] - '0');
+    if (-1 == ece391_clockmap (&page) || -1 == (fd = ece391_open ((uint8_t*)"rtc")) ||
+        -1 == ece391_write (fd, &freq, 4)) {
+        ece391_fdputs (1, (uint8_t*)"usage: rtcbench [FREQ], FREQ a power of 2 up to 1024\n");
+        return 3;
+    }
+    per_sec = (uint64_t)page->tsc_khz * 1000;
+    ideal = ece391_div32 (per_sec, freq);
+
+    (void)ece391_read (fd, &garbage, 4);        /* Line up with a tick first. */
+    last = ece391_rdtsc_lo ();
+    for (i = 0; i < WAKEUPS; i++) {
+        (void)ece391_read (fd, &garbage, 4);
+        now = ece391_rdtsc_lo ();
+        interval[i] = now - last;
+        last = now;
+    }
+    (void)ece391_close (fd);
+
+    for (i = 0; i < WAKEUPS; i++) {
+        sum += interval[i] / WAKEUPS;
+        dev += ((interval[i] > ideal) ? interval[i] - ideal : ideal - interval[i]) / WAKEUPS;
+        if (interval[i] < min)
+            min = interval[i];
+        if (interval[i] > max)
+            max = interval[i];
+        if (interval[i] > 2 * ideal)
+            late++;
+    }
+    ece391_report ((uint8_t*)"rtc_freq", freq);
+    ece391_report ((uint8_t*)"rtc_period_cycles", ideal);
+    ece391_report ((uint8_t*)"rtc_min_cycles", min);
+    ece391_report ((uint8_t*)"rtc_mean_cycles", sum);
+    ece391_report ((uint8_t*)"rtc_max_cycles", max);
+    ece391_report ((uint8_t*)"rtc_jitter_cycles", dev);
+    ece391_report ((uint8_t*)"rtc_late", late);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+/* sleep SECONDS[.FRACTION] -- waits without spinning on the RTC. */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint8_t* s = buf;
+    ece391_timespec_t req = {0, 0};
+    int32_t scale = 100000000;
+
+    if (0 != ece391_getargs (buf, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: sleep SECONDS[.FRACTION]\n");
+        return 3;
+    }
+    for (; *s >= '0' && *s <= '9'; s++)
+        req.tv_sec = req.tv_sec * 10 + (*s - '0');
+    if ('.' == *s)
+        for (s++; *s >= '0' && *s <= '9'; s++, scale /= 10)
+            req.tv_nsec += (*s - '0') * scale;
+    if (('\0' != *s && ' ' != *s) || s == buf) {
+        ece391_fdputs (1, (uint8_t*)"usage: sleep SECONDS[.FRACTION]\n");
+        return 3;
+    }
+    if (0 != ece391_nanosleep (&req)) {
+        ece391_fdputs (1, (uint8_t*)"sleep failed\n");
+        return 2;
+    }
+    return 0;
+}
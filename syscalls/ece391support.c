@@ -102,3 +102,58 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* 
+ * Reads the clock through the page from ece391_clockmap, looked up on the
+ * first call. Falls back to the system call where there is no page.
+ */
+int32_t ece391_clock_now(ece391_timespec_t* ts)
+{
+    static const ece391_clock_page_t* page = 0;
+    static int32_t mapped = 0;
+    uint32_t lo, hi, sec, nsec;
+    uint32_t ns_per_sec = 1000000000;
+    uint64_t cycles, ns;
+
+    if (!mapped)
+        mapped = (ece391_clockmap (&page) == -1) ? -1 : 1;
+    if (mapped == -1)
+        return ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, ts);
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    cycles = (((uint64_t)hi << 32) | lo) - (((uint64_t)page->tsc_base_hi << 32) | page->tsc_base_lo);
+    ns = (((uint64_t)(uint32_t)(cycles >> 32) * page->mult) << (32 - page->shift)) +
+         (((uint64_t)(uint32_t)cycles * page->mult) >> page->shift);
+
+    /* One divl: the quotient is seconds since boot, which fits in 32 bits. */
+    asm ("divl %4" : "=a" (sec), "=d" (nsec) : "a" ((uint32_t)ns), "d" ((uint32_t)(ns >> 32)), "rm" (ns_per_sec));
+    ts->tv_sec = sec;
+    ts->tv_nsec = nsec;
+    return 0;
+}
+
+uint32_t ece391_rdtsc_lo(void)
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+uint32_t ece391_div32(uint64_t n, uint32_t d)
+{
+    uint32_t q, r;
+
+    asm ("divl %4" : "=a" (q), "=d" (r) : "a" ((uint32_t)n), "d" ((uint32_t)(n >> 32)), "rm" (d) : "cc");
+    return q;
+}
+
+void ece391_report(const uint8_t* name, uint32_t value)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, name);
+    ece391_fdputs (1, (uint8_t*)" ");
+    ece391_itoa (value, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
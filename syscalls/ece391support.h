@@ -1,6 +1,8 @@
 #if !defined(ECE391SUPPORT_H)
 #define ECE391SUPPORT_H
 
+#include "ece391syscall.h"
+
 extern uint32_t ece391_strlen(const uint8_t* s);
 extern void ece391_strcpy(uint8_t* dst, const uint8_t* src);
 extern void ece391_fdputs(int32_t fd, const uint8_t* s);
@@ -8,6 +10,14 @@ extern int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
+/* Same as ece391_clock_gettime on ECE391_CLOCK_MONOTONIC, from the clock page when there is one. */
+extern int32_t ece391_clock_now(ece391_timespec_t* ts);
+/* Low 32 bits of the time stamp counter; plenty for one timed loop. */
+extern uint32_t ece391_rdtsc_lo(void);
+/* n / d where the quotient is known to fit in 32 bits, without libgcc. */
+extern uint32_t ece391_div32(uint64_t n, uint32_t d);
+/* Prints "<name> <value>" on its own line, the benchmarks' result format. */
+extern void ece391_report(const uint8_t* name, uint32_t value);
 
 #endif /* ECE391SUPPORT_H */
 
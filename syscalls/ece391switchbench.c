@@ -0,0 +1,47 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SPIN_SECONDS 2
+
+static ece391_irqstat_t stats;
+
+/*
+ * Measures context switches between the terminals' processes. There is
+ * no call that blocks one process on another, so instead of a ping-pong
+ * this spins for SPIN_SECONDS while the PIT moves the CPU round the
+ * terminals. The IRQ 0 handler is entered in one process and left in the
+ * next, so its time in irqstat is the full switch: interrupt entry,
+ * scheduler, stack and page directory change, and the return. Reports
+ * the switches seen, the lower edge of the power-of-2 bucket holding the
+ * median, and the longest, in cycles.
+ */
+int main ()
+{
+    ece391_timespec_t now, end;
+    ece391_irq_hist_t* pit = &stats.handler[0];
+    uint32_t i, seen = 0;
+
+    if (-1 == ece391_irqstat (0, ECE391_IRQSTAT_RESET)) {
+        ece391_fdputs (1, (uint8_t*)"switchbench: no IRQ statistics\n");
+        return 2;
+    }
+    (void)ece391_clock_now (&end);
+    end.tv_sec += SPIN_SECONDS;
+    do
+        (void)ece391_clock_now (&now);
+    while (now.tv_sec < end.tv_sec || (now.tv_sec == end.tv_sec && now.tv_nsec < end.tv_nsec));
+    (void)ece391_irqstat (&stats, 0);
+
+    ece391_report ((uint8_t*)"switch_count", pit->count);
+    for (i = 0; i < ECE391_IRQSTAT_BUCKETS; i++) {
+        seen += pit->bucket[i];
+        if (2 * seen >= pit->count && 0 != pit->count) {
+            ece391_report ((uint8_t*)"switch_median_floor_cycles", 1U << i);
+            break;
+        }
+    }
+    ece391_report ((uint8_t*)"switch_max_cycles", pit->max);
+    return 0;
+}
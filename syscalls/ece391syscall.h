@@ -5,6 +5,147 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* One buffer for readv/writev (at most 16 per call). */
+typedef struct ece391_iovec {
+    void* base;
+    int32_t len;
+} ece391_iovec_t;
+
+/*
+ * One call for ece391_batch (at most 32 per batch). The kernel stores each
+ * call's return value in ret. halt, execute and batch cannot be batched.
+ */
+typedef struct ece391_syscall_desc {
+    int32_t num;
+    int32_t arg[4];
+    int32_t ret;
+} ece391_syscall_desc_t;
+
+/* One directory entry from ece391_getdents; records are fixed size. */
+typedef struct ece391_dirent {
+    uint8_t name[32];   /* not NUL terminated when 32 characters long */
+    int32_t type;       /* 0 = RTC, 1 = directory, 2 = regular file */
+    int32_t inode;
+    int32_t length;
+} ece391_dirent_t;
+
+/* File metadata from ece391_stat/ece391_fstat. */
+typedef struct ece391_stat {
+    int32_t type;       /* same values as ece391_dirent_t.type */
+    int32_t inode;
+    int32_t length;     /* bytes; 0 for the RTC and directories */
+    int32_t blocks;     /* 4 kB data blocks */
+} ece391_stat_t;
+
+/* Buffer cache counters from ece391_cachestat. */
+typedef struct ece391_cachestat {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readahead;         /* blocks read ahead of time */
+    uint32_t readahead_hits;    /* read-ahead blocks that were later used */
+    uint32_t evictions;
+    uint32_t writes;
+} ece391_cachestat_t;
+
+/* Flags for ece391_cachestat. */
+#define ECE391_CACHE_RESET 1    /* zero the counters after reading them */
+#define ECE391_CACHE_DROP  2    /* empty the cache */
+
+/* Time from ece391_clock_gettime. */
+typedef struct ece391_timespec {
+    int32_t tv_sec;
+    int32_t tv_nsec;
+} ece391_timespec_t;
+
+/*
+ * The read-only page from ece391_clockmap. It does not change after boot:
+ * nanoseconds = ((rdtsc - tsc_base) * mult) >> shift, which
+ * ece391_clock_now in ece391support.c computes without a system call.
+ */
+typedef struct ece391_clock_page {
+    uint32_t tsc_khz;
+    uint32_t mult;
+    uint32_t shift;
+    uint32_t tsc_base_lo;
+    uint32_t tsc_base_hi;
+} ece391_clock_page_t;
+
+/* Clock for ece391_clock_gettime: nanoseconds since boot, never goes back. */
+#define ECE391_CLOCK_MONOTONIC 0
+
+/* One bucket of the profile from ece391_profile (ECE391_PROF_READ). */
+typedef struct ece391_prof_entry {
+    uint32_t eip;
+    uint8_t pid;        /* 0xFF if no process was running yet */
+    uint8_t cpl;        /* 0 = kernel, 3 = user */
+    uint8_t prog;       /* program index, see ECE391_PROF_NAME */
+    uint8_t reserved;
+    uint32_t count;
+} ece391_prof_entry_t;
+
+/* Commands for ece391_profile. */
+#define ECE391_PROF_START 0     /* discard the old profile and start sampling */
+#define ECE391_PROF_STOP  1
+#define ECE391_PROF_READ  2     /* buf = entries, n = how many fit; returns entries */
+#define ECE391_PROF_NAME  3     /* buf = 32 bytes, n = program index */
+#define ECE391_PROF_DUMP  4     /* write the profile to COM1 for prof.py */
+#define ECE391_PROF_MAX_ENTRIES 4096
+
+/* Commands for ece391_trace; the kernel must be built with -DTRACE. */
+#define ECE391_TRACE_DUMP  0    /* write the recorded events to COM1 */
+#define ECE391_TRACE_CLEAR 1
+
+/*
+ * From ece391_irqstat. Durations are in TSC cycles (tsc_khz per ms);
+ * bucket[i] counts those from 2^i to 2^(i+1) - 1 cycles.
+ */
+#define ECE391_IRQSTAT_LINES 16
+#define ECE391_IRQSTAT_BUCKETS 32
+typedef struct ece391_irq_hist {
+    uint32_t count;
+    uint32_t max;
+    uint32_t bucket[ECE391_IRQSTAT_BUCKETS];
+} ece391_irq_hist_t;
+
+typedef struct ece391_irqstat {
+    uint32_t tsc_khz;
+    ece391_irq_hist_t handler[ECE391_IRQSTAT_LINES];  /* per IRQ line */
+    ece391_irq_hist_t irqoff;   /* stretches with interrupts off, handlers included */
+    uint8_t irqoff_site[32];    /* where the longest began: "file.c:line" or "irq:n" */
+} ece391_irqstat_t;
+
+/* Flag for ece391_irqstat. */
+#define ECE391_IRQSTAT_RESET 1
+
+/*
+ * One process from ece391_procstat. Times are TSC cycles; tsc_khz in the
+ * clock page (ece391_clockmap) turns them into milliseconds.
+ */
+typedef struct ece391_proc_info {
+    uint8_t pid;
+    uint8_t parent_pid;
+    uint8_t term;
+    uint8_t reserved;
+    uint64_t user_cycles;
+    uint64_t sys_cycles;
+    uint64_t sleep_cycles;      /* idle, waiting in ece391_nanosleep */
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint32_t switches;          /* times the scheduler took the CPU away */
+    uint32_t syscalls;
+    uint32_t page_faults;
+    uint32_t serial;            /* which execute started it; tells a reused pid apart */
+    uint32_t in_kernel;
+    uint32_t asleep;
+    uint8_t name[32];
+} ece391_proc_info_t;
+#define ECE391_MAX_PROCESSES 6
+
+/* Values of whence for ece391_lseek. */
+#define ECE391_SEEK_SET 0
+#define ECE391_SEEK_CUR 1
+#define ECE391_SEEK_END 2
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +162,61 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_nop (void);
+extern int32_t ece391_readv (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+/* Returns how many calls succeeded before the first one that returned -1. */
+extern int32_t ece391_batch (ece391_syscall_desc_t* calls, int32_t count);
+/* Returns bytes filled (whole records only), 0 at the end of the directory. */
+extern int32_t ece391_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes);
+extern int32_t ece391_stat (const uint8_t* filename, ece391_stat_t* buf);
+/* Fails on the terminal (fds 0 and 1). */
+extern int32_t ece391_fstat (int32_t fd, ece391_stat_t* buf);
+/* Regular files only; returns the new position. */
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+/* Reads at offset without moving the file's position. */
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+/* Creates an empty file and returns it open; fails if it already exists. */
+extern int32_t ece391_create (const uint8_t* filename);
+extern int32_t ece391_truncate (int32_t fd, int32_t length);
+/* buf may be NULL; the counters are all zero unless the filesystem is on disk. */
+extern int32_t ece391_cachestat (ece391_cachestat_t* buf, int32_t flags);
+extern int32_t ece391_clock_gettime (int32_t clock_id, ece391_timespec_t* ts);
+extern int32_t ece391_clockmap (const ece391_clock_page_t** page);
+/* Sleeps at least *req, rounded up to the kernel's 1/1024 s timer tick. */
+extern int32_t ece391_nanosleep (const ece391_timespec_t* req);
+/* Terminal and RTC reads on fd return -1 after *timeout; NULL or zero waits forever. */
+extern int32_t ece391_set_timeout (int32_t fd, const ece391_timespec_t* timeout);
+extern int32_t ece391_profile (int32_t cmd, void* buf, int32_t n);
+/* Returns events dumped; -1 if the kernel records none. */
+extern int32_t ece391_trace (int32_t cmd);
+/* buf may be NULL. */
+extern int32_t ece391_irqstat (ece391_irqstat_t* buf, int32_t flags);
+/* Returns how many processes were copied, at most n. */
+extern int32_t ece391_procstat (ece391_proc_info_t* buf, int32_t n);
+
+/*
+ * The same calls made through SYSENTER/SYSEXIT instead of INT 0x80. Only
+ * calls that return to the caller have a fast version.
+ */
+extern int32_t ece391_fast_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_fast_write (int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t ece391_fast_open (const uint8_t* filename);
+extern int32_t ece391_fast_close (int32_t fd);
+extern int32_t ece391_fast_getargs (uint8_t* buf, int32_t nbytes);
+extern int32_t ece391_fast_nop (void);
+extern int32_t ece391_fast_readv (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_fast_writev (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_fast_batch (ece391_syscall_desc_t* calls, int32_t count);
+extern int32_t ece391_fast_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes);
+extern int32_t ece391_fast_stat (const uint8_t* filename, ece391_stat_t* buf);
+extern int32_t ece391_fast_fstat (int32_t fd, ece391_stat_t* buf);
+extern int32_t ece391_fast_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_fast_pread (int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+extern int32_t ece391_fast_create (const uint8_t* filename);
+extern int32_t ece391_fast_truncate (int32_t fd, int32_t length);
+extern int32_t ece391_fast_cachestat (ece391_cachestat_t* buf, int32_t flags);
+extern int32_t ece391_fast_clock_gettime (int32_t clock_id, ece391_timespec_t* ts);
 
 enum signums {
 	DIV_ZERO = 0,
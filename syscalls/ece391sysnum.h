@@ -11,5 +11,25 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_NOP     11
+#define SYS_READV   12
+#define SYS_WRITEV  13
+#define SYS_BATCH   14
+#define SYS_GETDENTS 15
+#define SYS_STAT    16
+#define SYS_FSTAT   17
+#define SYS_LSEEK   18
+#define SYS_PREAD   19
+#define SYS_CREATE  20
+#define SYS_TRUNCATE 21
+#define SYS_CACHESTAT 22
+#define SYS_CLOCK_GETTIME 23
+#define SYS_CLOCKMAP 24
+#define SYS_NANOSLEEP 25
+#define SYS_SET_TIMEOUT 26
+#define SYS_PROFILE 27
+#define SYS_TRACE 28
+#define SYS_IRQSTAT 29
+#define SYS_PROCSTAT 30
 
 #endif /* ECE391SYSNUM_H */
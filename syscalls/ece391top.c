@@ -0,0 +1,151 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+static ece391_proc_info_t before[ECE391_MAX_PROCESSES];
+static ece391_proc_info_t after[ECE391_MAX_PROCESSES];
+
+/* Left-justified in a field of width columns. */
+static void
+put_col (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    for (; len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+static void
+put_num (uint32_t value, uint32_t width)
+{
+    uint8_t buf[16];
+
+    ece391_itoa (value, buf, 10);
+    put_col (buf, width);
+}
+
+/* part / total in tenths of a percent, as "12.3". */
+static void
+put_permille (uint64_t part, uint64_t total, uint32_t width)
+{
+    uint8_t buf[16];
+    uint32_t len, permille;
+
+    while (total >> 32) {
+        part >>= 1;
+        total >>= 1;
+    }
+    permille = (0 == total) ? 0 : ece391_div32 (part * 1000, (uint32_t)total);
+    ece391_itoa (permille / 10, buf, 10);
+    len = ece391_strlen (buf);
+    buf[len] = '.';
+    ece391_itoa (permille % 10, buf + len + 1, 10);
+    put_col (buf, width);
+}
+
+/* The entry in before for the same process as p, or 0 if it started since. */
+static ece391_proc_info_t*
+find_before (const ece391_proc_info_t* p, int32_t n)
+{
+    int32_t i;
+
+    for (i = 0; i < n; i++)
+        if (before[i].serial == p->serial)
+            return &before[i];
+    return 0;
+}
+
+/*
+ * Prints every process, busiest over the last interval first: its share
+ * of the CPU (user + system, and the system part on its own), then
+ * lifetime totals. Time spent halted in nanosleep is idle, shown on its
+ * own line; with it every cycle is accounted for, so the shares and idle
+ * add up to 100%.
+ */
+static void
+show (int32_t nb, int32_t na, uint32_t khz)
+{
+    uint64_t busy[ECE391_MAX_PROCESSES], sys[ECE391_MAX_PROCESSES];
+    uint64_t total = 0, idle = 0;
+    int32_t order[ECE391_MAX_PROCESSES];
+    int32_t i, j, k;
+
+    for (i = 0; i < na; i++) {
+        ece391_proc_info_t* p = &after[i];
+        ece391_proc_info_t* b = find_before (p, nb);
+        busy[i] = p->user_cycles + p->sys_cycles;
+        sys[i] = p->sys_cycles;
+        idle += p->sleep_cycles;
+        if (0 != b) {
+            busy[i] -= b->user_cycles + b->sys_cycles;
+            sys[i] -= b->sys_cycles;
+            idle -= b->sleep_cycles;
+        }
+        total += busy[i];
+        for (j = i; j > 0 && busy[order[j - 1]] < busy[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    total += idle;
+
+    ece391_fdputs (1, (uint8_t*)"PID TERM NAME      %CPU  %SYS  CPU ms  SWITCH  SYSCALL FAULT READ KB WRITE KB\n");
+    for (k = 0; k < na; k++) {
+        ece391_proc_info_t* p = &after[order[k]];
+        i = order[k];
+        put_num (p->pid, 4);
+        put_num (p->term, 5);
+        put_col (p->name, 10);
+        put_permille (busy[i], total, 6);
+        put_permille (sys[i], total, 6);
+        put_num (ece391_div32 (p->user_cycles + p->sys_cycles, khz), 8);
+        put_num (p->switches, 8);
+        put_num (p->syscalls, 9);
+        put_num (p->page_faults, 6);
+        put_num (ece391_div32 (p->bytes_read, 1024), 8);
+        put_num (ece391_div32 (p->bytes_written, 1024), 0);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    ece391_fdputs (1, (uint8_t*)"idle ");
+    put_permille (idle, total, 0);
+    ece391_fdputs (1, (uint8_t*)"%\n");
+}
+
+/*
+ * top [COUNT] -- every second, COUNT times (default 1), shows where the
+ * CPU went across all terminals since the previous look.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    const ece391_clock_page_t* page;
+    ece391_timespec_t second = {1, 0};
+    int32_t count = 1, nb, na, i;
+    uint8_t* s;
+
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        for (count = 0, s = buf; *s >= '0' && *s <= '9'; s++)
+            count = count * 10 + (*s - '0');
+        if ('\0' != *s || 0 == count) {
+            ece391_fdputs (1, (uint8_t*)"usage: top [COUNT]\n");
+            return 3;
+        }
+    }
+    if (-1 == ece391_clockmap (&page) ||
+        -1 == (nb = ece391_procstat (before, ECE391_MAX_PROCESSES))) {
+        ece391_fdputs (1, (uint8_t*)"top: no process statistics\n");
+        return 2;
+    }
+    for (i = 0; i < count; i++) {
+        ece391_nanosleep (&second);
+        na = ece391_procstat (after, ECE391_MAX_PROCESSES);
+        show (nb, na, 0 != page->tsc_khz ? page->tsc_khz : 1);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        for (nb = 0; nb < na; nb++)
+            before[nb] = after[nb];
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+/* trace dump | clear -- the events go to COM1, not the screen. */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t n;
+
+    if (0 != ece391_getargs (buf, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: trace dump | clear\n");
+        return 3;
+    }
+    if (0 == ece391_strcmp (buf, (uint8_t*)"clear"))
+        return (0 == ece391_trace (ECE391_TRACE_CLEAR)) ? 0 : 2;
+    if (0 == ece391_strcmp (buf, (uint8_t*)"dump")) {
+        if (-1 == (n = ece391_trace (ECE391_TRACE_DUMP))) {
+            ece391_fdputs (1, (uint8_t*)"no trace; build the kernel with -DTRACE\n");
+            return 2;
+        }
+        ece391_itoa (n, buf, 10);
+        ece391_fdputs (1, buf);
+        ece391_fdputs (1, (uint8_t*)" events written to COM1\n");
+        return 0;
+    }
+    ece391_fdputs (1, (uint8_t*)"usage: trace dump | clear\n");
+    return 3;
+}
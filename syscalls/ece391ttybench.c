@@ -0,0 +1,35 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define LINES 500
+#define BYTES 4000
+
+static uint8_t line[] = "The quick brown fox jumps over the lazy dog; 0123456789 abcdefghijklmnopqrstuv\n";
+
+/*
+ * Writes LINES full-width lines to the terminal one write per line, then
+ * BYTES characters one write each, and reports cycles per byte for both.
+ * Both scroll the screen on every line, as real output would.
+ */
+int main ()
+{
+    uint32_t i, start, line_cycles, byte_cycles;
+    uint32_t len = ece391_strlen (line);
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LINES; i++)
+        (void)ece391_write (1, line, len);
+    line_cycles = ece391_rdtsc_lo () - start;
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < BYTES; i++)
+        (void)ece391_write (1, &line[i % len], 1);
+    byte_cycles = ece391_rdtsc_lo () - start;
+
+    /* Report after all the output so the results don't scroll away. */
+    ece391_report ((uint8_t*)"tty_line_cycles_per_byte", line_cycles / (LINES * len));
+    ece391_report ((uint8_t*)"tty_char_cycles_per_byte", byte_cycles / BYTES);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CHUNK 512
+#define TOTAL (64 * 1024)
+
+static uint8_t fname[] = "writebench.tmp";
+
+/*
+ * Appends TOTAL bytes to a scratch file in CHUNK sized writes and reports
+ * the cost per kB, then truncates the file back to zero so the blocks are
+ * free for the next run.
+ */
+int main ()
+{
+    int32_t fd, i, written;
+    uint32_t start, cycles;
+    uint8_t buf[CHUNK];
+
+    for (i = 0; i < CHUNK; i++)
+        buf[i] = 'a' + (i % 26);
+
+    if (-1 == (fd = ece391_create (fname)) &&
+        -1 == (fd = ece391_open (fname))) {
+        ece391_fdputs (1, (uint8_t*)"could not create scratch file\n");
+        return 2;
+    }
+    if (-1 == ece391_truncate (fd, 0)) {
+        ece391_fdputs (1, (uint8_t*)"truncate failed\n");
+        return 3;
+    }
+
+    written = 0;
+    start = ece391_rdtsc_lo ();
+    while (written < TOTAL) {
+        if (CHUNK != ece391_write (fd, buf, CHUNK))
+            break;
+        written += CHUNK;
+    }
+    cycles = ece391_rdtsc_lo () - start;
+
+    ece391_report ((uint8_t*)"append_bytes", written);
+    if (written > 0)
+        ece391_report ((uint8_t*)"append_cycles_per_kb", cycles / (written / 1024));
+
+    (void)ece391_truncate (fd, 0);
+    (void)ece391_close (fd);
+    return 0;
+}
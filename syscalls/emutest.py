@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""Run user programs against ece391emulate.c and diff them with golden output.
+
+Build the emulated programs first (`make emulated` here), then:
+
+    ./emutest.py                      # every case in emutests/
+    ./emutest.py grep_frame shell_*   # just these (shell-style patterns)
+    ./emutest.py --repeat 20 --perf grep_frame
+    ./emutest.py --update cat_frame0  # rewrite the golden file from this run
+
+A case is emutests/NAME.case, a list of "key value" lines:
+
+    run       command line, as the shell would pass it to execute
+    files     files copied from fsdir into the scratch directory it runs in
+    programs  emulated programs linked into that directory so it can
+              execute them ("all" for every one built)
+    sort      compare the output lines sorted (grep and ls follow the
+              host's directory order)
+    timeout   seconds before the program is killed (default 10)
+
+emutests/NAME.in, if present, is typed at the program: standard input is
+a pseudo-terminal in line mode, so like the OS's terminal driver each read
+returns at most one line, and a read after the last line returns 0.
+emutests/NAME.out is the expected standard output followed by an
+"[exit N]" line. A shell case should end its input with "exit"; the
+emulated shell keeps prompting at end of input.
+
+Every run is timed: wall clock, and user and system CPU from wait4. With
+--perf the program runs under `perf stat`, which adds cycles and
+instructions for it and every program it executes. With --repeat the
+case runs that many times and the fastest run is reported.
+"""
+import argparse
+import fnmatch
+import glob
+import os
+import pty
+import shutil
+import signal
+import statistics
+import subprocess
+import sys
+import tempfile
+import termios
+import threading
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PERF_EVENTS = ["cycles", "instructions", "task-clock"]
+
+
+def read_case(path):
+    """Returns the case as a dict; values are lists of words, "sort" is a flag."""
+    case = {"files": [], "programs": [], "sort": False, "timeout": 10.0}
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            key, _, value = line.partition(" ")
+            if key == "run":
+                case["run"] = value.strip()
+            elif key in ("files", "programs"):
+                case[key] += value.split()
+            elif key == "sort":
+                case["sort"] = True
+            elif key == "timeout":
+                case["timeout"] = float(value)
+            else:
+                sys.exit("%s:%d: unknown key %r" % (path, number, key))
+    if "run" not in case:
+        sys.exit("%s: no run line" % path)
+    return case
+
+
+def emulated(bin_dir, name):
+    return os.path.join(bin_dir, name + "_emulated")
+
+
+def make_scratch(case, args):
+    """Builds the directory the case runs in; returns its path."""
+    scratch = tempfile.mkdtemp(prefix="emutest-")
+    for name in case["files"]:
+        shutil.copy(os.path.join(args.fsdir, name), scratch)
+    programs = case["programs"]
+    if "all" in programs:
+        programs = [os.path.basename(p)[:-len("_emulated")]
+                    for p in glob.glob(emulated(args.bin_dir, "*"))]
+    for name in programs:
+        os.symlink(os.path.abspath(emulated(args.bin_dir, name)), os.path.join(scratch, name))
+    return scratch
+
+
+def parse_perf(path):
+    """Returns {event: count} from `perf stat -x,` output."""
+    counts = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.strip().split(",")
+            if len(fields) < 3 or fields[0].startswith("<"):
+                continue
+            event = fields[2].split(":")[0]
+            try:
+                counts[event] = float(fields[0])
+            except ValueError:
+                pass
+    return counts
+
+
+def run_once(case, stdin, args, scratch):
+    """Runs the case once; returns (output, timings) or (None, reason)."""
+    words = case["run"].split()
+    program = emulated(args.bin_dir, words[0])
+    if not os.access(program, os.X_OK):
+        return None, "%s not built" % program
+    command = [os.path.abspath(program)] + words[1:]
+    perf_out = None
+    if args.perf:
+        fd, perf_out = tempfile.mkstemp(prefix="emutest-perf-")
+        os.close(fd)
+        command = ["perf", "stat", "-x,", "-o", perf_out,
+                   "-e", ",".join(PERF_EVENTS), "--"] + command
+
+    # The whole input goes in up front; the line discipline hands it out a line per read.
+    master, slave = pty.openpty()
+    mode = termios.tcgetattr(slave)
+    mode[3] &= ~termios.ECHO
+    termios.tcsetattr(slave, termios.TCSANOW, mode)
+    os.write(master, stdin + bytes([mode[6][termios.VEOF][0]]))
+
+    out = tempfile.TemporaryFile()
+    start = time.perf_counter()
+    proc = subprocess.Popen(command, cwd=scratch, stdin=slave, stdout=out,
+                            stderr=subprocess.DEVNULL)
+    os.close(slave)
+    try:
+        return finish(proc, out, case, start, perf_out)
+    finally:
+        os.close(master)
+
+
+def finish(proc, out, case, start, perf_out):
+    """Waits for the program; returns (output, timings) or (None, reason)."""
+    # Block in wait4 so the wall clock stops when the program does.
+    timer = threading.Timer(case["timeout"], proc.kill)
+    timer.start()
+    _, status, usage = os.wait4(proc.pid, 0)
+    timer.cancel()
+    if not os.WIFEXITED(status) and os.WTERMSIG(status) == signal.SIGKILL and \
+            time.perf_counter() - start >= case["timeout"]:
+        return None, "timed out after %gs" % case["timeout"]
+    wall = time.perf_counter() - start
+    proc.returncode = 0           # Reaped above; keep Popen from waiting again.
+
+    out.seek(0)
+    output = out.read()
+    if os.WIFEXITED(status):
+        output += b"[exit %d]\n" % os.WEXITSTATUS(status)
+    else:
+        output += b"[signal %d]\n" % os.WTERMSIG(status)
+    timings = {"wall": wall, "user": usage.ru_utime, "sys": usage.ru_stime}
+    if perf_out is not None:
+        # perf exits with the program's status, so [exit N] is still the program's.
+        timings.update(parse_perf(perf_out))
+        os.unlink(perf_out)
+    return output, timings
+
+
+def normalize(output, case):
+    if not case["sort"]:
+        return output
+    lines = output.split(b"\n")
+    return b"\n".join(sorted(lines[:-2]) + lines[-2:])
+
+
+def show_diff(expected, got):
+    """Prints the first lines where expected and got differ."""
+    exp_lines = expected.decode(errors="replace").splitlines()
+    got_lines = got.decode(errors="replace").splitlines()
+    for i in range(max(len(exp_lines), len(got_lines))):
+        e = exp_lines[i] if i < len(exp_lines) else "<end>"
+        g = got_lines[i] if i < len(got_lines) else "<end>"
+        if e != g:
+            print("    line %d:\n      expected %r\n      got      %r" % (i + 1, e, g))
+            return
+
+
+def format_timings(runs):
+    """The fastest run by wall clock, plus the spread when repeated."""
+    best = min(runs, key=lambda t: t["wall"])
+    text = "%8.2f ms  user %.2f ms  sys %.2f ms" % (
+        best["wall"] * 1e3, best["user"] * 1e3, best["sys"] * 1e3)
+    if len(runs) > 1:
+        text += "  median %.2f ms" % (statistics.median(t["wall"] for t in runs) * 1e3)
+    if "instructions" in best:
+        text += "  %d instructions" % best["instructions"]
+    if "cycles" in best:
+        text += "  %d cycles" % best["cycles"]
+    return text
+
+
+def run_case(name, args):
+    """Returns True if the case passed (or was updated)."""
+    base = os.path.join(args.cases, name)
+    case = read_case(base + ".case")
+    stdin = b""
+    if os.path.exists(base + ".in"):
+        with open(base + ".in", "rb") as f:
+            stdin = f.read()
+    expected = None
+    if os.path.exists(base + ".out"):
+        with open(base + ".out", "rb") as f:
+            expected = f.read()
+
+    runs = []
+    scratch = make_scratch(case, args)
+    try:
+        for _ in range(args.repeat):
+            output, timings = run_once(case, stdin, args, scratch)
+            if output is None:
+                print("FAIL  %-20s %s" % (name, timings))
+                return False
+            runs.append(timings)
+            if args.update:
+                with open(base + ".out", "wb") as f:
+                    f.write(output)
+                expected = output
+            if expected is None:
+                print("FAIL  %-20s no %s.out; run with --update to create it" % (name, name))
+                return False
+            if normalize(output, case) != normalize(expected, case):
+                print("FAIL  %-20s output differs" % name)
+                show_diff(normalize(expected, case), normalize(output, case))
+                return False
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+    print("%-5s %-20s %s" % ("NEW" if args.update else "ok", name, format_timings(runs)))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("names", nargs="*", help="cases to run (default: all)")
+    parser.add_argument("--bin-dir", default=HERE, help="where the *_emulated programs are")
+    parser.add_argument("--fsdir", default=os.path.join(HERE, "..", "fsdir"))
+    parser.add_argument("--cases", default=os.path.join(HERE, "emutests"))
+    parser.add_argument("--repeat", type=int, default=1, help="runs per case")
+    parser.add_argument("--perf", action="store_true", help="count cycles and instructions with perf stat")
+    parser.add_argument("--update", action="store_true", help="write the output as the new golden file")
+    args = parser.parse_args()
+
+    if args.perf and shutil.which("perf") is None:
+        sys.exit("--perf needs perf on the PATH")
+    every = sorted(os.path.basename(p)[:-len(".case")]
+                   for p in glob.glob(os.path.join(args.cases, "*.case")))
+    patterns = args.names or ["*"]
+    names = [n for n in every if any(fnmatch.fnmatch(n, p) for p in patterns)]
+    if not names:
+        sys.exit("no cases match")
+
+    failed = [n for n in names if not run_case(n, args)]
+    print("%d of %d passed" % (len(names) - len(failed), len(names)))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()